@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+
+# assets.py
+#
+# converts the static web assets in main/common/assets/ into main/common/assets.i:
+# - gzip compressed, when it saves at least 1/8 (Content-Encoding: gzip)
+# - strong ETag: FNV-1a hash of the bytes as sent
+# the output is only rewritten on changes (no rebuild otherwise)
+
+import gzip
+import os
+import sys
+
+TYPES = { '.css': 'text/css',
+          '.js':  'application/javascript',
+          '.gif': 'image/gif',
+          '.ico': 'image/x-icon',
+          '.png': 'image/png',
+          '.svg': 'image/svg+xml',
+          '.htm': 'text/html',
+          '.html': 'text/html' }
+
+def fnv1a( data ):
+    h = 0x811c9dc5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+def cname( name ):
+    return 'asset_' + ''.join( c if c.isalnum() else '_' for c in name )
+
+def convert( srcdir ):
+    out = [ '// generated by assets.py from main/common/assets/ - do not edit', '' ]
+    table = []
+    for name in sorted( os.listdir( srcdir ) ):
+        ext = os.path.splitext( name )[1].lower()
+        if ext not in TYPES:
+            continue
+        with open( os.path.join( srcdir, name ), 'rb' ) as f:
+            data = f.read()
+        packed = gzip.compress( data, 9, mtime=0 )
+        gz = len(packed) <= len(data) - len(data) // 8
+        if gz:
+            data = packed
+        var = cname( name )
+        out.append( 'static const char %s[] = {  // %s%s' % (var, name, ' (gzip)' if gz else '') )
+        for i in range( 0, len(data), 12 ):
+            out.append( '  ' + ' '.join( '0x%02x,' % b for b in data[i:i+12] ) )
+        out.append( '};' )
+        table.append( '    { "%s", "%s", %s, "\\"%08x\\"", %s, sizeof(%s) },'
+                      % (name, TYPES[ext], 'true' if gz else 'false', fnv1a( data ), var, var) )
+    out.append( '' )
+    out.append( 'static const Assets::Asset s_assets[] = {' )
+    out += table
+    out.append( '};' )
+    return '\n'.join( out ) + '\n'
+
+if __name__ == "__main__":
+    base = os.path.dirname( os.path.abspath( sys.argv[0] ) )
+    text = convert( os.path.join( base, 'main', 'common', 'assets' ) )
+    dest = os.path.join( base, 'main', 'common', 'assets.i' )
+    try:
+        with open( dest, 'r' ) as f:
+            if f.read() == text:
+                sys.exit( 0 )
+    except OSError:
+        pass
+    with open( dest, 'w' ) as f:
+        f.write( text )
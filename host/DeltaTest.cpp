@@ -0,0 +1,215 @@
+/*
+ * DeltaTest.cpp
+ *
+ * host test of the delta update end to end: two synthetic images (the new one with
+ * inserted code, i.e. shifted addresses), patch.py and shrink.py build the update files,
+ * which get decoded as by the Updator (Unshrink -> Delta -> partition) in random pieces
+ * with the old image as running partition - the written partition must be the new image
+ *   DeltaTest <python3> <repository root>
+ */
+
+#include "Delta.h"
+#include "Unshrink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+typedef std::vector<uint8_t> Bytes;
+
+int s_failed = 0;
+
+void expect( bool ok, const char * what )
+{
+    if (! ok) {
+        printf( "FAILED: %s\n", what );
+        ++s_failed;
+    }
+}
+
+uint32_t s_rand = 1;
+
+uint32_t rnd()
+{
+    s_rand = s_rand * 1103515245 + 12345;
+    return s_rand >> 16;
+}
+
+// code blobs, each followed by the address of another blob (as literal pools)
+struct Blob {
+    Bytes    code;
+    uint32_t target;
+};
+
+std::vector<Blob> blobs( uint32_t count )
+{
+    static const uint8_t ops[] = { 0x12, 0xc1, 0x09, 0x01, 0x0d, 0xf0, 0x22, 0xa0, 0x85, 0x06, 0x00, 0x20 };
+    std::vector<Blob> b( count );
+    for (Blob & blob : b) {
+        blob.code.resize( 16 + rnd() % 48 );
+        for (uint8_t & c : blob.code)
+            c = ops[rnd() % sizeof(ops)];
+        blob.target = rnd() % count;
+    }
+    return b;
+}
+
+Bytes image( const std::vector<Blob> & b )
+{
+    std::vector<uint32_t> pos;
+    uint32_t p = 0;
+    for (const Blob & blob : b) {
+        pos.push_back( p );
+        p += blob.code.size() + 4;
+    }
+    Bytes img;
+    for (const Blob & blob : b) {
+        img.insert( img.end(), blob.code.begin(), blob.code.end() );
+        uint32_t const addr = 0x40210000 + pos[blob.target];
+        for (uint8_t i = 0; i < 4; ++i)
+            img.push_back( (uint8_t) (addr >> (8 * i)) );
+    }
+    return img;
+}
+
+bool writeFile( const char * path, const Bytes & data )
+{
+    FILE * const f = fopen( path, "wb" );
+    if (! f)
+        return false;
+    bool const ok = fwrite( data.data(), 1, data.size(), f ) == data.size();
+    return (fclose( f ) == 0) && ok;
+}
+
+Bytes readFile( const char * path )
+{
+    Bytes data;
+    FILE * const f = fopen( path, "rb" );
+    if (! f)
+        return data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread( buf, 1, sizeof(buf), f )) > 0)
+        data.insert( data.end(), buf, buf + n );
+    fclose( f );
+    return data;
+}
+
+// sinks as Updator's UpdatorOtaWrite and UpdatorDeltaFeed
+struct Ota {
+    const esp_partition_t * part;
+    uint32_t                offset;
+};
+
+bool otaWrite( void * ctx, const uint8_t * data, size_t len )
+{
+    Ota * const ota = (Ota *) ctx;
+    if (esp_partition_write( ota->part, ota->offset, data, len ) != ESP_OK)
+        return false;
+    ota->offset += len;
+    return true;
+}
+
+bool deltaFeed( void * delta, const uint8_t * data, size_t len )
+{
+    return ! ((Delta *) delta)->Feed( data, len );
+}
+
+const esp_partition_t s_running{ 0x10000,  0x80000, "ota_0", "running.bin" };
+const esp_partition_t s_update { 0x90000,  0x80000, "ota_1", "update.bin" };
+
+// fed in pieces as received by esp_http_client_read()
+const char * apply( const Bytes & data, bool patch )
+{
+    remove( s_update.path );
+    Ota ota{ & s_update, 0 };
+    Delta    delta{ & s_running, otaWrite, & ota };
+    Unshrink unshrink{ patch ? deltaFeed : otaWrite, patch ? (void *) & delta : (void *) & ota };
+    const char * err = 0;
+    for (size_t pos = 0; (pos < data.size()) && ! err; ) {
+        size_t const n = std::min( (size_t) (1 + rnd() % 1460), data.size() - pos );
+        err = unshrink.Feed( & data[pos], n );
+        pos += n;
+    }
+    if (! err)
+        err = unshrink.Finish();
+    if (patch && ! err)
+        err = delta.Finish();
+    if (patch && delta.Error())
+        err = delta.Error();  // instead of unshrink's "write failed"
+    return err;
+}
+
+bool run( const std::string & cmd )
+{
+    printf( "%s\n", cmd.c_str() );
+    fflush( stdout );
+    return system( cmd.c_str() ) == 0;
+}
+}
+
+int main( int argc, char ** argv )
+{
+    if (argc < 3) {
+        fprintf( stderr, "usage: %s <python3> <repository root>\n", argv[0] );
+        return 2;
+    }
+    std::string const python = argv[1];
+    std::string const root   = argv[2];
+
+    // new firmware: some code inserted (all following addresses shifted), some code changed
+    std::vector<Blob> b = blobs( 1500 );
+    Bytes const oldImg = image( b );
+    std::vector<Blob> const inserted = blobs( 8 );
+    for (const Blob & blob : inserted)
+        b.insert( b.begin() + b.size() / 3, Blob{ blob.code, (uint32_t) (rnd() % b.size()) } );
+    b[b.size() / 2].code.assign( 40, 0x5a );
+    Bytes const newImg = image( b );
+
+    expect( writeFile( s_running.path, oldImg ), s_running.path );
+    expect( writeFile( "new.bin", newImg ), "new.bin" );
+    expect( run( python + " " + root + "/patch.py " + s_running.path + " new.bin new.bin.patch" ), "patch.py" );
+    expect( run( python + " " + root + "/shrink.py new.bin new.bin.hs" ), "shrink.py" );
+    Bytes const patch  = readFile( "new.bin.patch" );
+    Bytes const shrunk = readFile( "new.bin.hs" );
+    expect( patch.size() && shrunk.size(), "update files" );
+    printf( "image %zu bytes: patch %zu bytes, compressed image %zu bytes\n", newImg.size(), patch.size(), shrunk.size() );
+
+    const char * err = apply( patch, true );
+    expect( ! err, err ? err : "patch" );
+    expect( readFile( s_update.path ) == newImg, "patch: new image written" );
+
+    err = apply( shrunk, false );
+    expect( ! err, err ? err : "compressed image" );
+    expect( readFile( s_update.path ) == newImg, "compressed image: new image written" );
+
+    // refused before any output: patch of another image than the running one
+    expect( writeFile( s_running.path, newImg ), s_running.path );
+    err = apply( patch, true );
+    expect( err && ! strcmp( err, "patch not built against the running image" ), err ? err : "wrong base accepted" );
+    expect( readFile( s_update.path ).empty(), "wrong base: nothing written" );
+    expect( writeFile( s_running.path, oldImg ), s_running.path );
+
+    // damaged downloads
+    Bytes cut{ patch.begin(), patch.end() - 16 };
+    expect( apply( cut, true ) != 0, "truncated patch accepted" );
+    // a flipped bit is refused or decodes to the same (e.g. an equivalent back reference)
+    uint8_t refused = 0;
+    for (uint8_t i = 0; i < 16; ++i) {
+        Bytes bad{ patch };
+        int const    bit = rnd() % 8;
+        size_t const at  = Unshrink::HeaderLen + rnd() % (bad.size() - Unshrink::HeaderLen);
+        bad[at] ^= 1 << bit;
+        if (apply( bad, true ))
+            ++refused;
+        else
+            expect( readFile( s_update.path ) == newImg, "corrupted patch: other image written" );
+    }
+    printf( "16 corrupted patches: %u refused, %u decoded to the new image\n", refused, 16 - refused );
+
+    return s_failed ? 1 : 0;
+}
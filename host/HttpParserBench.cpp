@@ -0,0 +1,95 @@
+/*
+ * HttpParserBench.cpp
+ *
+ * host benchmark of HttpParser: a config form of 16 fields (as Mqtinator's setup page)
+ * posted url encoded and as json, received in pieces of RecvLen and of 16 bytes
+ */
+
+#include "HttpParser.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+namespace
+{
+const char * const s_keys[] = {
+    "host", "port", "host2", "port2", "rebootAfter", "pub", "sub", "pub2", "sub2",
+    "format", "primStatIdx", "secStatIdx", "alive", "pubWindow", "spill", "drainRate" };
+constexpr uint8_t s_count = sizeof(s_keys) / sizeof(s_keys[0]);
+
+size_t s_piece;  // bytes per httpd_req_recv
+
+size_t fixedPiece( size_t max )
+{
+    return (max < s_piece) ? max : s_piece;
+}
+
+int s_failed = 0;
+
+void expect( bool ok, const char * what )
+{
+    if (! ok) {
+        printf( "FAILED: %s\n", what );
+        ++s_failed;
+    }
+}
+
+// parses body, returns the value of "sub2"
+std::string parse( const std::string & body )
+{
+    char              bufs[s_count][64];
+    HttpParser::Input in[s_count];
+    for (uint8_t i = 0; i < s_count; ++i)
+        in[i] = HttpParser::Input{ s_keys[i], bufs[i], sizeof(bufs[i]) };
+    HttpParser  parser{ in, s_count };
+    HostReq     host{ body.data(), 0, fixedPiece };
+    httpd_req_t req{ nullptr, body.size(), & host };
+    if (parser.ParsePostData( & req ) || (parser.Fields() != (1UL << s_count) - 1))
+        return std::string{};
+    return std::string{ bufs[8], in[8].len };
+}
+
+void bench( const char * name, const std::string & body, size_t piece )
+{
+    s_piece = piece;
+    expect( parse( body ) == "domoticz/out/42", name );
+
+    uint32_t const loops = 200000;
+    volatile size_t sink = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; ++i)
+        sink = sink + parse( body ).size();
+    auto const end = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>( end - start ).count() / loops;
+    printf( "%-5s %3zu bytes in pieces of %3zu: %6.0f ns per post, %5.1f MB/s\n",
+            name, body.size(), piece, ns, body.size() * 1e3 / ns );
+}
+}
+
+int main()
+{
+    const char * const values[s_count] = {
+        "broker.fritz.box", "1883", "192.168.178.2", "1883", "60", "domoticz/in", "rgb/%23",
+        "", "domoticz/out/42", "domoticz", "17", "18", "300", "20", "8", "5" };
+
+    std::string form;
+    std::string json{ "{" };
+    for (uint8_t i = 0; i < s_count; ++i) {
+        if (i) {
+            form += "&";
+            json += ", ";
+        }
+        form += std::string{ s_keys[i] } + "=" + values[i];
+        json += std::string{ "\"" } + s_keys[i] + "\": \"" + (strcmp( values[i], "rgb/%23" ) ? values[i] : "rgb/#") + "\"";
+    }
+    json += "}";
+
+    bench( "form", form, HttpParser::RecvLen );
+    bench( "form", form, 16 );
+    bench( "json", json, HttpParser::RecvLen );
+    bench( "json", json, 16 );
+
+    return s_failed ? 1 : 0;
+}
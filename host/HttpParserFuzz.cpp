@@ -0,0 +1,173 @@
+/*
+ * HttpParserFuzz.cpp
+ *
+ * fuzz driver of HttpParser: post data (form or json) and uri parameters
+ * - the post data gets parsed as a whole and in random pieces (incl. receive time outs):
+ *   both results must be the same, no matter how split
+ * - values must be terminated and fit the buffers
+ * built with libFuzzer (HOST_LIBFUZZER) or as a standalone driver on generated input:
+ *   HttpParserFuzz [iterations [seed]]
+ */
+
+#include "HttpParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace
+{
+struct Field {
+    const char * key;
+    uint16_t     size;  // buffer size (0: no buffer)
+};
+const Field s_fields[] = {
+    { "uri",     80 }, { "a",   2 }, { "b",  8 }, { "c", 1 }, { "type", 16 },
+    { "retries",  4 }, { "on",  0 }, { "abcdefghijklmnopqrstuvwxyz012345", 8 },  // KeyMax long
+};
+constexpr uint8_t s_count = sizeof(s_fields) / sizeof(s_fields[0]);
+
+struct Result {
+    std::string  value[s_count];
+    uint16_t     len[s_count];
+    uint32_t     fields;
+    const char * err;
+};
+
+uint32_t s_rand;  // pieces of the split run
+
+uint32_t rnd()
+{
+    s_rand = s_rand * 1103515245 + 12345;
+    return s_rand >> 16;
+}
+
+size_t randomPiece( size_t max )
+{
+    if (! (rnd() % 16))
+        return 0;  // time out
+    return 1 + rnd() % max;
+}
+
+void check( bool ok, const char * what, const uint8_t * data, size_t size )
+{
+    if (ok)
+        return;
+    fprintf( stderr, "FAILED: %s on %zu bytes:\n", what, size );
+    fwrite( data, 1, size, stderr );
+    fprintf( stderr, "\n" );
+    abort();
+}
+
+Result parse( const char * body, size_t len, bool uri, size_t (* piece)( size_t ) )
+{
+    char              bufs[s_count][80];
+    HttpParser::Input in[s_count];
+    for (uint8_t i = 0; i < s_count; ++i) {
+        in[i] = HttpParser::Input{ s_fields[i].key, s_fields[i].size ? bufs[i] : nullptr, s_fields[i].size };
+        if (s_fields[i].size) {  // json keeps the prefilled default of fields not posted
+            strncpy( bufs[i], "default", s_fields[i].size - 1 );
+            bufs[i][s_fields[i].size - 1] = 0;
+        }
+    }
+    HttpParser parser{ in, s_count };
+
+    std::string uriStr{ "/update?" };
+    HostReq     host{ body, 0, piece };
+    httpd_req_t req{ nullptr, len, & host };
+    Result      r;
+    if (uri) {
+        uriStr.append( body, len );
+        req.uri = uriStr.c_str();
+        r.err = parser.ParseUriParam( & req );
+    } else
+        r.err = parser.ParsePostData( & req );
+    r.fields = parser.Fields();
+    for (uint8_t i = 0; i < s_count; ++i) {
+        r.len[i] = in[i].len;
+        if (in[i].buf) {
+            size_t const n = strnlen( bufs[i], sizeof(bufs[i]) );
+            r.value[i].assign( bufs[i], n );
+        }
+    }
+    return r;
+}
+
+void run( const uint8_t * data, size_t size )
+{
+    if (size < 2)
+        return;
+    uint32_t const seed = data[0] | (data[1] << 8);
+    bool const     uri  = seed & 1;
+    const char   * body = (const char *) data + 2;
+    size_t const   len  = size - 2;
+
+    Result const whole = parse( body, len, uri, nullptr );
+    s_rand = seed;
+    Result const split = parse( body, len, uri, uri ? nullptr : randomPiece );
+
+    check( (whole.err == split.err) || (whole.err && split.err && ! strcmp( whole.err, split.err )),
+           "same result whole/split", data, size );
+    check( whole.fields == split.fields, "same fields whole/split", data, size );
+    for (uint8_t i = 0; i < s_count; ++i) {
+        check( whole.value[i] == split.value[i], "same value whole/split", data, size );
+        check( whole.len[i] == split.len[i], "same length whole/split", data, size );
+        if (s_fields[i].size) {
+            check( whole.value[i].size() < s_fields[i].size, "value fits buffer", data, size );
+            check( (whole.err != nullptr) || (whole.len[i] == whole.value[i].size()), "length of value", data, size );
+        }
+    }
+}
+}
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t * data, size_t size )
+{
+    run( data, size );
+    return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+namespace
+{
+// input of form/json tokens, escapes and random bytes
+std::string generate( uint32_t & seed )
+{
+    static const char * const tokens[] = {
+        "uri", "a", "b", "c", "type", "retries", "on", "x", "abcdefghijklmnopqrstuvwxyz012345",
+        "abcdefghijklmnopqrstuvwxyz0123456", "=", "=", "&", "&", "%", "%4", "%41", "%zz", "%%", "+",
+        "{", "}", "\"", "\":", ":", ",", " ", "\t", "\r\n", "true", "false", "null", "-1.5e3",
+        "\\\"", "\\u0041", "\\u00e4", "\\n", "[", "{\"a\":", "http://host:8070/build/rtos8266.bin" };
+    std::string s;
+    s_rand = seed;
+    uint32_t const n = rnd() % 40;
+    s += (char) rnd();
+    s += (char) rnd();
+    if (rnd() % 2)
+        s += (rnd() % 2) ? "{\"" : " \r\n{\"";
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t const t = rnd() % 64;
+        if (t < sizeof(tokens) / sizeof(tokens[0]))
+            s += tokens[t];
+        else if (t < 60)
+            s += (char) rnd();
+        else
+            s.append( rnd() % 200, 'v' );  // long value
+    }
+    seed = s_rand;
+    return s;
+}
+}
+
+int main( int argc, char ** argv )
+{
+    unsigned long const iterations = (argc > 1) ? strtoul( argv[1], 0, 0 ) : 200000;
+    uint32_t            seed       = (argc > 2) ? strtoul( argv[2], 0, 0 ) : 1;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        std::string const input = generate( seed );
+        run( (const uint8_t *) input.data(), input.size() );
+    }
+    printf( "%lu inputs parsed whole and split: ok\n", iterations );
+    return 0;
+}
+#endif
@@ -0,0 +1,302 @@
+/*
+ * HttpdBench.cpp
+ *
+ * requests per second of parallel keep-alive clients - against a local stand-in of
+ * esp_http_server (one task, select() loop over at most max_open_sockets sessions;
+ * all in use: lru_purge closes the least recently used one, else the new one is refused)
+ * to compare the WebServer::Config tunings, or against a device:
+ *   HttpdBench [host port [uri]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Tuning {  // the WebServer::Config fields effective on the connection handling
+    const char * name;
+    uint8_t      maxSockets;
+    bool         lruPurge;
+};
+
+std::atomic<bool>     s_stop{ false };
+std::atomic<bool>     s_go{ false };
+std::atomic<unsigned> s_ready{ 0 };  // clients connected
+long                  s_recvTmoMs = 200;  // response expected within
+
+// stand-in of the httpd task
+class StandIn
+{
+public:
+    StandIn( const Tuning & t ) : mTuning( t )
+    {
+        mListen = socket( AF_INET, SOCK_STREAM, 0 );
+        sockaddr_in a{};
+        a.sin_family      = AF_INET;
+        a.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        socklen_t len     = sizeof(a);
+        if ((bind( mListen, (sockaddr *) & a, len ) < 0) || (listen( mListen, 5 ) < 0)  // backlog as httpd
+                || (getsockname( mListen, (sockaddr *) & a, & len ) < 0)) {
+            perror( "stand-in" );
+            exit( 1 );
+        }
+        mPort   = ntohs( a.sin_port );
+        mThread = std::thread( [this] { Run(); } );
+    }
+    ~StandIn()
+    {
+        mStop = true;
+        mThread.join();
+        for (Session & s : mSessions)
+            close( s.fd );
+        close( mListen );
+    }
+    uint16_t Port() const { return mPort; }
+    unsigned Purged() const { return mPurged; }
+    unsigned Refused() const { return mRefused; }
+
+private:
+    struct Session {
+        int         fd;
+        uint64_t    lru;  // last request
+        std::string in;
+    };
+
+    void Accept()
+    {
+        if ((mSessions.size() >= mTuning.maxSockets) && mTuning.lruPurge) {
+            auto lru = mSessions.begin();
+            for (auto s = mSessions.begin(); s != mSessions.end(); ++s)
+                if (s->lru < lru->lru)
+                    lru = s;
+            close( lru->fd );
+            mSessions.erase( lru );
+            ++mPurged;
+            return;  // accepted on the next loop
+        }
+        int const fd = accept( mListen, 0, 0 );
+        if (fd < 0)
+            return;
+        if (mSessions.size() >= mTuning.maxSockets) {
+            close( fd );
+            ++mRefused;
+            return;
+        }
+        int one = 1;
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, & one, sizeof(one) );
+        mSessions.push_back( Session{ fd, ++mClock, {} } );
+    }
+
+    bool Serve( Session & s )  // false: session closed
+    {
+        char buf[512];
+        ssize_t const n = recv( s.fd, buf, sizeof(buf), 0 );
+        if (n <= 0)
+            return false;
+        s.in.append( buf, n );
+        size_t end;
+        while ((end = s.in.find( "\r\n\r\n" )) != std::string::npos) {
+            s.in.erase( 0, end + 4 );
+            s.lru = ++mClock;
+            static const std::string body( 1024, 'x' );  // a chunk of HttpHelper
+            std::string const rsp = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: "
+                                  + std::to_string( body.size() ) + "\r\n\r\n" + body;
+            if (send( s.fd, rsp.data(), rsp.size(), MSG_NOSIGNAL ) != (ssize_t) rsp.size())
+                return false;
+        }
+        return true;
+    }
+
+    void Run()
+    {
+        while (! mStop) {
+            fd_set fds;
+            FD_ZERO( & fds );
+            FD_SET( mListen, & fds );
+            int maxFd = mListen;
+            for (Session & s : mSessions) {
+                FD_SET( s.fd, & fds );
+                if (maxFd < s.fd)
+                    maxFd = s.fd;
+            }
+            timeval tv{ 0, 20000 };
+            if (select( maxFd + 1, & fds, 0, 0, & tv ) <= 0)
+                continue;
+            for (auto s = mSessions.begin(); s != mSessions.end(); )
+                if (FD_ISSET( s->fd, & fds ) && ! Serve( *s )) {
+                    close( s->fd );
+                    s = mSessions.erase( s );
+                } else
+                    ++s;
+            if (FD_ISSET( mListen, & fds ))
+                Accept();
+        }
+    }
+
+    Tuning const         mTuning;
+    int                  mListen  { -1 };
+    uint16_t             mPort    { 0 };
+    std::vector<Session> mSessions;
+    uint64_t             mClock   { 0 };
+    unsigned             mPurged  { 0 };
+    unsigned             mRefused { 0 };
+    std::atomic<bool>    mStop    { false };
+    std::thread          mThread;
+};
+
+struct Counts {
+    std::atomic<unsigned> requests { 0 };
+    std::atomic<unsigned> connects { 0 };
+    std::atomic<unsigned> failed   { 0 };  // closed before the response
+};
+
+int connectTo( const sockaddr_in & addr )
+{
+    int const fd = socket( AF_INET, SOCK_STREAM, 0 );
+    timeval tv{ s_recvTmoMs / 1000, (s_recvTmoMs % 1000) * 1000 };
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, & tv, sizeof(tv) );
+    int one = 1;
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, & one, sizeof(one) );
+    if (connect( fd, (const sockaddr *) & addr, sizeof(addr) ) < 0) {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+// one request/response on a kept-alive connection
+bool request( int fd, const std::string & req )
+{
+    if (send( fd, req.data(), req.size(), MSG_NOSIGNAL ) != (ssize_t) req.size())
+        return false;
+    std::string rsp;
+    char buf[2048];
+    size_t head = std::string::npos;
+    size_t total = 0;
+    while (! total || (rsp.size() < total)) {
+        ssize_t const n = recv( fd, buf, sizeof(buf), 0 );
+        if (n <= 0)
+            return false;
+        rsp.append( buf, n );
+        if ((head == std::string::npos) && ((head = rsp.find( "\r\n\r\n" )) != std::string::npos)) {
+            const char * const cl = strcasestr( rsp.c_str(), "Content-Length:" );
+            if (! cl || (cl > rsp.c_str() + head))
+                return false;  // chunked: not expected
+            total = head + 4 + strtoul( cl + 15, 0, 10 );
+        }
+    }
+    return true;
+}
+
+void client( const sockaddr_in & addr, const std::string & req, Counts & c )
+{
+    int fd = connectTo( addr );  // all clients connected before the time starts
+    bool fresh = true;
+    if (fd >= 0)
+        ++c.connects;
+    ++s_ready;
+    while (! s_go)
+        std::this_thread::yield();
+    while (! s_stop) {
+        if (fd < 0) {
+            fd = connectTo( addr );
+            if (fd < 0) {
+                ++c.failed;
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                continue;
+            }
+            ++c.connects;
+            fresh = true;
+        }
+        if (request( fd, req )) {
+            ++c.requests;
+            fresh = false;
+            continue;
+        }
+        close( fd );  // purged: reconnect / refused: failed
+        fd = -1;
+        if (fresh) {
+            ++c.failed;
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+    if (fd >= 0)
+        close( fd );
+}
+
+void bench( const char * name, const sockaddr_in & addr, const std::string & req, unsigned clients, unsigned ms )
+{
+    Counts c;
+    std::vector<std::thread> threads;
+    s_stop  = false;
+    s_go    = false;
+    s_ready = 0;
+    for (unsigned i = 0; i < clients; ++i)
+        threads.emplace_back( [&] { client( addr, req, c ); } );
+    while (s_ready < clients)
+        std::this_thread::yield();
+    auto const start = std::chrono::steady_clock::now();
+    s_go = true;
+    std::this_thread::sleep_for( std::chrono::milliseconds( ms ) );
+    s_stop = true;
+    double const s = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    for (std::thread & t : threads)
+        t.join();
+    printf( "%-22s %2u clients: %7.0f requests/s, %5u connects, %5u failed\n",
+            name, clients, c.requests / s, c.connects.load(), c.failed.load() );
+}
+}
+
+int main( int argc, char ** argv )
+{
+    static const unsigned clients[] = { 1, 4, 8, 12 };
+
+    if (argc > 2) {  // device
+        addrinfo hints{};
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo * ai;
+        if (getaddrinfo( argv[1], argv[2], & hints, & ai )) {
+            fprintf( stderr, "unknown host %s\n", argv[1] );
+            return 1;
+        }
+        sockaddr_in const addr = *(sockaddr_in *) ai->ai_addr;
+        freeaddrinfo( ai );
+        s_recvTmoMs = 5000;  // Config::recvTimeout default
+        std::string const req = std::string{ "GET " } + ((argc > 3) ? argv[3] : "/") + " HTTP/1.1\r\nHost: "
+                              + argv[1] + "\r\n\r\n";
+        for (unsigned n : clients)
+            bench( argv[1], addr, req, n, 5000 );
+        return 0;
+    }
+
+    static const Tuning tunings[] = {
+        { "7 sockets, lru purge", 7, true },   // WebServer::Config defaults
+        { "7 sockets, no purge",  7, false },  // former HTTPD_DEFAULT_CONFIG
+        { "3 sockets, lru purge", 3, true } };
+    std::string const req = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    for (const Tuning & t : tunings) {
+        StandIn server{ t };
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        addr.sin_port        = htons( server.Port() );
+        for (unsigned n : clients)
+            bench( t.name, addr, req, n, 250 );
+        printf( "%-22s stand-in: %u purged, %u refused\n", t.name, server.Purged(), server.Refused() );
+    }
+    return 0;
+}
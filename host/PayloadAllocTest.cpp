@@ -0,0 +1,112 @@
+/*
+ * PayloadAllocTest.cpp
+ *
+ * host test of Payload.h: the domoticz layouts as published by Mqtinator::Pub( idx, ... ),
+ * Control and Swizz are formatted without any heap allocation
+ * (malloc and operator new get counted) - the former std::string chains for comparison
+ */
+
+#include "Payload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+
+extern "C" void * __libc_malloc( size_t size );
+
+namespace
+{
+unsigned long s_allocs = 0;
+
+int s_failed = 0;
+
+void expect( bool ok, const char * what )
+{
+    if (! ok) {
+        printf( "FAILED: %s\n", what );
+        ++s_failed;
+    }
+}
+
+char s_slot[128 + 1];  // Mqtinator::PubSlot::data: the payload gets copied once into the queue slot
+
+template <class F> unsigned long allocs( F f )
+{
+    unsigned long const before = s_allocs;
+    f();
+    return s_allocs - before;
+}
+}
+
+// count every heap allocation of this process
+extern "C" void * malloc( size_t size )
+{
+    ++s_allocs;
+    return __libc_malloc( size );
+}
+void * operator new( size_t size )
+{
+    ++s_allocs;
+    void * p = __libc_malloc( size );
+    if (! p)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete( void * p ) noexcept { free( p ); }
+void operator delete( void * p, size_t ) noexcept { free( p ); }
+
+int main()
+{
+    // Mqtinator::Pub( idx, long, decimals ) - e.g. Temperator: 21.5 degrees
+    unsigned long n = allocs( [] {
+        DzPayload msg;
+        msg.Domoticz( 123, 0, 215, 1 );
+        memcpy( s_slot, msg.c_str(), msg.Len() + 1 );
+    } );
+    expect( ! n, "Pub( idx, long, decimals ) allocates" );
+    expect( ! strcmp( s_slot, "{ \"idx\": 123, \"nvalue\": 0, \"svalue\": \"21.5\" }" ), s_slot );
+    printf( "Pub( idx, long, decimals ): %lu allocations \"%s\"\n", n, s_slot );
+
+    // Mqtinator::Pub( idx, const char * )
+    n = allocs( [] {
+        Payload<128> msg;
+        msg.Domoticz( 7, 0, "on" );
+        memcpy( s_slot, msg.c_str(), msg.Len() + 1 );
+    } );
+    expect( ! n, "Pub( idx, svalue ) allocates" );
+    expect( ! strcmp( s_slot, "{ \"idx\": 7, \"nvalue\": 0, \"svalue\": \"on\" }" ), s_slot );
+
+    // Swizz confirmation: no svalue
+    n = allocs( [] {
+        DzPayload msg;
+        msg.Domoticz( 42, 1 );
+        memcpy( s_slot, msg.c_str(), msg.Len() + 1 );
+    } );
+    expect( ! n, "Domoticz( idx, nvalue ) allocates" );
+    expect( ! strcmp( s_slot, "{ \"idx\": 42, \"nvalue\": 1 }" ), s_slot );
+
+    // fixed point corner cases
+    DzPayload p;
+    p.Add( -5, 2 );
+    expect( ! strcmp( p.c_str(), "-0.05" ), p.c_str() );
+    p.Clear();
+    p.Add( -2147483647L - 1 );
+    expect( ! strcmp( p.c_str(), "-2147483648" ), p.c_str() );
+    Payload<8> small;
+    small.Add( "0123456789" );
+    expect( (! small.Ok()) && (small.Len() == 7), "overflow truncates" );
+
+    // former Control::PublishValue
+    n = allocs( [] {
+        std::string msg = "{ \"idx\": " + std::to_string( 123 )
+                        + ", \"nvalue\": 0"
+                        + ", \"svalue\": \"" + std::to_string( 215 ) + "\""
+                        + " }";
+        memcpy( s_slot, msg.c_str(), msg.size() + 1 );
+    } );
+    printf( "former std::string chain: %lu allocations \"%s\"\n", n, s_slot );
+
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * TopicRouterBench.cpp
+ *
+ * host check and benchmark of the subscription dispatch:
+ * TopicRouter vs. the former std::map<std::string,callback> lookup with "#" fallback
+ */
+
+#include "TopicRouter.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+int s_calls[64];
+
+template <int I> void cb( const char *, const char * ) { ++s_calls[I]; }
+
+typedef std::map<std::string, TopicRouter::Callback> Map;
+
+// Mqtinator::Run of the baseline
+uint8_t mapLookup( const Map & map, const char * topic, TopicRouter::Callback * found )
+{
+    auto it = map.find( topic );
+    if (it == map.end())
+        it = map.find( "#" );
+    if (it == map.end())
+        return 0;
+    *found = it->second;
+    return 1;
+}
+
+int s_failed = 0;
+
+void expect( bool ok, const char * what )
+{
+    if (! ok) {
+        printf( "FAILED: %s\n", what );
+        ++s_failed;
+    }
+}
+
+template <class F> double nsPerCall( F f, uint32_t loops )
+{
+    auto const start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; ++i)
+        f( i );
+    auto const end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>( end - start ).count() / loops;
+}
+}
+
+int main()
+{
+    static const TopicRouter::Callback cbs[] = {
+        cb<0>,  cb<1>,  cb<2>,  cb<3>,  cb<4>,  cb<5>,  cb<6>,  cb<7>,
+        cb<8>,  cb<9>,  cb<10>, cb<11>, cb<12>, cb<13>, cb<14>, cb<15>,
+        cb<16>, cb<17>, cb<18>, cb<19>, cb<20>, cb<21>, cb<22>, cb<23>,
+        cb<24>, cb<25>, cb<26>, cb<27>, cb<28>, cb<29>, cb<30>, cb<31> };
+    static const uint8_t count = sizeof(cbs) / sizeof(cbs[0]);
+
+    // topics as subscribed by keypad, swizz, rgb and domoticz idx devices
+    std::vector<std::string> topics{ "-", "flash", "blink", "signal", "status", "rgb/set", "rgb/fade" };
+    while (topics.size() < count - 1)
+        topics.push_back( std::to_string( 100 + topics.size() ) );
+
+    TopicRouter router;
+    Map         map;
+    for (uint8_t i = 0; i < topics.size(); ++i) {
+        router.Add( topics[i].c_str(), cbs[i] );
+        map[topics[i]] = cbs[i];
+    }
+    router.Add( "#", cbs[count - 1] );
+    map["#"] = cbs[count - 1];
+
+    // same callbacks as the map: direct match only, "#" on a miss
+    std::vector<std::string> probe{ topics };
+    probe.push_back( "unknown" );
+    probe.push_back( "rgb/unknown" );
+    probe.push_back( "rgb/set/deeper" );
+    for (auto & t : probe) {
+        TopicRouter::Callback r[TopicRouter::MaxMatches];
+        TopicRouter::Callback m = 0;
+        uint8_t const nr = router.Lookup( t.c_str(), r, TopicRouter::MaxMatches );
+        uint8_t const nm = mapLookup( map, t.c_str(), & m );
+        expect( (nr == nm) && (nr == 1) && (r[0] == m), t.c_str() );
+    }
+
+    // wildcards: '+' and "rgb/#" along with the direct match, just the bare "#" as fallback
+    TopicRouter wild;
+    wild.Add( "rgb/set", cbs[0] );
+    wild.Add( "rgb/+",   cbs[1] );
+    wild.Add( "rgb/#",   cbs[2] );
+    wild.Add( "#",       cbs[3] );
+    TopicRouter::Callback r[TopicRouter::MaxMatches];
+    expect( (wild.Lookup( "rgb/set", r, TopicRouter::MaxMatches ) == 3)
+            && (r[0] == cbs[2]) && (r[1] == cbs[0]) && (r[2] == cbs[1]), "rgb/set: rgb/#, direct and +" );
+    expect( (wild.Lookup( "rgb/x/y", r, TopicRouter::MaxMatches ) == 1) && (r[0] == cbs[2]), "rgb/x/y: rgb/#" );
+    expect( (wild.Lookup( "rgb", r, TopicRouter::MaxMatches ) == 1) && (r[0] == cbs[2]), "rgb: rgb/# (parent level)" );
+    expect( (wild.Lookup( "other", r, TopicRouter::MaxMatches ) == 1) && (r[0] == cbs[3]), "other: # fallback" );
+    expect( wild.Dispatch( "other/x", "" ) == 1, "other/x: # fallback" );
+    expect( wild.Remove( "rgb/+" ) && (wild.Lookup( "rgb/fade", r, TopicRouter::MaxMatches ) == 1)
+            && (r[0] == cbs[2]), "rgb/fade after remove of rgb/+" );
+    expect( wild.Remove( "rgb/#" ) && (wild.Lookup( "rgb/fade", r, TopicRouter::MaxMatches ) == 1)
+            && (r[0] == cbs[3]), "rgb/fade after remove of rgb/#: # fallback" );
+
+    // context per pattern and callback (Mqtinator: queue of the consumer), gone with the pattern
+    TopicRouter ctx;
+    int queue;
+    void * c[TopicRouter::MaxMatches];
+    ctx.Add( "dz/344", cbs[0], & queue );
+    ctx.Add( "dz/+",   cbs[0] );
+    expect( (ctx.Lookup( "dz/344", r, TopicRouter::MaxMatches, c ) == 2)
+            && (c[0] == & queue) && ! c[1], "dz/344: context of dz/344 only" );
+    expect( ctx.Remove( "dz/344" ) && ! ctx.Add( "dz/+", cbs[0] ) && ctx.Add( "dz/344", cbs[0] )
+            && (ctx.Lookup( "dz/344", r, TopicRouter::MaxMatches, c ) == 2) && ! c[0] && ! c[1], "dz/344: context removed" );
+
+    uint32_t const loops = 2000000;
+    volatile uintptr_t sink = 0;
+    double const nsMap = nsPerCall( [&]( uint32_t i ) {
+        TopicRouter::Callback f = 0;
+        mapLookup( map, probe[i % probe.size()].c_str(), & f );
+        sink = sink + (uintptr_t) f;
+    }, loops );
+    double const nsRouter = nsPerCall( [&]( uint32_t i ) {
+        TopicRouter::Callback f[TopicRouter::MaxMatches];
+        router.Lookup( probe[i % probe.size()].c_str(), f, TopicRouter::MaxMatches );
+        sink = sink + (uintptr_t) f[0];
+    }, loops );
+    printf( "%u topics, %u lookups: std::map %.1f ns, TopicRouter %.1f ns per lookup\n",
+            (unsigned) topics.size(), loops, nsMap, nsRouter );
+
+    return s_failed ? 1 : 0;
+}
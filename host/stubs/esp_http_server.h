@@ -0,0 +1,45 @@
+/*
+ * esp_http_server.h - host stand-in: request body served from memory
+ *
+ * HostReq (req->aux) gives the body in pieces of Piece( max ) bytes,
+ * a piece of 0 bytes is returned as HTTPD_SOCK_ERR_TIMEOUT
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+typedef struct httpd_req {
+    const char * uri;
+    size_t       content_len;
+    void       * aux;
+} httpd_req_t;
+
+struct HostReq {
+    const char * body;
+    size_t       pos;
+    size_t    (* Piece)( size_t max );  // 0: whole max
+};
+
+inline int httpd_req_recv( httpd_req_t * req, char * buf, size_t len )
+{
+    HostReq * const h = (HostReq *) req->aux;
+    size_t const left = req->content_len - h->pos;
+    if (len > left)
+        len = left;
+    if (! len)
+        return HTTPD_SOCK_ERR_FAIL;
+    if (h->Piece) {
+        len = h->Piece( len );
+        if (! len)
+            return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    memcpy( buf, & h->body[h->pos], len );
+    h->pos += len;
+    return (int) len;
+}
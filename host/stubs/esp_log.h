@@ -0,0 +1,11 @@
+/*
+ * esp_log.h - host stand-in: logging compiled out
+ */
+
+#pragma once
+
+#define ESP_LOGE( tag, format, ... ) do {} while (0)
+#define ESP_LOGW( tag, format, ... ) do {} while (0)
+#define ESP_LOGI( tag, format, ... ) do {} while (0)
+#define ESP_LOGD( tag, format, ... ) do {} while (0)
+#define ESP_LOGV( tag, format, ... ) do {} while (0)
@@ -0,0 +1,49 @@
+/*
+ * esp_partition.h - host stand-in: partition backed by a file
+ *
+ * the file holds the written part of the partition, beyond it reads as erased flash (0xff)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t     address;
+    uint32_t     size;
+    char         label[17];
+    const char * path;  // host: backing file
+} esp_partition_t;
+
+inline esp_err_t esp_partition_read( const esp_partition_t * part, size_t offset, void * dst, size_t size )
+{
+    if ((offset > part->size) || (size > part->size - offset))
+        return ESP_ERR_INVALID_SIZE;
+    memset( dst, 0xff, size );
+    FILE * const f = fopen( part->path, "rb" );
+    if (! f)
+        return ESP_OK;
+    if (! fseek( f, (long) offset, SEEK_SET ))
+        if (fread( dst, 1, size, f )) {}
+    fclose( f );
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write( const esp_partition_t * part, size_t offset, const void * src, size_t size )
+{
+    if ((offset > part->size) || (size > part->size - offset))
+        return ESP_ERR_INVALID_SIZE;
+    FILE * f = fopen( part->path, "r+b" );
+    if (! f)
+        f = fopen( part->path, "w+b" );
+    if (! f)
+        return ESP_FAIL;
+    bool const ok = (! fseek( f, (long) offset, SEEK_SET )) && (fwrite( src, 1, size, f ) == size);
+    fclose( f );
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,30 @@
+/*
+ * mbedtls/sha256.h - host stand-in on OpenSSL (libcrypto)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <openssl/evp.h>
+
+typedef struct {
+    EVP_MD_CTX * ctx;
+} mbedtls_sha256_context;
+
+inline void mbedtls_sha256_init( mbedtls_sha256_context * c ) { c->ctx = EVP_MD_CTX_new(); }
+inline void mbedtls_sha256_free( mbedtls_sha256_context * c ) { EVP_MD_CTX_free( c->ctx ); c->ctx = 0; }
+
+inline int mbedtls_sha256_starts_ret( mbedtls_sha256_context * c, int is224 )
+{
+    return EVP_DigestInit_ex( c->ctx, is224 ? EVP_sha224() : EVP_sha256(), 0 ) ? 0 : -1;
+}
+
+inline int mbedtls_sha256_update_ret( mbedtls_sha256_context * c, const unsigned char * in, size_t len )
+{
+    return EVP_DigestUpdate( c->ctx, in, len ) ? 0 : -1;
+}
+
+inline int mbedtls_sha256_finish_ret( mbedtls_sha256_context * c, unsigned char out[32] )
+{
+    return EVP_DigestFinal_ex( c->ctx, out, 0 ) ? 0 : -1;
+}
@@ -0,0 +1,122 @@
+/*
+ * Assets.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "Assets.h"
+
+#include <stdio.h>      // snprintf()
+#include <string.h>
+
+#include <esp_log.h>
+
+#include "HttpHelper.h"     // Sent()
+#include "WebServer.h"
+
+extern "C" esp_err_t handler_get_static( httpd_req_t * req );
+
+namespace
+{
+const char * const TAG = "Assets";
+
+#include "assets.i"     // s_assets[] generated by assets.py
+
+const httpd_uri_t uri_get_static = { .uri = "/static/*", .method = HTTP_GET, .handler = handler_get_static, .user_ctx = 0 };
+
+const char s_cacheForever[]  = "public, max-age=31536000, immutable";  // versioned url
+const char s_revalidate[]    = "no-cache";                             // ETag check each time
+const char s_notFound[]      = "no such asset";
+}
+
+void Assets::Init( WebServer & webserver )
+{
+    webserver.AddUri( uri_get_static );
+}
+
+const Assets::Asset * Assets::Find( const char * name, size_t len )
+{
+    for (const Asset & asset : s_assets)
+        if ((! strncmp( name, asset.name, len )) && ! asset.name[len])
+            return & asset;
+    return 0;
+}
+
+const Assets::Asset * Assets::Find( const char * name )
+{
+    return Find( name, strlen( name ) );
+}
+
+std::string Assets::Url( const char * name )
+{
+    std::string url{ "/static/" };
+    url += name;
+    const Asset * asset = Find( name );
+    if (asset) {
+        url += "?v=";
+        url.append( asset->etag + 1, EtagLen - 3 );  // without quotes
+    }
+    return url;
+}
+
+void Assets::Etag( char * buf, const void * data, uint32_t len )
+{
+    uint32_t hash = 0x811c9dc5;  // FNV-1a as assets.py
+    for (const uint8_t * bp = (const uint8_t *) data; len--; ++bp)
+        hash = (hash ^ *bp) * 0x01000193;
+    snprintf( buf, EtagLen, "\"%08x\"", hash );
+}
+
+bool Assets::NotModified( httpd_req_t * req, const char * etag, const char * cacheControl )
+{
+    httpd_resp_set_hdr( req, "ETag", etag );
+    httpd_resp_set_hdr( req, "Cache-Control", cacheControl );
+
+    char match[48];
+    if (httpd_req_get_hdr_value_str( req, "If-None-Match", match, sizeof(match) ) != ESP_OK)
+        return false;
+    if (! (strstr( match, etag ) || ! strcmp( match, "*" )))
+        return false;
+
+    ESP_LOGD( TAG, "%s not modified", req->uri );
+    httpd_resp_set_status( req, "304 Not Modified" );
+    httpd_resp_send( req, 0, 0 );
+    return true;
+}
+
+void Assets::Send( httpd_req_t * req, const Asset & asset, const char * cacheControl )
+{
+    if (NotModified( req, asset.etag, cacheControl ))
+        return;
+
+    httpd_resp_set_type( req, asset.type );
+    if (asset.gzip)
+        httpd_resp_set_hdr( req, "Content-Encoding", "gzip" );
+    httpd_resp_send( req, asset.data, asset.len );
+    HttpHelper::Sent( asset.len );
+}
+
+void Assets::Get( httpd_req_t * req )
+{
+    const char * const name = & req->uri[sizeof("/static/") - 1];
+    size_t const len = strcspn( name, "?" );
+
+    const Asset * asset = Find( name, len );
+    if (! asset) {
+        httpd_resp_set_status( req, HTTPD_404 );
+        httpd_resp_send( req, s_notFound, sizeof(s_notFound) - 1 );
+        return;
+    }
+    // ?v=<current etag>: the content of this url will never change
+    const char * const query = & name[len];
+    bool const versioned = (! strncmp( query, "?v=", 3 ))
+                        && (! strncmp( query + 3, asset->etag + 1, EtagLen - 3 ));
+    Send( req, *asset, versioned ? s_cacheForever : s_revalidate );
+}
+
+/////////////////// extern "C" ///////////////////
+
+extern "C" esp_err_t handler_get_static( httpd_req_t * req )
+{
+    Assets::Get( req );
+    return ESP_OK;
+}
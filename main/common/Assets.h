@@ -0,0 +1,48 @@
+/*
+ * Assets.h
+ *
+ * static web assets, embedded at build time (assets.py: main/common/assets/ -> assets.i)
+ * served as /static/<name> with strong ETag:
+ * - If-None-Match with the current ETag -> 304 without content
+ * - gzip compressed assets are sent with Content-Encoding: gzip (no fallback)
+ * - /static/<name>?v=<etag> (as referenced by the page head) may be cached forever,
+ *   any other request has to be revalidated
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>             // size_t
+#include <string>               // std::string
+
+#include <esp_http_server.h>    // httpd_req_t
+
+class WebServer;
+
+class Assets
+{
+public:
+    struct Asset {
+        const char * name;
+        const char * type;
+        bool         gzip;
+        const char * etag;  // incl. quotes
+        const char * data;
+        uint32_t     len;
+    };
+    static constexpr uint8_t EtagLen = 11;  // "xxxxxxxx" incl. termination
+
+    static void Init( WebServer & webserver );  // registers /static/*
+
+    static const Asset * Find( const char * name, size_t len );
+    static const Asset * Find( const char * name );
+    static std::string   Url( const char * name );  // /static/<name>?v=<etag> (cacheable forever)
+
+    // set ETag and Cache-Control - true, when 304 sent (content not modified)
+    static bool NotModified( httpd_req_t * req, const char * etag, const char * cacheControl );
+    static void Send( httpd_req_t * req, const Asset & asset, const char * cacheControl );
+
+    static void Etag( char * buf, const void * data, uint32_t len );  // buf of EtagLen
+
+    static void Get( httpd_req_t * req );
+};
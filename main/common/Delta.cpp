@@ -0,0 +1,200 @@
+/*
+ * Delta.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "Delta.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcmp(), memcpy()
+
+#include <esp_log.h>
+
+namespace
+{
+const char * const TAG = "Delta";
+}
+
+Delta::Delta( const esp_partition_t * base, Sink sink, void * ctx )
+    : mBase { base }, mSink { sink }, mCtx { ctx }
+{
+    mbedtls_sha256_init( & mSha );
+    mbedtls_sha256_starts_ret( & mSha, 0 );
+    mBuf = (uint8_t *) malloc( BufLen );
+    if (! mBuf)
+        mError = "no memory for patch buffer";
+}
+
+Delta::~Delta()
+{
+    mbedtls_sha256_free( & mSha );
+    free( mBuf );
+}
+
+const char * Delta::Header()
+{
+    if ((mHead[0] != Magic0) || (mHead[1] != Magic1))
+        return "no patch";
+    if (mHead[2] != Version)
+        return "unsupported patch version";
+    mOldLen = U32( & mHead[4] );
+    mNewLen = U32( & mHead[8] );
+    memcpy( mNewHash, & mHead[12 + HashLen], HashLen );
+    if (mOldLen > mBase->size)
+        return "patch base larger than running partition";
+
+    // patch built against the running image? (mBuf not in use yet)
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init( & sha );
+    mbedtls_sha256_starts_ret( & sha, 0 );
+    bool ok = true;
+    for (uint32_t pos = 0; ok && (pos < mOldLen); pos += BufLen) {
+        uint32_t const len = (mOldLen - pos < BufLen) ? mOldLen - pos : BufLen;
+        ok = esp_partition_read( mBase, pos, mBuf, len ) == ESP_OK;
+        mbedtls_sha256_update_ret( & sha, mBuf, len );
+    }
+    uint8_t hash[HashLen];
+    mbedtls_sha256_finish_ret( & sha, hash );
+    mbedtls_sha256_free( & sha );
+    if (! ok)
+        return "cannot read running partition";
+    if (memcmp( hash, & mHead[12], HashLen )) {
+        ESP_LOGW( TAG, "patch base %02x%02x%02x%02x.. does not match running image %02x%02x%02x%02x..",
+                       mHead[12], mHead[13], mHead[14], mHead[15], hash[0], hash[1], hash[2], hash[3] );
+        return "patch not built against the running image";
+    }
+    ESP_LOGI( TAG, "patch of %u bytes image to %u bytes", mOldLen, mNewLen );
+    mState = OP;
+    return 0;
+}
+
+const char * Delta::Op()
+{
+    mOp     = (char) mHead[0];
+    mLen    = U32( & mHead[1] );
+    mOldPos = U32( & mHead[5] );
+    ESP_LOGD( TAG, "%c %u @ 0x%x", mOp, mLen, mOldPos );
+
+    if (mLen > mNewLen - mOut)
+        return "patch exceeds new image length";
+    switch (mOp)
+    {
+        case 'c':
+        case 'd':
+            if ((mLen > mOldLen) || (mOldPos > mOldLen - mLen))
+                return "patch exceeds old image";
+            if (mOp == 'c')
+                return Copy( mLen );
+            break;
+        case 'a':
+            break;
+        default:
+            return "invalid patch op";
+    }
+    if (mLen)
+        mState = DATA;
+    return 0;
+}
+
+bool Delta::Flush()
+{
+    if (! mBufPos)
+        return true;
+    mbedtls_sha256_update_ret( & mSha, mBuf, mBufPos );
+    bool const ok = mSink( mCtx, mBuf, mBufPos );
+    mBufPos = 0;
+    return ok;
+}
+
+uint8_t * Delta::Reserve( uint16_t & len )
+{
+    if ((mBufPos == BufLen) && ! Flush())
+        return 0;
+    if (len > BufLen - mBufPos)
+        len = BufLen - mBufPos;
+    return & mBuf[mBufPos];
+}
+
+const char * Delta::Copy( uint32_t len )
+{
+    while (len) {
+        uint16_t n = (len < BufLen) ? (uint16_t) len : BufLen;
+        uint8_t * const dst = Reserve( n );
+        if (! dst)
+            return "write failed";
+        if (esp_partition_read( mBase, mOldPos, dst, n ) != ESP_OK)
+            return "cannot read running partition";
+        mBufPos += n;
+        mOldPos += n;
+        mOut    += n;
+        len     -= n;
+    }
+    return 0;
+}
+
+const char * Delta::Data( const uint8_t * in, uint16_t len )
+{
+    while (len) {
+        uint16_t n = len;
+        uint8_t * const dst = Reserve( n );
+        if (! dst)
+            return "write failed";
+        if (mOp == 'd') {
+            if (esp_partition_read( mBase, mOldPos, dst, n ) != ESP_OK)
+                return "cannot read running partition";
+            for (uint16_t i = 0; i < n; ++i)
+                dst[i] += in[i];
+            mOldPos += n;
+        } else {
+            memcpy( dst, in, n );
+        }
+        mBufPos += n;
+        mOut    += n;
+        mLen    -= n;
+        in      += n;
+        len     -= n;
+    }
+    return 0;
+}
+
+const char * Delta::Feed( const uint8_t * in, size_t len )
+{
+    while (len && ! mError) {
+        if (mState == DATA) {
+            uint16_t const n = (len < mLen) ? ((len < BufLen) ? len : BufLen)
+                                            : ((mLen < BufLen) ? mLen : BufLen);
+            mError = Data( in, n );
+            in  += n;
+            len -= n;
+            if (! mLen)
+                mState = OP;
+            continue;
+        }
+        mHead[mHeadPos++] = *in++;
+        --len;
+        if (mHeadPos < ((mState == HEADER) ? HeaderLen : OpLen))
+            continue;
+        mHeadPos = 0;
+        mError = (mState == HEADER) ? Header() : Op();
+    }
+    return mError;
+}
+
+const char * Delta::Finish()
+{
+    if (mError)
+        return mError;
+    if ((mState != OP) || mHeadPos)
+        return "patch incomplete";
+    if (! Flush())
+        return "write failed";
+    if (mOut != mNewLen) {
+        ESP_LOGE( TAG, "reconstructed %u of %u bytes", mOut, mNewLen );
+        return "patch incomplete";
+    }
+    uint8_t hash[HashLen];
+    mbedtls_sha256_finish_ret( & mSha, hash );
+    if (memcmp( hash, mNewHash, HashLen ))
+        return "new image sha256 mismatch";
+    return 0;
+}
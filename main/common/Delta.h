@@ -0,0 +1,83 @@
+/*
+ * Delta.h
+ *
+ * streaming decoder of patches built by patch.py: the new image gets reconstructed
+ * from the image in the base (running) partition and the patch data
+ * - header (little endian): 'h' 'd' <version 1> 0 <old length: u32> <new length: u32>
+ *                           <sha256 of the old image> <sha256 of the new image>
+ * - then ops: <op> <length: u32> <old offset: u32> [data]
+ *     'c': copy length bytes of the old image             (no data)
+ *     'd': length bytes of the old image + data bytes     (length data bytes)
+ *     'a': data bytes                                     (length data bytes)
+ * the patch is refused before any output, when the base partition does not hold
+ * the old image (sha256); the new image is checked on Finish (length and sha256)
+ * output is passed to the sink in BufLen chunks (sector aligned flash writes)
+ * patch.py compresses the patch (shrink.py): fed by Unshrink
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>             // size_t
+
+#include <esp_partition.h>      // esp_partition_t
+#include <mbedtls/sha256.h>     // mbedtls_sha256_context
+
+class Delta
+{
+public:
+    typedef bool (*Sink)( void * ctx, const uint8_t * data, size_t len );  // false: abort
+
+    static constexpr uint8_t  Magic0    = 'h';
+    static constexpr uint8_t  Magic1    = 'd';
+    static constexpr uint8_t  Version   = 1;
+    static constexpr uint8_t  HashLen   = 32;
+    static constexpr uint8_t  HeaderLen = 12 + 2 * HashLen;
+    static constexpr uint8_t  OpLen     = 9;
+    static constexpr uint16_t BufLen    = 4096;
+
+    Delta( const esp_partition_t * base, Sink sink, void * ctx );
+    ~Delta();
+    Delta( const Delta & ) = delete;
+    Delta & operator=( const Delta & ) = delete;
+
+    const char * Feed( const uint8_t * in, size_t len );  // 0 or error message
+    const char * Finish();                                // flush, check length and sha256
+
+    const char * Error() const { return mError; };
+    uint32_t     Size()  const { return mNewLen; };  // new image length (0 until header parsed)
+    uint32_t     Out()   const { return mOut; };     // bytes reconstructed so far
+
+private:
+    enum STATE : uint8_t {
+        HEADER,  // collecting header in mHead
+        OP,      // collecting op in mHead
+        DATA,    // data of 'a' or 'd'
+    };
+
+    const char * Header();
+    const char * Op();
+    const char * Copy( uint32_t len );
+    const char * Data( const uint8_t * in, uint16_t len );
+    bool         Flush();
+    uint8_t    * Reserve( uint16_t & len );  // space in mBuf: len reduced to what fits
+    static uint32_t U32( const uint8_t * p ) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); };
+
+    const esp_partition_t * mBase;
+    Sink                    mSink;
+    void                  * mCtx;
+    uint8_t               * mBuf     { 0 };     // output staging
+    uint16_t                mBufPos  { 0 };
+    uint8_t                 mHead[HeaderLen];   // header or op
+    uint8_t                 mHeadPos { 0 };
+    STATE                   mState   { HEADER };
+    char                    mOp      { 0 };
+    uint32_t                mLen     { 0 };     // remaining data of current op
+    uint32_t                mOldPos  { 0 };     // old image offset of current op
+    uint32_t                mOldLen  { 0 };
+    uint32_t                mNewLen  { 0 };
+    uint32_t                mOut     { 0 };
+    uint8_t                 mNewHash[HashLen];
+    mbedtls_sha256_context  mSha;
+    const char            * mError   { 0 };     // sticky
+};
@@ -0,0 +1,235 @@
+/*
+ * EventStream.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "EventStream.h"
+
+#include <stdio.h>      // snprintf()
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>       // taskENTER_CRITICAL()
+#include <esp_log.h>
+
+#include "Payload.h"
+#include "WebServer.h"
+
+extern "C" {
+
+esp_err_t handler_get_events( httpd_req_t * req );
+void      events_flush(  void * arg );
+void      events_closed( void * ctx );
+
+}
+
+namespace
+{
+const char * const TAG = "EventStream";
+EventStream        s_EventStream{};
+
+const httpd_uri_t uri_events = { .uri = "/events", .method = HTTP_GET, .handler = handler_get_events, .user_ctx = 0 };
+
+// no content length: the response ends on closing the socket
+const char s_head[] = "HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/event-stream\r\n"
+                      "Cache-Control: no-cache\r\n"
+                      "Connection: keep-alive\r\n"
+                      "Access-Control-Allow-Origin: *\r\n"
+                      "\r\n"
+                      "retry: 3000\n\n";  // reconnect after 3s
+
+const char s_busy[] = "too many event subscribers";
+
+uint16_t const FrameMax = sizeof("event: \ndata: \n\n") - 1 + EventStream::NameLen + EventStream::DataLen;
+}
+
+EventStream & EventStream::Instance()
+{
+    return s_EventStream;
+}
+
+void EventStream::Init( WebServer & webserver )
+{
+    mServer = webserver.Server();
+    webserver.AddUri( uri_events );
+}
+
+void EventStream::Post( const char * event, const char * data )
+{
+    bool queue = false;
+
+    taskENTER_CRITICAL();
+    ++mStats.posted;
+    uint8_t i = 0;  // slots get never freed: first empty slot ends the search
+    while ((i < MaxEvents) && mSlot[i].name[0] && strncmp( mSlot[i].name, event, NameLen - 1 ))
+        ++i;
+    if (i < MaxEvents) {
+        Slot & slot = mSlot[i];
+        if (! slot.name[0])
+            strncpy( slot.name, event, NameLen - 1 );
+        if (slot.pending)
+            ++mStats.coalesced;
+        strncpy( slot.data, data, DataLen - 1 );
+        slot.data[DataLen - 1] = 0;
+        slot.pending = true;
+        if (mNofClients && ! mQueued) {
+            mQueued = true;
+            queue = true;
+        }
+    } else {
+        ++mStats.noslot;
+    }
+    taskEXIT_CRITICAL();
+
+    if (queue && (httpd_queue_work( mServer, events_flush, 0 ) != ESP_OK)) {
+        ESP_LOGE( TAG, "cannot queue flush of \"%s\"", event );
+        mQueued = false;
+    }
+}
+
+void EventStream::Post( const char * event, long val, uint8_t decimals )
+{
+    Payload<16> p;
+    p.Add( val, decimals );
+    Post( event, p.c_str() );
+}
+
+uint16_t EventStream::Frame( char * buf, uint16_t size, const Slot & slot )
+{
+    int const len = snprintf( buf, size, "event: %s\ndata: %s\n\n", slot.name, slot.data );
+    return (len < 0) ? 0 : ((len < size) ? (uint16_t) len : (uint16_t) (size - 1));
+}
+
+bool EventStream::Send( int fd, const char * buf, uint16_t len )
+{
+    return httpd_socket_send( mServer, fd, buf, len, 0 ) == (int) len;
+}
+
+void EventStream::Drop( uint8_t client )
+{
+    int const fd = mClient[client];
+    mClient[client] = mClient[--mNofClients];
+    ++mStats.failed;
+    ESP_LOGW( TAG, "send to socket %d failed - %d subscriber(s) left", fd, mNofClients );
+    httpd_sess_trigger_close( mServer, fd );  // Closed() will not find it anymore
+}
+
+void EventStream::Subscribe( httpd_req_t * req )
+{
+    if (! mServer)
+        mServer = req->handle;
+
+    if (mNofClients >= MaxClients) {
+        ++mStats.rejected;
+        ESP_LOGW( TAG, "subscriber rejected: %d subscribers", mNofClients );
+        httpd_resp_set_status( req, "503 Service Unavailable" );
+        httpd_resp_send( req, s_busy, sizeof(s_busy) - 1 );
+        return;
+    }
+    int const fd = httpd_req_to_sockfd( req );
+    int * ctx = (int *) malloc( sizeof(int) );
+    if (! ctx) {
+        ESP_LOGE( TAG, "no memory for session context" );
+        return;
+    }
+    if (! Send( fd, s_head, sizeof(s_head) - 1 )) {
+        free( ctx );
+        return;
+    }
+    *ctx = fd;
+    req->sess_ctx = ctx;            // session keeps open after return
+    req->free_ctx = events_closed;  // called on session delete
+
+    // snapshot: last data of all events
+    char buf[256];
+    uint16_t len = 0;
+    for (uint8_t i = 0; i < MaxEvents; ++i) {
+        Slot slot;
+        taskENTER_CRITICAL();
+        slot = mSlot[i];
+        taskEXIT_CRITICAL();
+        if (! slot.name[0])
+            break;
+        if ((size_t) (len + FrameMax) > sizeof(buf)) {
+            Send( fd, buf, len );
+            len = 0;
+        }
+        len += Frame( & buf[len], sizeof(buf) - len, slot );
+    }
+    if (len)
+        Send( fd, buf, len );
+
+    mClient[mNofClients++] = fd;
+    ESP_LOGI( TAG, "socket %d subscribed - %d subscriber(s)", fd, mNofClients );
+}
+
+void EventStream::Closed( int fd )
+{
+    for (uint8_t client = 0; client < mNofClients; ++client)
+        if (mClient[client] == fd) {
+            mClient[client] = mClient[--mNofClients];
+            ESP_LOGI( TAG, "socket %d closed - %d subscriber(s) left", fd, mNofClients );
+            return;
+        }
+}
+
+void EventStream::Flush()
+{
+    mQueued = false;  // posts from now on queue another flush
+
+    char     buf[256];
+    uint16_t len    = 0;
+    uint16_t events = 0;
+    for (uint8_t i = 0; i <= MaxEvents; ++i) {
+        Slot slot;
+        if (i < MaxEvents) {
+            taskENTER_CRITICAL();
+            slot = mSlot[i];
+            mSlot[i].pending = false;
+            taskEXIT_CRITICAL();
+        } else {
+            slot.name[0] = 0;  // end: send rest
+        }
+        if (slot.name[0] && ! slot.pending)
+            continue;
+        if (len && ((! slot.name[0]) || ((size_t) (len + FrameMax) > sizeof(buf)))) {
+            for (uint8_t client = mNofClients; client--; ) {
+                if (Send( mClient[client], buf, len ))
+                    mStats.sent += events;
+                else
+                    Drop( client );
+            }
+            len    = 0;
+            events = 0;
+        }
+        if (! slot.name[0])
+            break;
+        len += Frame( & buf[len], sizeof(buf) - len, slot );
+        ++events;
+    }
+}
+
+/////////////////// extern "C" ///////////////////
+
+extern "C" {
+
+esp_err_t handler_get_events( httpd_req_t * req )
+{
+    s_EventStream.Subscribe( req );
+    return ESP_OK;
+}
+
+void events_flush( void * arg )
+{
+    s_EventStream.Flush();
+}
+
+void events_closed( void * ctx )
+{
+    s_EventStream.Closed( *(int *) ctx );
+    free( ctx );
+}
+
+}
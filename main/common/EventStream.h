@@ -0,0 +1,73 @@
+/*
+ * EventStream.h
+ *
+ * server-sent events on /events (text/event-stream) of the WebServer instance:
+ * - any task calls Post( event, data ) on a new value (analog sample, temperature, mode, relay)
+ * - each event name has one slot holding the latest data: a value posted again
+ *   before the slot was sent replaces the pending one (coalesced)
+ * - the slots get sent by the httpd task (httpd_queue_work) to all subscribers
+ * - a new subscriber gets the last data of all events first
+ * at most MaxClients subscribers (503 otherwise); a failing send drops the subscriber
+ *
+ *   EventStream::Instance().Post( "analog", value );
+ *   EventStream::Instance().Post( "tempA", lroundf( temperature * 10 ), 1 );
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <esp_http_server.h>
+
+class WebServer;
+
+class EventStream
+{
+public:
+    static constexpr uint8_t MaxClients = 3;
+    static constexpr uint8_t MaxEvents  = 12;   // # of slots (different event names)
+    static constexpr uint8_t NameLen    = 12;   // incl. termination
+    static constexpr uint8_t DataLen    = 40;   // incl. termination
+
+    struct Stats {
+        uint32_t posted;     // Post calls
+        uint32_t coalesced;  // pending data replaced
+        uint32_t sent;       // events sent (per client)
+        uint16_t noslot;     // event names dropped: all slots in use
+        uint16_t rejected;   // subscribers rejected: MaxClients reached
+        uint16_t failed;     // subscribers dropped on send error
+    };
+
+    EventStream() {};
+    static EventStream & Instance();
+
+    void Init( WebServer & webserver );  // registers /events
+
+    void Post( const char * event, const char * data );         // by any task
+    void Post( const char * event, long val, uint8_t decimals = 0 );
+
+    void Subscribe( httpd_req_t * req );  // by httpd task
+    void Closed( int fd );                // by httpd task: session deleted
+    void Flush();                         // by httpd task: send pending slots
+
+    uint8_t       Clients()  const { return mNofClients; };
+    const Stats & GetStats() const { return mStats; };
+
+private:
+    struct Slot {
+        char name[NameLen];
+        char data[DataLen];
+        bool pending;
+    };
+
+    bool Send( int fd, const char * buf, uint16_t len );
+    void Drop( uint8_t client );
+    static uint16_t Frame( char * buf, uint16_t size, const Slot & slot );
+
+    httpd_handle_t mServer     { 0 };
+    Slot           mSlot[MaxEvents] {};
+    int            mClient[MaxClients];  // socket fds
+    uint8_t        mNofClients { 0 };
+    bool           mQueued     { false };  // flush work queued to httpd task
+    Stats          mStats      {};
+};
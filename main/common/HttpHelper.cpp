@@ -8,80 +8,224 @@
 #include <iomanip>
 
 #include <math.h>   // pow()
+#include <stdlib.h> // malloc(), free()
+#include <string.h>
+#include <vector>
+#include <esp_timer.h>  // esp_timer_get_time()
+#include <esp_system.h> // esp_get_free_heap_size()
 #include <esp_log.h>
 
 #include "HttpHelper.h"
 #include "Wifi.h"
 #include "WebServer.h"
+#include "Assets.h"
 
 namespace {
 const char * TAG = "HttpHelper";
+
+char            * s_pool[HttpHelper::PoolLen] {};  // allocated on first use - never freed
+bool              s_poolUsed[HttpHelper::PoolLen] {};
+HttpHelper::Stats s_stats {};
+
+struct HeadItem {
+    const char * naviText;
+    uint16_t     activeAt;  // offset in nav to insert the active marker
+};
+struct {
+    bool                  valid  { false };
+    std::string           prefix {};  // style and title up to host name
+    std::string           nav    {};  // end of head, body start and menu
+    std::vector<HeadItem> items  {};
+}                 s_head;
+uint32_t          s_headUs { 0 };  // [us] duration of last Head()
+uint32_t          s_heapLow { 0 };  // min. free heap since HeapLowReset()
+
+void heapSample()
+{
+    uint32_t const heap = esp_get_free_heap_size();
+    if (s_heapLow > heap)
+        s_heapLow = heap;
+}
 }
 
-HttpHelper::HttpHelper( httpd_req_t * req, const char * h2text, const char * navitext )
+HttpHelper::HttpHelper( httpd_req_t * req, const char * h2text, const char * navitext, uint16_t chunkSize )
     : mReq      { req }
     , mH2Text   { h2text }
     , mNaviText { navitext }
 {
-    mBuf.reserve(1024);
+    if (chunkSize <= ChunkSize) {
+        taskENTER_CRITICAL();
+        for (int8_t i = 0; i < PoolLen; ++i)
+            if (! s_poolUsed[i]) {
+                s_poolUsed[i] = true;
+                mPoolIdx = i;
+                break;
+            }
+        taskEXIT_CRITICAL();
+        if (mPoolIdx >= 0) {
+            if (! s_pool[mPoolIdx])
+                s_pool[mPoolIdx] = (char *) malloc( ChunkSize );
+            mBuf = s_pool[mPoolIdx];
+            if (! mBuf) {  // release the slot: the fallback buffer below gets freed by destructor
+                s_poolUsed[mPoolIdx] = false;
+                mPoolIdx = -1;
+            }
+        }
+    }
+    if (! mBuf) {
+        ++s_stats.poolMiss;
+        mBuf = (char *) malloc( chunkSize );
+    }
+    if (mBuf)
+        mCap = chunkSize;
+    else
+        ESP_LOGE( TAG, "no chunk buffer - response will be sent in pieces" );
 }
 
 HttpHelper::~HttpHelper()
 {
-    Add( "\n </body>\n</html>\n" );
+    if (! mRaw)
+        Add( "\n </body>\n</html>\n" );
     if (! mChunks) {
-        if (mBuf.length())
-            httpd_resp_send( mReq, mBuf.c_str(), mBuf.length() );
+        if (mLen) {
+            httpd_resp_send( mReq, mBuf, mLen );
+            ++mChunkCnt;
+            mBytes += mLen;
+        }
     } else {
-        if (mBuf.length())
-            httpd_resp_send_chunk( mReq, mBuf.c_str(), mBuf.length() );
-
+        Flush();
         httpd_resp_send_chunk( mReq, 0, 0 );
     }
+    heapSample();  // chunk buffer still allocated
+    ESP_LOGD( TAG, "response of %u bytes in %u chunks", mBytes, mChunkCnt );
+    ++s_stats.responses;
+    s_stats.chunks += mChunkCnt;
+    s_stats.bytes  += mBytes;
+    if (s_stats.maxChunks < mChunkCnt)
+        s_stats.maxChunks = mChunkCnt;
+
+    if (mPoolIdx >= 0)
+        s_poolUsed[mPoolIdx] = false;
+    else
+        free( mBuf );
+}
+
+void HttpHelper::Raw( const char * type )
+{
+    mRaw = true;
+    httpd_resp_set_type( mReq, type );
+}
+
+const HttpHelper::Stats & HttpHelper::GetStats()
+{
+    return s_stats;
+}
+
+void HttpHelper::Sent( uint32_t bytes )
+{
+    ++s_stats.responses;
+    s_stats.bytes += bytes;
+    heapSample();
+}
+
+void HttpHelper::HeapLowReset()
+{
+    s_heapLow = esp_get_free_heap_size();
+}
+
+uint32_t HttpHelper::HeapLow()
+{
+    heapSample();
+    return s_heapLow;
+}
+
+void HttpHelper::Flush()
+{
+    if (! mLen)
+        return;
+    httpd_resp_send_chunk( mReq, mBuf, mLen );
+    heapSample();
+    mChunks = true;
+    ++mChunkCnt;
+    mBytes += mLen;
+    mLen = 0;
+}
+
+void HttpHelper::InvalidateHead()
+{
+    s_head.valid = false;
+}
+
+uint32_t HttpHelper::HeadUs()
+{
+    return s_headUs;
+}
+
+void HttpHelper::BuildHead()
+{
+    // everything behind the title text, which does not depend on the request:
+    // just the offset of each menu item is kept to insert the active marker
+    uint32_t const start = (uint32_t) esp_timer_get_time();
+    const char * const host  = Wifi::Instance().GetHost();
+    const char * const color = Wifi::Instance().GetBgCol();
+
+    // style and script as cacheable assets (versioned urls)
+    s_head.prefix  = "  <link rel=\"stylesheet\" href=\"";
+    s_head.prefix += Assets::Url( "style.css" );
+    s_head.prefix += "\">\n"
+                     "  <script src=\"";
+    s_head.prefix += Assets::Url( "live.js" );
+    s_head.prefix += "\" defer></script>\n"
+                     "  <title>";
+    s_head.prefix += host;
+
+    std::string & nav = s_head.nav;
+    nav = "</title>\n"
+          " </head>\n"
+          " <body style=\"background-color:";
+    nav += (color && *color) ? color : "lightblue";
+    nav += ";\">\n"
+           "  <h1>";
+    nav += host;
+    nav += "</h1>\n"
+           "  <div style=\"float: right;\">"
+           "   <ul>\n";
+    s_head.items.clear();
+    for (WebServer::PageList const * pagelist = WebServer::Instance().GetPageList();
+            pagelist;
+            pagelist = pagelist->Next)
+    {
+        if (! pagelist->Page.NaviText)  // "hidden"
+            continue;
+        nav += "   <li><a href=\"";
+        nav += pagelist->Page.Uri.uri;
+        nav += "\"";
+        s_head.items.push_back( { pagelist->Page.NaviText, (uint16_t) nav.length() } );
+        nav += ">";
+        nav += pagelist->Page.NaviText;
+        nav += "</a></li>\n";
+    }
+    nav += "   </ul>\n"
+           "  </div>"
+           "  <div style=\"clear: both\"></div>\n";
+    s_head.valid = true;
+    ESP_LOGI( TAG, "head cache rebuilt in %u us (%u + %u bytes)", (uint32_t) esp_timer_get_time() - start,
+                   s_head.prefix.length(), nav.length() );
 }
 
 void HttpHelper::Head( const char * meta )
 {
+    uint32_t const start = (uint32_t) esp_timer_get_time();
     mInHead = true;
+    if (! s_head.valid)
+        BuildHead();
+
     Add( "<!DOCTYPE html>\n"
          "<html>\n"
          " <head><meta charset=\"utf-8\"/>\n" );
     if (meta)
         Add( meta );
-    Add( "\n\
-  <style>\n\
-   h1 { float: left; }\n\
-   ul { list-style-type: none; }\n\
-   li {\n\
-    float: left;\n\
-    display: block;\n\
-    min-height: 48px;\n\
-   }\n\
-   li a {\n\
-    padding: 8px;\n\
-    margin: 8px;\n\
-    border: 2px;\n\
-    border-radius: 5px;\n\
-    border-color: #ee4;\n\
-    background-color: #ee4;\n\
-   }\n\
-   li a:hover:not(.active) {\n\
-    border-color: #008;\n\
-    background-color: #008;\n\
-    color: #fff;\n\
-   }\n\
-   li a.active {\n\
-    border-color: #088;\n\
-    background-color: #088;\n\
-    color: #fff;        \n\
-    text-decoration: none;\n\
-   }\n\
-  </style>\n" );
-
-    const char * host = Wifi::Instance().GetHost();
-
-    Add( "  <title>" );
-    Add( host );
+    Add( s_head.prefix );
     if (mNaviText) {
         Add( "-" );
         Add( mNaviText );
@@ -89,36 +233,19 @@ void HttpHelper::Head( const char * meta )
         Add( "-" );
         Add( mH2Text );
     }
-    {
-        const char * const color = Wifi::Instance().GetBgCol();
-        Add( "</title>\n"
-            " </head>\n"
-            " <body style=\"background-color:" );
-        if (color && *color)
-            Add( color );
-        else
-            Add( "lightblue" );
-        Add( ";\">\n" );
-    }
-    Add( "  <h1>" );
-    Add( host );
-    Add( "</h1>\n" );
-    Add( "  <div style=\"float: right;\">" );
-    Add( "   <ul>\n" );
-    for (WebServer::PageList const * pagelist = WebServer::Instance().GetPageList();
-            pagelist;
-            pagelist = pagelist->Next)
-    {
-        if (! pagelist->Page.NaviText)  // "hidden"
-            continue;
-        Add( (std::string) "   <li><a href=\"" + pagelist->Page.Uri.uri + "\"" );
-        if (mNaviText && (strcmp( mNaviText, pagelist->Page.NaviText ) == 0))
-            Add( " class=\"active\"" );
-        Add( (std::string) ">" + pagelist->Page.NaviText + "</a></li>\n" );
-    }
-    Add( "   </ul>\n" );
-    Add( "  </div>" );
-    Add( "  <div style=\"clear: both\"></div>\n" );
+
+    const std::string & nav = s_head.nav;
+    uint16_t done = 0;
+    if (mNaviText)
+        for (const HeadItem & item : s_head.items)
+            if (strcmp( mNaviText, item.naviText ) == 0) {
+                Add( nav.c_str(), item.activeAt );
+                Add( " class=\"active\"" );
+                done = item.activeAt;
+                break;
+            }
+    Add( nav.c_str() + done, nav.length() - done );
+
     if (mH2Text) {
         Add( "  <h2>" );
         Add( mH2Text );
@@ -126,19 +253,32 @@ void HttpHelper::Head( const char * meta )
     }
 
     mInHead = false;
+    s_headUs = (uint32_t) esp_timer_get_time() - start;
 }
 
 void HttpHelper::Add( const char * str, std::size_t len )
 {
-    if (! (mBuf.length() || mChunks || mInHead))
+    if (! (mLen || mChunks || mInHead || mRaw))
         Head();
 
-    if ((mBuf.length() + len) >= mBuf.capacity()) {
-        httpd_resp_send_chunk( mReq, mBuf.c_str(), mBuf.length() );
+    if (! mCap) {  // no buffer: send directly
+        httpd_resp_send_chunk( mReq, str, len );
         mChunks = true;
-        mBuf.clear();
+        ++mChunkCnt;
+        mBytes += len;
+        return;
+    }
+    while (len) {
+        size_t part = mCap - mLen;
+        if (part > len)
+            part = len;
+        memcpy( & mBuf[mLen], str, part );
+        mLen += part;
+        str  += part;
+        len  -= part;
+        if (mLen == mCap)
+            Flush();
     }
-    mBuf.append( str, len );
 }
 
 std::string HttpHelper::String( long val, int minLength )
@@ -1,5 +1,9 @@
 /*
  * HttpHelper.h
+ *
+ * response writer: page content is collected in a fixed size chunk buffer,
+ * which is sent as one chunk each time it is full (no reallocation)
+ * buffers of ChunkSize come from a small pool shared by concurrent requests
  */
 
 #pragma once
@@ -13,9 +17,22 @@ class HttpHelper
 {
     HttpHelper();
 public:
-    HttpHelper( httpd_req_t * req, const char * h2text = 0, const char * navitext = 0 );
+    static constexpr uint16_t ChunkSize = 1436;  // fits one tcp segment incl. chunk framing
+    static constexpr uint8_t  PoolLen   = 2;     // # of pooled chunk buffers
+
+    struct Stats {
+        uint32_t responses { 0 };
+        uint32_t chunks    { 0 };  // # of httpd_resp_send(_chunk) calls with data
+        uint32_t bytes     { 0 };
+        uint16_t maxChunks { 0 };  // max. # of chunks of one response
+        uint16_t poolMiss  { 0 };  // # of buffers allocated beside the pool
+    };
+
+    HttpHelper( httpd_req_t * req, const char * h2text = 0, const char * navitext = 0,
+                uint16_t chunkSize = ChunkSize );
     ~HttpHelper();
     void Head( const char * meta = 0 );
+    void Raw( const char * type );  // no html head/foot: content of given type (before 1st Add)
 
     void Add( const char        * str )       { Add( str, strlen( str ) ); }
     void Add( const std::string & str )       { Add( str.c_str(), str.length() ); }
@@ -23,6 +40,17 @@ public:
     void Add( double val, int precision = 0 ) { Add( String( val, precision ) ); }
 
     void Add( const char * str, std::size_t len );
+    void Flush();  // send buffered content as chunk
+
+    httpd_req_t * Req() const { return mReq; };
+    uint16_t Chunks() const { return mChunkCnt; };  // chunks sent so far
+    uint32_t Bytes()  const { return mBytes; };     // bytes sent so far
+    static const Stats & GetStats();
+    static void Sent( uint32_t bytes );  // response sent without HttpHelper
+    static void     HeapLowReset();  // start sampling free heap (at each chunk and response end)
+    static uint32_t HeapLow();       // min. free heap since HeapLowReset()
+    static void InvalidateHead();  // menu, host name or background color changed
+    static uint32_t HeadUs();  // [us] duration of last Head()
 
     static char * I2A( char * buf, size_t bufSize, int val );
 
@@ -34,10 +62,18 @@ public:
     static std::string HexString( uint64_t val, int minLength = 16 );
 
 private:
+    static void BuildHead();
+
     bool                mChunks { false };
     bool                mInHead { false };
+    bool                mRaw    { false };
     httpd_req_t * const mReq;
     const char        * mH2Text;    // text to display as h2
     const char        * mNaviText;  // to select active menu item (0, when not in menu)
-    std::string         mBuf {};
+    char              * mBuf      { 0 };
+    uint16_t            mCap      { 0 };  // flush when full
+    uint16_t            mLen      { 0 };
+    int8_t              mPoolIdx  { -1 };  // -1: own buffer
+    uint16_t            mChunkCnt { 0 };
+    uint32_t            mBytes    { 0 };
 };
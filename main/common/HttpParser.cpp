@@ -5,6 +5,9 @@
 
 #include "HttpParser.h"
 
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>
+
 #include "esp_log.h"   			// ESP_LOGI()
 
 #define min(a,b) ((a) < (b) ? a : b)
@@ -12,6 +15,85 @@
 namespace
 {
 const char * const TAG = "HttpParser";
+
+char * skipSpace( char * cp )
+{
+    while ((*cp == ' ') || (*cp == '\t') || (*cp == '\r') || (*cp == '\n'))
+        ++cp;
+    return cp;
+}
+
+// unescape json string in place: cp behind opening quote
+// returns position behind closing quote (0 on error), end of unescaped string in *end
+char * jsonString( char * cp, char ** end )
+{
+    char * dst = cp;
+    while (*cp != '"') {
+        if (! *cp)
+            return nullptr;
+        if (*cp != '\\') {
+            *dst++ = *cp++;
+            continue;
+        }
+        switch (*++cp) {
+            case 'b': *dst++ = '\b'; break;
+            case 'f': *dst++ = '\f'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'u':  // no unicode support: keep ascii, others as '?'
+                {
+                    unsigned long const code = strtoul( cp + 1, 0, 16 );
+                    for (uint8_t i = 0; (i < 4) && cp[1]; ++i)
+                        ++cp;
+                    *dst++ = (code && (code < 0x80)) ? (char) code : '?';
+                }
+                break;
+            case 0:   return nullptr;
+            default:  *dst++ = *cp; break;  // " \ /
+        }
+        ++cp;
+    }
+    *end = dst;
+    return cp + 1;
+}
+
+// FNV-1a
+uint8_t hashKey( const char * key, size_t len )
+{
+    uint32_t hash = 0x811c9dc5;
+    while (len--)
+        hash = (hash ^ (uint8_t) *key++) * 0x01000193;
+    return (uint8_t) (hash ^ (hash >> 8) ^ (hash >> 16));
+}
+
+int hexDigit( char c )
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    c |= 0x20;  // lower case
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+}
+
+HttpParser::HttpParser( Input * inArray, const uint8_t nofFields )
+    : mInArray   { inArray },
+      mNofFields { nofFields }
+{
+    if (nofFields > MaxFields)
+        ESP_LOGE( TAG, "%d fields - just %d supported", nofFields, MaxFields );
+
+    for (uint8_t i = 0; (i < nofFields) && (i < MaxFields); ++i) {
+        if (! inArray[i].key)
+            continue;
+        uint8_t h = hashKey( inArray[i].key, strlen( inArray[i].key ) ) & (HashSize - 1);
+        while (mHash[h])
+            h = (h + 1) & (HashSize - 1);
+        mHash[h] = i + 1;
+    }
 }
 
 const char * HttpParser::ParseUriParam( httpd_req_t * req )
@@ -19,17 +101,8 @@ const char * HttpParser::ParseUriParam( httpd_req_t * req )
     const char * str = strchr( req->uri, '?' );
     if (str) {
         ++str;
-        const char * const strend = strchr( str, 0 );
-        while (str < strend) {
-            const char * ampersand = strchr( str + 2, '&' );
-            if (! ampersand)
-                ampersand = strend;
-            const char * const parseErr = Parse( str, ampersand );
-            if (parseErr)
-                return parseErr;
-
-            str = ampersand + 1;
-        }
+        Feed( str, strlen( str ) );
+        Finish();
     }
 
     ClearUnparsed();
@@ -38,97 +111,272 @@ const char * HttpParser::ParseUriParam( httpd_req_t * req )
 
 const char * HttpParser::ParsePostData( httpd_req_t * req )
 {
-    char buf[100];
-    char * readend = buf;
-    char * const bufend = &buf[sizeof(buf) - 1];
-    int remaining = req->content_len;
-
-    while (remaining || (readend != buf)) {
-        int rest = bufend - readend;
-        if (remaining && rest) {
-            int readlen = httpd_req_recv( req, readend,
-                                          min( remaining, rest ) );
-            if (readlen <= 0) {
-                if (readlen == HTTPD_SOCK_ERR_TIMEOUT) {
-                    continue;  // Retry receiving if timeout occurred
-                }
-                ESP_LOGE( TAG, "httpd_req_recv failed with %d", readlen );
-                return "subsequentail httpd_req_recv failed";
+    char buf[RecvLen];
+    size_t remaining = req->content_len;
+    bool first = true;
+
+    while (remaining) {
+        int readlen = httpd_req_recv( req, buf, min( remaining, sizeof(buf) ) );
+        if (readlen <= 0) {
+            if (readlen == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;  // Retry receiving if timeout occurred
             }
-            remaining -= readlen;
-            readend += readlen;
-            *readend = 0;
+            ESP_LOGE( TAG, "httpd_req_recv failed with %d", readlen );
+            return "subsequentail httpd_req_recv failed";
         }
-        const char * ampersand = strchr( buf + 2, '&' );
-        if (! ampersand)
-            ampersand = readend;
-
-        ESP_LOGD( TAG, "Parse( \"%.*s\" / ampersand at offset %d )", readend-buf,buf, ampersand-buf );
-        const char * const parseErr = Parse( buf, ampersand );
-        if (parseErr)
-            return parseErr;
-
-        if (ampersand != readend) {
-            uint8_t move = readend - ampersand;  // incl. \0
-            memmove( buf, ampersand + 1, move );
-            readend = &buf[move - 1];
-        } else
-            readend = buf;
-    } // while remaining || readend != buf
+        remaining -= readlen;
+        int i = 0;
+        if (first) {  // leading white space (may span several receives) is skipped
+            while ((i < readlen) && ((buf[i] == ' ') || (buf[i] == '\t') || (buf[i] == '\r') || (buf[i] == '\n')))
+                ++i;
+            if (i == readlen)
+                continue;
+            first = false;
+            if (buf[i] == '{')
+                return RecvJson( req, & buf[i], (uint16_t) (readlen - i), remaining );
+        }
+        Feed( & buf[i], readlen - i );
+    }
+    Finish();
 
     ClearUnparsed();
     return nullptr;
 }
 
-const char * HttpParser::Parse( const char * str, const char * end )
+void HttpParser::Feed( const char * data, size_t len )
+{
+    for (; len--; ++data) {
+        char const c = *data;
+        if (mEscape) {
+            int const hex = hexDigit( c );
+            if (hex >= 0) {
+                mEscVal = (uint8_t) ((mEscVal << 4) | hex);
+                if (mEscape == 2)
+                    mEscDigit = c;
+                if (! --mEscape)
+                    Put( (char) mEscVal );
+                continue;
+            }
+            Put( '%' );  // invalid escape sequence: taken as is
+            if (mEscape == 1)
+                Put( mEscDigit );
+            mEscape = 0;
+        }
+        switch (c) {
+            case '%':
+                mEscape = 2;
+                mEscVal = 0;
+                continue;
+            case '+':
+                Put( ' ' );
+                continue;
+            case '&':
+                EndField();
+                continue;
+            case '=':
+                if (mState == KEY) {
+                    EndKey();
+                    continue;
+                }
+                break;  // part of the value
+        }
+        Put( c );
+    }
+}
+
+void HttpParser::Put( char c )
+{
+    if (! c)
+        return;  // keys and values are C strings: embedded '\0' (e.g. "%00") dropped
+    switch (mState) {
+        case KEY:
+            if (mKeyLen < KeyMax)
+                mKey[mKeyLen] = c;
+            if (mKeyLen <= KeyMax)
+                ++mKeyLen;
+            break;
+        case VALUE:
+            if (mValLen < mIn->len - 1)
+                mIn->buf[mValLen++] = c;
+            else
+                mTruncated = true;
+            break;
+        case SKIP:
+            break;
+    }
+}
+
+void HttpParser::EndKey()
 {
-    const char * equalsign = strchr( str + 1, '=' );
-    if ((! equalsign) || (equalsign > end))
-        equalsign = end;
+    mIn = (mKeyLen <= KeyMax) ? Match( mKey, mKeyLen ) : nullptr;
+    if (mKeyLen > KeyMax)
+        ESP_LOGI( TAG, "parsed unknown key \"%.*s...\"", KeyMax, mKey );
+    mState  = mIn ? VALUE : SKIP;
+    mValLen = 0;
+    mTruncated = false;
+}
+
+void HttpParser::EndField()
+{
+    if ((mState == KEY) && mKeyLen)
+        EndKey();  // key without "=value"
+    if (mState == VALUE) {
+        mIn->buf[mValLen] = 0;
+        mIn->len = mValLen;
+        if (mTruncated)
+            ESP_LOGI( TAG, "value of \"%s\" truncated to %d bytes", mIn->key, mValLen );
+    }
+    mState  = KEY;
+    mKeyLen = 0;
+    mIn     = nullptr;
+}
 
-    uint8_t const keylen = (uint8_t) (equalsign - str);
+void HttpParser::Finish()
+{
+    if (mEscape) {
+        Put( '%' );
+        if (mEscape == 1)
+            Put( mEscDigit );
+        mEscape = 0;
+    }
+    EndField();
+}
 
-    for (uint8_t i = 0; i < mNofFields; ++i) {
+const char * HttpParser::RecvJson( httpd_req_t * req, const char * head, uint16_t headLen, size_t remaining )
+{
+    if (req->content_len > JsonMax)
+        return "json post data too long";
+    char * const json = (char *) malloc( req->content_len + 1 );
+    if (! json)
+        return "no memory for json post data";
+    uint16_t len = headLen;
+    memcpy( json, head, len );
+    while (remaining) {
+        int readlen = httpd_req_recv( req, & json[len], remaining );
+        if (readlen <= 0) {
+            if (readlen == HTTPD_SOCK_ERR_TIMEOUT)
+                continue;
+            ESP_LOGE( TAG, "httpd_req_recv failed with %d", readlen );
+            free( json );
+            return "subsequentail httpd_req_recv failed";
+        }
+        remaining -= readlen;
+        len += readlen;
+    }
+    json[len] = 0;
+    const char * const parseErr = ParseJson( json );
+    free( json );
+    if (parseErr)
+        return parseErr;
+    ClearUnparsed();
+    return nullptr;
+}
+
+HttpParser::Input * HttpParser::Match( const char * key, size_t keylen )
+{
+    for (uint8_t h = hashKey( key, keylen ) & (HashSize - 1); mHash[h]; h = (h + 1) & (HashSize - 1)) {
+        uint8_t const i = mHash[h] - 1;
         Input * const in = & mInArray[i];
-        if (strncmp( str, in->key, keylen ) || in->key[keylen])
+        if (strncmp( key, in->key, keylen ) || in->key[keylen])
             continue;
 
         // key match:
 
         if (mFieldsParsed & (1 << i)) {
-            ESP_LOGI( TAG, "parsed duplicate key \"%.*s\"", keylen, str );
+            ESP_LOGI( TAG, "parsed duplicate key \"%.*s\"", (int) keylen, key );
             return nullptr;  // silently skip duplicate fields
         }
 
         mFieldsParsed |= 1 << i;
         if (! (in->buf && in->len))
             return nullptr;
-        char * bp = in->buf;
-        for (const char * val = equalsign + 1; val < end; ++val) {
-            if ((*val == '%') && ((val+2) < end)) {
-                *bp = (((val[1] + ((val[1] >> 6) & 1) * 9) & 0xf) << 4)
-                     | ((val[2] + ((val[2] >> 6) & 1) * 9) & 0xf);
-                val += 2;
-            } else if (*val == '+')
-                *bp = ' ';
-            else
-                *bp = *val;
-            ++bp;
-            if (bp >= & in->buf[in->len - 1])
-                break;
-        }
-        *bp = 0;
-        in->len = bp - in->buf;
-        return nullptr;
+        return in;
     }
-    ESP_LOGI( TAG, "parsed unknown key \"%.*s\"", keylen, str );
+    ESP_LOGI( TAG, "parsed unknown key \"%.*s\"", (int) keylen, key );
     return nullptr;  // silently skip unknown fields
 }
 
+const char * HttpParser::ParseJson( char * cp )
+{
+    mJson = true;
+    cp = skipSpace( cp );
+    if (*cp != '{')
+        return "json: '{' expected";
+    cp = skipSpace( cp + 1 );
+    if (*cp == '}')
+        return nullptr;
+
+    while (true) {
+        if (*cp != '"')
+            return "json: key expected";
+        char * const key = cp + 1;
+        char * keyend;
+        cp = jsonString( key, & keyend );
+        if (! cp)
+            return "json: unterminated key";
+        cp = skipSpace( cp );
+        if (*cp != ':')
+            return "json: ':' expected";
+        cp = skipSpace( cp + 1 );
+
+        const char * val = cp;
+        const char * valend;
+        if (*cp == '"') {
+            char * strend;
+            val = cp + 1;
+            cp = jsonString( cp + 1, & strend );
+            if (! cp)
+                return "json: unterminated string";
+            valend = strend;
+        } else if ((*cp == '{') || (*cp == '[')) {
+            return "json: nested values not supported";
+        } else {
+            while (*cp && (*cp != ',') && (*cp != '}') && (*cp != ' ') && (*cp != '\t')
+                       && (*cp != '\r') && (*cp != '\n'))
+                ++cp;
+            valend = cp;
+            size_t const toklen = valend - val;
+            if (! toklen)
+                return "json: value expected";
+            if ((toklen == 4) && ! strncmp( val, "true", 4 ))
+                val = "1";
+            else if ((toklen == 5) && ! strncmp( val, "false", 5 ))
+                val = "0";
+            else if ((toklen == 4) && ! strncmp( val, "null", 4 ))
+                val = "";
+            else if (strspn( val, "+-.0123456789eE" ) < toklen)
+                return "json: invalid value";
+            if (val != valend - toklen)  // keyword replaced
+                valend = strchr( val, 0 );
+        }
+
+        Input * const in = Match( key, keyend - key );
+        if (in) {
+            size_t len = valend - val;
+            if (len > (size_t) (in->len - 1))
+                len = in->len - 1;
+            memmove( in->buf, val, len );
+            in->buf[len] = 0;
+            in->len = len;
+        }
+
+        cp = skipSpace( cp );
+        if (*cp == '}')
+            return nullptr;
+        if (*cp != ',')
+            return "json: ',' or '}' expected";
+        cp = skipSpace( cp + 1 );
+    }
+}
+
 void HttpParser::ClearUnparsed()
 {
-    for (uint8_t i = 0; i < mNofFields; ++i)
+    for (uint8_t i = 0; (i < mNofFields) && (i < MaxFields); ++i)
         if (! (mFieldsParsed & (1 << i))) {
+            if (mJson) {  // keep default
+                mInArray[i].len = mInArray[i].buf ? strlen( mInArray[i].buf ) : 0;
+                continue;
+            }
             mInArray[i].len = 0;
             if (mInArray[i].buf)
                 mInArray[i].buf[0] = 0;
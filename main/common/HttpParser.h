@@ -1,7 +1,16 @@
 /*
  * HttpParser.h
+ *
+ * post data may be url encoded (html form) or a flat json object (api):
+ * - form:  parsed incrementally as received (no limit of field length),
+ *          values get truncated to the buffer size, keys dispatched by hash table,
+ *          fields not posted get cleared (unchecked checkbox)
+ * - json:  fields not posted keep their buffer content (prefilled defaults),
+ *          values true/false/null are stored as "1"/"0"/"", nested values are refused
  */
 
+#pragma once
+
 #include <esp_http_server.h>    // httpd_req_t
 
 class HttpParser
@@ -10,29 +19,58 @@ public:
     struct Input {
         const char * key;  // field name
         char       * buf;  // buffer
-        uint8_t      len;  // input to parse: buf size / output: length
+        uint16_t     len;  // input to parse: buf size / output: length
         Input() : key{0}, buf{0}, len{0} {};
-        Input( const char * akey, char * abuf, uint8_t size ) : key{akey}, buf{abuf}, len{size}
+        Input( const char * akey, char * abuf, uint16_t size ) : key{akey}, buf{abuf}, len{size}
         {
             if (buf)
                 *buf = 0;
         };
     };
-    HttpParser( Input * inArray, const uint8_t nofFields )
-        : mInArray      { inArray },
-          mNofFields    { nofFields },
-          mFieldsParsed { 0 }
-    {
-    };
+    static constexpr uint16_t JsonMax   = 1024;  // max. content length of json post data
+    static constexpr uint8_t  MaxFields = 32;    // bits of Fields()
+    static constexpr uint8_t  HashSize  = 64;    // key hash table (power of 2 > MaxFields)
+    static constexpr uint8_t  KeyMax    = 32;    // longer keys are unknown keys
+    static constexpr uint16_t RecvLen   = 128;   // receive buffer on stack
+
+    HttpParser( Input * inArray, const uint8_t nofFields );
 
     const char * ParsePostData( httpd_req_t * req );
     const char * ParseUriParam( httpd_req_t * req );
     uint32_t     Fields() { return mFieldsParsed; };  // +fields without ...=value
+    bool         Json()   { return mJson; };          // post data was json
 private:
-    const char * Parse( const char * str, const char * end );
+    enum STATE : uint8_t {
+        KEY,    // collecting key in mKey
+        VALUE,  // storing value into mIn->buf
+        SKIP,   // value of unknown or duplicate key
+    };
+
+    // url encoded: bytes as received - decoded in place, no matter how split
+    void         Feed( const char * data, size_t len );
+    void         Put( char c );  // decoded character
+    void         EndKey();
+    void         EndField();
+    void         Finish();
+
+    const char * RecvJson( httpd_req_t * req, const char * head, uint16_t headLen, size_t remaining );
+    const char * ParseJson( char * str );
+    Input      * Match( const char * key, size_t keylen );
     void         ClearUnparsed();
 
     Input * const mInArray;
     uint8_t const mNofFields;
-    uint32_t      mFieldsParsed;
+    uint32_t      mFieldsParsed { 0 };
+    bool          mJson         { false };
+    uint8_t       mHash[HashSize] {};  // index + 1 into mInArray (0: empty)
+
+    STATE         mState        { KEY };
+    uint8_t       mEscape       { 0 };  // # of hex digits pending after '%'
+    uint8_t       mEscVal       { 0 };
+    char          mEscDigit     { 0 };  // 1st hex digit (invalid escape sequence)
+    uint8_t       mKeyLen       { 0 };  // > KeyMax: key too long
+    char          mKey[KeyMax];
+    Input       * mIn           { 0 };  // field receiving the value
+    uint16_t      mValLen       { 0 };
+    bool          mTruncated    { false };
 };
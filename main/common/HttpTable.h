@@ -1,17 +1,152 @@
 /*
  * HttpTable.h
+ *
+ * html table rendered straight into the HttpHelper response:
+ * - the text of all cells is kept in one pool per table (single heap buffer,
+ *   grown by doubling) - a cell is just offset and length (no string per cell)
+ * - column alignment as template parameters, row/cell alignment and colspan
+ *   (Unite) at run time - opening tags are constant strings
+ *
+ *   Table<3,2,Cols(1)> table;  // 3 rows, 2 columns, column 1 right aligned
+ *   table[0][0] = "Name";  table[0][1] = "Value";
+ *   table[1][0] = "uptime";  table[1][1] = std::to_string( secs );  table[1][1] += " s";
+ *   table.AddTo( hh, 1 );  // 1 head row
  */
 
 #pragma once
 
+#include <stdlib.h>     // realloc(), free()
+#include <string.h>
+#include <string>       // std::string
+
 #include "HttpHelper.h"
 
+// column mask: Cols( 0, 2 ) -> columns 0 and 2
+constexpr size_t Cols() { return 0; }
+template<typename... T> constexpr size_t Cols( size_t col, T... more ) { return ((size_t) 1 << col) | Cols( more... ); }
+// column mask: ColRange( 2, 5 ) -> columns 2, 3 and 4
+constexpr size_t ColRange( size_t from, size_t to ) { return (((size_t) 1 << to) - 1) & ~(((size_t) 1 << from) - 1); }
+
+class TextPool
+{
+    char   * mBuf { 0 };
+    uint16_t mLen { 0 };
+    uint16_t mCap { 0 };
+
+    bool Reserve( size_t len ) {
+        if (mLen + len <= mCap)
+            return true;
+        size_t cap = mCap ? mCap : 256;
+        while (cap < mLen + len)
+            cap *= 2;
+        if (cap > 0xffff)
+            return false;
+        char * const buf = (char *) realloc( mBuf, cap );
+        if (! buf)
+            return false;
+        mBuf = buf;
+        mCap = (uint16_t) cap;
+        return true;
+    };
+public:
+    TextPool() {};
+    ~TextPool() { free( mBuf ); };
+    TextPool( const TextPool & ) = delete;
+    TextPool & operator=( const TextPool & ) = delete;
+
+    uint16_t     Len()                  const { return mLen; };
+    const char * At( uint16_t off )     const { return & mBuf[off]; };
+    void         Cut( uint16_t off )          { if (off < mLen) mLen = off; };
+
+    bool Add( const char * str, size_t len ) {
+        if (! Reserve( len ))
+            return false;
+        memcpy( & mBuf[mLen], str, len );
+        mLen += len;
+        return true;
+    };
+    bool Dup( uint16_t off, uint16_t len ) {  // copy of pool content to the end
+        if (! Reserve( len ))
+            return false;
+        memcpy( & mBuf[mLen], & mBuf[off], len );
+        mLen += len;
+        return true;
+    };
+};
+
+struct TableCell
+{
+    uint16_t off { 0 };
+    uint16_t len { 0 };
+};
+
+// assignment target of table[r][c]
+class CellRef
+{
+    TextPool  & mPool;
+    TableCell & mCell;
+
+    bool Last() const { return mCell.off + mCell.len == mPool.Len(); };
+    void Append( const char * str, size_t len ) {
+        if (! len)
+            return;
+        if (! mCell.len)
+            mCell.off = mPool.Len();
+        else if (! Last()) {  // move to the end to append
+            uint16_t const off = mPool.Len();
+            if (! mPool.Dup( mCell.off, mCell.len ))
+                return;
+            mCell.off = off;
+        }
+        if (mPool.Add( str, len ))
+            mCell.len += len;
+    };
+    void Set( const char * str, size_t len ) {
+        clear();
+        Append( str, len );
+    };
+public:
+    CellRef( TextPool & pool, TableCell & cell ) : mPool { pool }, mCell { cell } {};
+
+    void clear() {
+        if (mCell.len && Last())
+            mPool.Cut( mCell.off );  // reuse the space
+        mCell.len = 0;
+    };
+    bool empty() const { return ! mCell.len; };
+
+    CellRef & operator=(  const char        * str ) { Set(    str, strlen( str ) );        return *this; };
+    CellRef & operator=(  const std::string & str ) { Set(    str.c_str(), str.length() ); return *this; };
+    CellRef & operator=(  char                c   ) { Set(    & c, 1 );                    return *this; };
+    CellRef & operator+=( const char        * str ) { Append( str, strlen( str ) );        return *this; };
+    CellRef & operator+=( const std::string & str ) { Append( str.c_str(), str.length() ); return *this; };
+    CellRef & operator+=( char                c   ) { Append( & c, 1 );                    return *this; };
+    CellRef & append( const char * str, size_t len ) { Append( str, len );            return *this; };
+    CellRef & append( const char * str )             { Append( str, strlen( str ) ); return *this; };
+};
+
+struct TableTag
+{
+    // [head][align: 0 / right / center][colspan]
+    static const char * Open( bool head, uint8_t align, bool unite ) {
+        static const char * const tag[2][3][2] = {
+            { { "<td>",                  "<td colspan=2>" },
+              { "<td align=\"right\">",  "<td align=\"right\" colspan=2>" },
+              { "<td align=\"center\">", "<td align=\"center\" colspan=2>" } },
+            { { "<th>",                  "<th colspan=2>" },
+              { "<th>",                  "<th colspan=2>" },
+              { "<th>",                  "<th colspan=2>" } } };
+        return tag[head][align][unite];
+    };
+};
+
 template<size_t N> class Row
 {
-    std::string mCell[N] {};
-    size_t mAlignRight  {0};
-    size_t mAlignCenter {0};
-    size_t mUnite       {0};
+    TableCell  mCell[N] {};
+    TextPool * mPool        { 0 };
+    size_t     mAlignRight  { 0 };
+    size_t     mAlignCenter { 0 };
+    size_t     mUnite       { 0 };
 public:
     void Right(  size_t col ) { mAlignRight  |= 1 << col; }
     void Center( size_t col ) { mAlignCenter |= 1 << col; }
@@ -23,44 +158,46 @@ public:
     }
 
     Row() {};
-    std::string & operator[](size_t i) { return mCell[i<N?i:N-1]; };
+    void Pool( TextPool & pool ) { mPool = & pool; };
+    CellRef operator[](size_t i) { return CellRef{ *mPool, mCell[i<N?i:N-1] }; };
 
-    void AddTo( HttpHelper & hh, size_t alignRight, size_t alignCenter, bool headrow, uint8_t headcols ) {
+    void AddTo( HttpHelper & hh, size_t alignRight, size_t alignCenter, bool headrow, uint8_t headcols ) const {
         for (size_t c = 0; c < N; ++c) {
-            std::string tag{ "td" };
-            if (headrow || (c < headcols))
-                tag = "th";
-            std::string cell{ "<" + tag };
-            if (! (headrow || (c < headcols))) {
+            bool const head  = headrow || (c < headcols);
+            bool const unite = ((mUnite >> c) & 1) && mCell[c].len;
+            uint8_t align = 0;
+            if (! head) {
                 if ((mAlignRight >> c) & 1)
-                    cell += " align=\"right\"";
+                    align = 1;
                 else if ((mAlignCenter >> c) & 1)
-                    cell += " align=\"center\"";
+                    align = 2;
                 else if ((alignRight >> c) & 1)
-                    cell += " align=\"right\"";
+                    align = 1;
                 else if ((alignCenter >> c) & 1)
-                    cell += " align=\"center\"";
-            }
-            if (((mUnite >> c) & 1) && ! mCell[c].empty()) {
-                cell += " colspan=2";
+                    align = 2;
             }
-            cell += ">";
-            cell += mCell[c];
-            cell += "</" + tag + ">";
-            hh.Add( cell );
-            if (((mUnite >> c) & 1) && ! mCell[c].empty())
+            hh.Add( TableTag::Open( head, align, unite ) );
+            if (mCell[c].len)
+                hh.Add( mPool->At( mCell[c].off ), mCell[c].len );
+            hh.Add( head ? "</th>" : "</td>" );
+            if (unite)
                 ++c;
         }
     };
 };
 
-template<size_t R, size_t C> class Table
+// AlignRight, AlignCenter: column masks (Cols())
+template<size_t R, size_t C, size_t AlignRight = 0, size_t AlignCenter = 0> class Table
 {
-    Row<C> mRow[R] {};
-    size_t mAlignRight {0};
-    size_t mAlignCenter {0};
+    TextPool mPool {};
+    Row<C>   mRow[R] {};
+    size_t   mAlignRight  { AlignRight };
+    size_t   mAlignCenter { AlignCenter };
 public:
-    Table() {};
+    Table() {
+        for (size_t r = 0; r < R; ++r)
+            mRow[r].Pool( mPool );
+    };
     Row<C>& operator[](size_t i) { return mRow[i<R?i:R-1]; };
 
     void Right(  size_t col ) { mAlignRight  |= 1 << col; };
@@ -70,13 +207,13 @@ public:
     void Unite(  size_t row, size_t col ) { mRow[row].Unite(  col ); };
 
     void ResetAlign() {
-        mAlignRight = 0;
-        mAlignCenter = 0;
+        mAlignRight = AlignRight;
+        mAlignCenter = AlignCenter;
         for (size_t r = 0; r < R; ++r)
             mRow[r].ResetAlign();
     };
 
-    void AddTo( HttpHelper & hh, uint8_t headrows = 0, uint8_t headcols = 0 ) {
+    void AddTo( HttpHelper & hh, uint8_t headrows = 0, uint8_t headcols = 0 ) const {
         for (size_t r = 0; r < R; ++r) {
             hh.Add( "    <tr>" );
             mRow[r].AddTo( hh, mAlignRight, mAlignCenter, r < headrows, headcols );
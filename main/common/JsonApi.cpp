@@ -0,0 +1,260 @@
+/*
+ * JsonApi.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "JsonApi.h"
+
+#include <math.h>       // lroundf(), isnan()
+#include <stdio.h>      // snprintf()
+#include <string.h>
+
+#include <esp_log.h>
+
+#include "Payload.h"
+
+namespace
+{
+const char * const TAG = "JsonApi";
+
+unsigned long uval( const JsonApi::Field & field )
+{
+    switch (field.size) {
+        case 1:  return *(const uint8_t  *) field.ptr;
+        case 2:  return *(const uint16_t *) field.ptr;
+        default: return *(const uint32_t *) field.ptr;
+    }
+}
+
+long ival( const JsonApi::Field & field )
+{
+    switch (field.size) {
+        case 1:  return *(const int8_t  *) field.ptr;
+        case 2:  return *(const int16_t *) field.ptr;
+        default: return *(const int32_t *) field.ptr;
+    }
+}
+
+long fixed( float val, uint8_t decimals )
+{
+    while (decimals--)
+        val *= 10;
+    return lroundf( val );
+}
+
+}
+
+void JsonApi::Format( const Field & field, char * buf, uint16_t size )
+{
+    if (! size)
+        return;
+    *buf = 0;
+    switch (field.type) {
+        case 's':
+            strncpy( buf, (const char *) field.ptr, size - 1 );
+            buf[size - 1] = 0;
+            break;
+        case 'S':
+            strncpy( buf, ((const std::string *) field.ptr)->c_str(), size - 1 );
+            buf[size - 1] = 0;
+            break;
+        case 'c':
+            if ((size > 1) && *(const char *) field.ptr) {
+                buf[0] = *(const char *) field.ptr;
+                buf[1] = 0;
+            }
+            break;
+        case 'b':
+            snprintf( buf, size, "%d", *(const bool *) field.ptr ? 1 : 0 );
+            break;
+        case 'u':
+            snprintf( buf, size, "%lu", uval( field ) );
+            break;
+        case 'i':
+            snprintf( buf, size, "%ld", ival( field ) );
+            break;
+        case 'a':
+            {
+                const uint8_t * const ip = (const uint8_t *) field.ptr;  // network order
+                if (*(const uint32_t *) field.ptr)
+                    snprintf( buf, size, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3] );
+            }
+            break;
+        case 'f':
+            {
+                float const val = *(const float *) field.ptr;
+                if (! isnan( val )) {
+                    Payload<16> p;
+                    p.Add( fixed( val, field.size ), field.size );
+                    strncpy( buf, p.c_str(), size - 1 );
+                    buf[size - 1] = 0;
+                }
+            }
+            break;
+    }
+}
+
+void JsonApi::Prefill( HttpParser::Input * in, uint8_t nofInputs, const Field * fields, uint8_t nofFields )
+{
+    for (uint8_t i = 0; i < nofInputs; ++i) {
+        if (! (in[i].buf && in[i].len))
+            continue;
+        for (uint8_t f = 0; f < nofFields; ++f)
+            if (! strcmp( in[i].key, fields[f].key )) {
+                Format( fields[f], in[i].buf, in[i].len );
+                break;
+            }
+    }
+}
+
+JsonApi::JsonApi( httpd_req_t * req )
+    : mHh { req }
+{
+    mHh.Raw( "application/json" );
+    mClose[mDepth++] = '}';
+    mHh.Add( "{" );
+}
+
+JsonApi::~JsonApi()
+{
+    while (mDepth > 1)
+        Close();
+    mHh.Add( "}\n" );
+}
+
+void JsonApi::Result( const std::string & err )
+{
+    if (! err.empty()) {
+        ESP_LOGI( TAG, "post failed: %s", err.c_str() );
+        httpd_resp_set_status( mHh.Req(), HTTPD_400 );
+    }
+    Str( "result", err.empty() ? "ok" : err.c_str() );
+}
+
+void JsonApi::Key( const char * key )
+{
+    if (! mFirst)
+        mHh.Add( "," );
+    mFirst = false;
+    if (key) {
+        Quoted( key );
+        mHh.Add( ":" );
+    }
+}
+
+void JsonApi::Quoted( const char * str )
+{
+    mHh.Add( "\"" );
+    const char * run = str;
+    for (; *str; ++str) {
+        unsigned char const c = (unsigned char) *str;
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+        mHh.Add( run, str - run );
+        run = str + 1;
+        char esc[8];
+        if (c >= 0x20)
+            snprintf( esc, sizeof(esc), "\\%c", c );
+        else
+            snprintf( esc, sizeof(esc), "\\u%04x", c );
+        mHh.Add( esc );
+    }
+    mHh.Add( run, str - run );
+    mHh.Add( "\"" );
+}
+
+void JsonApi::Str( const char * key, const char * str )
+{
+    Key( key );
+    Quoted( str );
+}
+
+void JsonApi::Int( const char * key, long val, uint8_t decimals )
+{
+    Payload<16> p;
+    p.Add( val, decimals );
+    Key( key );
+    mHh.Add( p.c_str(), p.Len() );
+}
+
+void JsonApi::Uint( const char * key, unsigned long val )
+{
+    char buf[12];
+    snprintf( buf, sizeof(buf), "%lu", val );
+    Key( key );
+    mHh.Add( buf );
+}
+
+void JsonApi::Bool( const char * key, bool val )
+{
+    Key( key );
+    mHh.Add( val ? "true" : "false" );
+}
+
+void JsonApi::Null( const char * key )
+{
+    Key( key );
+    mHh.Add( "null" );
+}
+
+void JsonApi::Open( const char * key, char bracket )
+{
+    if (mDepth >= MaxDepth) {
+        ESP_LOGE( TAG, "nesting too deep for \"%s\"", key ? key : "" );
+        return;
+    }
+    Key( key );
+    char const open[2] = { bracket, 0 };
+    mHh.Add( open );
+    mClose[mDepth++] = (bracket == '[') ? ']' : '}';
+    mFirst = true;
+}
+
+void JsonApi::Close()
+{
+    if (mDepth <= 1)
+        return;
+    char const close[2] = { mClose[--mDepth], 0 };
+    mHh.Add( close );
+    mFirst = false;
+}
+
+void JsonApi::Add( const Field & field )
+{
+    switch (field.type) {
+        case 's':
+            Str( field.key, (const char *) field.ptr );
+            break;
+        case 'S':
+            Str( field.key, ((const std::string *) field.ptr)->c_str() );
+            break;
+        case 'b':
+            Bool( field.key, *(const bool *) field.ptr );
+            break;
+        case 'u':
+            Uint( field.key, uval( field ) );
+            break;
+        case 'i':
+            Int( field.key, ival( field ) );
+            break;
+        case 'f':
+            if (isnan( *(const float *) field.ptr ))
+                Null( field.key );
+            else
+                Int( field.key, fixed( *(const float *) field.ptr, field.size ), field.size );
+            break;
+        default:  // c, a: formatted as string
+            {
+                char buf[16];
+                Format( field, buf, sizeof(buf) );
+                Str( field.key, buf );
+            }
+            break;
+    }
+}
+
+void JsonApi::Add( const Field * fields, uint8_t nofFields )
+{
+    for (uint8_t f = 0; f < nofFields; ++f)
+        Add( fields[f] );
+}
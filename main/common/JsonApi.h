@@ -0,0 +1,80 @@
+/*
+ * JsonApi.h
+ *
+ * compact json response for /api/<name> - written through the HttpHelper chunk buffer
+ *
+ * each api page describes its values once as Field array:
+ * - GET:  the fields are written as json members
+ * - POST: the fields are the defaults for keys missing in the json post data
+ *         (Prefill before HttpParser::ParsePostData)
+ *
+ *   JsonApi::Field const fields[] = { JsonApi::F( "host", mHostName ),
+ *                                     JsonApi::Ip( "ip", mIp ) };
+ *   JsonApi json{ req };
+ *   json.Result( err );             // when post: "result": "ok" / error (status 400)
+ *   json.Add( fields, sizeof(fields) / sizeof(fields[0]) );
+ *   json.Open( "list", '[' );  json.Uint( 0, 1 );  json.Close();
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>               // std::string
+#include <type_traits>          // std::is_integral
+
+#include "HttpHelper.h"
+#include "HttpParser.h"
+
+class JsonApi
+{
+public:
+    struct Field {
+        const char * key;   // as form input name and nvs key
+        char         type;  // s: char[] / S: std::string / c: char / b: bool / u,i: integer / a: ipv4 / f: float
+        uint8_t      size;  // u,i: sizeof value / f: decimals
+        const void * ptr;
+    };
+    static constexpr uint8_t MaxDepth = 4;  // nested objects/arrays incl. outer object
+
+    static Field F( const char * key, const char        * v ) { return { key, 's', 0, v }; };
+    static Field F( const char * key, const std::string & v ) { return { key, 'S', 0, & v }; };
+    static Field F( const char * key, const char        & v ) { return { key, 'c', 1, & v }; };
+    static Field F( const char * key, const bool        & v ) { return { key, 'b', 1, & v }; };
+    static Field F( const char * key, const float & v, uint8_t decimals ) { return { key, 'f', decimals, & v }; };
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    static Field F( const char * key, const T & v )
+    {
+        return { key, std::is_signed<T>::value ? 'i' : 'u', (uint8_t) sizeof(T), & v };
+    };
+    static Field Ip( const char * key, const uint32_t & addr ) { return { key, 'a', 4, & addr }; };
+
+    // value as posted by a form (without quotes): used as default for json post
+    static void Format( const Field & field, char * buf, uint16_t size );
+    static void Prefill( HttpParser::Input * in, uint8_t nofInputs, const Field * fields, uint8_t nofFields );
+
+    JsonApi( httpd_req_t * req );
+    ~JsonApi();  // closes open objects and arrays
+
+    void Result( const std::string & err );  // before 1st Add: sets status 400 on error
+    void Add( const Field & field );
+    void Add( const Field * fields, uint8_t nofFields );
+
+    // key 0: array element
+    void Str(  const char * key, const char * str );
+    void Int(  const char * key, long val, uint8_t decimals = 0 );
+    void Uint( const char * key, unsigned long val );
+    void Bool( const char * key, bool val );
+    void Null( const char * key );
+
+    void Open( const char * key, char bracket = '{' );  // '{' or '['
+    void Close();
+
+private:
+    void Key( const char * key );
+    void Quoted( const char * str );
+
+    HttpHelper mHh;
+    char       mClose[MaxDepth];  // closing brackets
+    uint8_t    mDepth { 0 };
+    bool       mFirst { true };   // no comma needed
+};
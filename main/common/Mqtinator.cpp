@@ -11,10 +11,18 @@
 #include "HttpHelper.h"
 #include "HttpTable.h"
 #include "HttpParser.h"
+#include "JsonApi.h"
+#include "Payload.h"
+#include "SubQueue.h"
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <esp_log.h>
+#include <esp_system.h>  // esp_random, esp_restart
+#include <esp_timer.h>   // esp_timer_get_time
 #include <mqtt_client.h>
 #include <lwip/apps/mqtt_priv.h>
 #include <nvs.h>
@@ -33,15 +41,55 @@ const char *const s_subMqtt        = "MQTT parameter";
 const char *const s_nvsNamespace   = "mqtt";
 const char *const s_keyHost        = "host";
 const char *const s_keyPort        = "port";
+const char *const s_keyHost2       = "host2";
+const char *const s_keyPort2       = "port2";
+const char *const s_keyRebootAfter = "rebootAfter";
 const char *const s_keyPubTopic[2] = { "pub", "wdPub" };
 const char *const s_keySubTopic[2] = { "sub", "wdSub" };
 const char *const s_keyFormat      = "format";
 const char *const s_keyPrimStatIdx = "primStatIdx";
 const char *const s_keySecStatIdx  = "secStatIdx";
 const char *const s_keyAlive       = "alive";
+const char *const s_keyPubWindow   = "pubWindow";
+const char *const s_keySpill       = "spill";
+const char *const s_keyDrainRate   = "drainRate";
+const char *const s_keyMetrics     = "metrics";
+
+const char *const s_nvsSpill       = "mqttSpill";  // own namespace: records come and go
+const char *const s_keySpillCnt    = "cnt";
+
+constexpr TickType_t s_pubTimeout  = configTICK_RATE_HZ * 10;  // max. time in flight without callback
 
 mqtt_client_t     s_client;
 Mqtinator         s_mqtinator{};
+
+struct SpillRec {
+    int8_t   topicGroup;
+    uint8_t  qos;
+    uint8_t  retain;
+    uint8_t  len;
+    uint16_t key;
+    char     topic[Mqtinator::PubTopicLen];
+    char     data[Mqtinator::PubDataLen];  // just len bytes stored
+};
+
+void SpillKey( char * key, uint8_t idx )
+{
+    sprintf( key, "r%u", idx );
+}
+
+uint16_t DomoticzIdx( const char * topic, const char * string )
+{
+    // domoticz devices share one topic - the device is given by the idx in the payload
+    if (topic && *topic)
+        return 0;
+    const char * idx = strstr( string, "\"idx\"" );
+    if (idx)
+        idx = strchr( idx, ':' );
+    if (! idx)
+        return 0;
+    return (uint16_t) strtoul( idx + 1, 0, 10 );
+}
 }
 
 extern "C" {
@@ -58,6 +106,12 @@ esp_err_t handler_post_mqtt( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t handler_api_mqtt( httpd_req_t * req )
+{
+    s_mqtinator.Api( req );
+    return ESP_OK;
+}
+
 }
 
 namespace {
@@ -89,6 +143,10 @@ TickType_t remaining( unsigned long exp )
     long diff = exp - now();
     return (TickType_t) (diff < 0 ? 0 : diff);
 }
+uint32_t usNow()
+{
+    return (uint32_t) esp_timer_get_time();  // wraps after 71 min - enough for latencies
+}
 
 }
 
@@ -99,7 +157,9 @@ static void MqtinatorTask( void * mqtinator );
 static void mqtt_connection_cb( mqtt_client_t * client,
                                 void * arg, mqtt_connection_status_t status );
 static void mqtt_pub_request_cb( void * arg, err_t result );
+static void mqtt_pub_async_cb( void * arg, err_t result );
 static void mqtt_sub_request_cb( void * arg, err_t result );
+static void mqtt_sub_batch_cb( void * arg, err_t result );
 static void mqtt_sub_topic_cb( void * arg, const char * topic, u32_t tot_len );
 static void mqtt_sub_data_cb( void * arg, const u8_t * data, u16_t len, u8_t flags );
 
@@ -131,6 +191,12 @@ bool Mqtinator::Init()
         return false;
     }
 
+    mPubMutex = xSemaphoreCreateMutex();
+    if (!mPubMutex) {
+        ESP_LOGE( TAG, "failed to create publish queue mutex" );
+        return false;
+    }
+
     xTaskCreate( MqtinatorTask, "Mqtinator", /*stack size*/2048, this, /*prio*/ 1, &mTaskHandle );
     if (!mTaskHandle) {
         ESP_LOGE( TAG, "xTaskCreate failed" );
@@ -143,6 +209,7 @@ bool Mqtinator::Init()
 void Mqtinator::AddPage( WebServer & webServerInstance )
 {
     webServerInstance.AddPage( page_mqtt, & uri_post_mqtt );
+    webServerInstance.AddApi( "mqtt", handler_api_mqtt );
 }
 
 extern "C" void MqtinatorTask( void * mqtinator )
@@ -152,62 +219,76 @@ extern "C" void MqtinatorTask( void * mqtinator )
 void Mqtinator::Run()
 {
     ReadParam();
+    SpillScan();
     Connect();
 
     if (mAlivePeriod)
         mNextAlive = expiration( 5 );  // 1st alive after 5 seconds
+    mNextMinute = expiration( 60 );
 
     while (1)
     {
         // ESP_LOGD( TAG, "task waits for next event" );
-        if (! mNextAlive)
-            xSemaphoreTake( mSemaphore, portMAX_DELAY );
-        else {
-            long ticksToWait = mNextAlive - now();
-            if (ticksToWait > 0)
-                xSemaphoreTake( mSemaphore, ticksToWait );
+        TickType_t ticksToWait = portMAX_DELAY;
+        if (mNextAlive) {
+            long diff = mNextAlive - now();
+            ticksToWait = diff > 0 ? diff : 0;
         }
+        if ((mPubInFlight || (mSpillCnt && (mConnStatus == MQTT_CONNECT_ACCEPTED)))
+                && (ticksToWait > configTICK_RATE_HZ))
+            ticksToWait = configTICK_RATE_HZ;  // check in-flight publishes for time out
+        if (mPubNextSend && (mPubSend != mPubTail) && (ticksToWait > remaining( mPubNextSend )))
+            ticksToWait = remaining( mPubNextSend );  // next publish of drained backlog
+        if (ticksToWait > remaining( mNextMinute ))
+            ticksToWait = remaining( mNextMinute );  // message rate
+        if (ticksToWait && ! mToConnect)  // ConnectFailed in this task: back off without a wake up
+            xSemaphoreTake( mSemaphore, ticksToWait );
         // ESP_LOGD( TAG, "task continues" );
 
+        if (expired( mNextMinute )) {
+            mNextMinute = expiration( 60 );
+            for (uint8_t dir = 0; dir < 2; ++dir) {
+                uint32_t const cnt = mMsgCnt[dir];
+                mMsgRate[dir] = (uint16_t) (cnt - mMsgBase[dir]);
+                mMsgBase[dir] = cnt;
+            }
+        }
+
         if (mToConnect) {
             mToConnect = false;
+            PubAbort();
             if (mConnStatus == MQTT_CONNECT_ACCEPTED) {
                 ESP_LOGD( TAG, "task disconnects..." );
-                mqtt_disconnect( & s_client );
-                mConnStatus = MQTT_CONNECT_DISCONNECTED;
+                mDownSince = now();  // re-connect time of a lost connection only (not the boot connect)
+            }
+            ConnEnd();  // no connection callback on manual disconnect
+            mqtt_disconnect( & s_client );  // also aborts a pending connect attempt
+            mConnStatus = MQTT_CONNECT_DISCONNECTED;
+
+            TickType_t const delay = Backoff();
+            ESP_LOGI( TAG, "re-connect in %lu ms (failures: %d)", (unsigned long) (delay * portTICK_PERIOD_MS), mConnFails );
+            TickType_t const exp = now() + delay;
+            long diff;
+            while ((diff = (long) (exp - now())) > 0) {
+                xSemaphoreTake( mSemaphore, (TickType_t) diff );
+                PubDrain();  // offline: retire and spill only
+                if (mToConnect) {  // parameter changed: don't wait any longer
+                    mToConnect = false;
+                    break;
+                }
             }
-            ESP_LOGD( TAG, "suspend 30 seconds to re-connect..." );
-            xSemaphoreTake( mSemaphore, configTICK_RATE_HZ * 30 );
             ESP_LOGD( TAG, "task re-connects..." );
             Connect();
         }
 
-        if (mDataComplete) {
-            mDataComplete = false;
-            ESP_LOGD( TAG, "task got \"%s\" \"%.16s ...\" (%d/%d bytes)", mInTopic, mInData, strlen(mInData), mInLen );
-
-            int8_t const g = (mTopicGroup < 0) || (mTopicGroup >= 2) ? 0 : mTopicGroup;
-            auto it = mSubCallbackMap[g].find( mInTopic );
-            if (it != mSubCallbackMap[g].end()) {
-                ESP_LOGD( TAG, "direct subscription found - calling callback function" );
-                (it->second)( mInTopic, mInData );
-            } else {
-                it = mSubCallbackMap[g].find( "#" );
-                if (it != mSubCallbackMap[g].end()) {
-                    ESP_LOGD( TAG, "global subscription found - calling callback function" );
-                    (it->second)( mInTopic, mInData );
-                } else {
-                    ESP_LOGD( TAG, "subscription not found - drop \"%s\"", mInTopic );
-                }
-            }
-        }
+        InDispatch();
 
         if ((mConnStatus == MQTT_CONNECT_ACCEPTED) && expired(mNextAlive)) {
             mNextAlive = expiration( mAlivePeriod );
             const unsigned long * sigmask = Indicator::Instance().SigMask();
             if (mFormat == 'd') {  // domoticz format
                 for (u_char led = 0; led < 2; ++led) {
-                    if (mStatusIdx[led]) {
+                    if (mStatusIdx[led] && mStatusFilter[led].Check( (long) sigmask[led] )) {
                         ESP_LOGD( TAG, "publishing status \"0x%lx\"", sigmask[led] ); EXPRD(vTaskDelay(1))
                         Pub( mStatusIdx[led], sigmask[led] );
                     }
@@ -224,21 +305,391 @@ void Mqtinator::Run()
                 msg += " " + HttpHelper::String( (uint32_t) mCbPassedCnt );
                 msg += " " + HttpHelper::String( (uint32_t) mCbFailedCnt );
                 msg += " " + HttpHelper::String( (uint32_t) mCbTimoCnt );
+                msg += " " + HttpHelper::String( (uint32_t) (GetPubDepth() + GetSpillDepth()) );
+                msg += " " + HttpHelper::String( GetPubBytes() );
+                msg += " " + HttpHelper::String( (uint32_t) GetPubDropped() );
                 ESP_LOGD( TAG, "publishing status \"%s\"", msg.c_str() ); EXPRD(vTaskDelay(1))
-                WdPub( "status", msg.c_str() );
+                WdPubAsync( "status", msg.c_str() );
+            }
+            if (mPubMetrics)
+                MetricsPub();
+        }
+
+        PubDrain();
+    }
+}
+
+void Mqtinator::InDispatch()
+{
+    uint8_t * const pool = (uint8_t *) mInPool;
+    while (mInHead != mInTail) {
+        InMsg * const msg = (InMsg *) & pool[mInHead];
+        if (msg->state == IN_WRAP) {
+            mInHead = 0;
+            continue;
+        }
+        if (msg->state == IN_WRITING)
+            break;  // still receiving
+
+        if (msg->state == IN_COMPLETE) {
+            ESP_LOGD( TAG, "task got \"%s\" \"%.16s ...\" (%d bytes)", msg->topic, msg->Data(), msg->len );
+            int8_t const g = (msg->topicGroup < 0) || (msg->topicGroup >= 2) ? 0 : msg->topicGroup;
+            // collect first: callbacks may change the subscriptions
+            SubCallback found[TopicRouter::MaxMatches];
+            void      * queue[TopicRouter::MaxMatches];
+            uint8_t const cnt = mSubRouter[g].Lookup( msg->topic, found, TopicRouter::MaxMatches, queue );
+            if (! cnt)
+                ESP_LOGD( TAG, "subscription not found - drop \"%s\"", msg->topic );
+            for (uint8_t i = 0; i < cnt; ++i)
+                if (queue[i])
+                    ((SubQueue *) queue[i])->Post( found[i], msg->topic, msg->Data() );
+                else
+                    found[i]( msg->topic, msg->Data() );
+        }
+        uint16_t const head = mInHead + msg->size;
+        mInHead = (head == InPoolLen) ? 0 : head;
+    }
+}
+
+Mqtinator::InMsg * Mqtinator::InAlloc( uint32_t need )
+{
+    // records are freed in order by the task: use the pool as a ring,
+    // keep one gap, so mInHead == mInTail just means empty
+    need = (need + 3) & ~3;
+    uint8_t * const pool = (uint8_t *) mInPool;
+    uint16_t const  head = mInHead;
+    uint16_t        tail = mInTail;
+    if (tail >= head) {
+        if ((tail + need > InPoolLen) || ((tail + need == InPoolLen) && ! head)) {
+            if (need >= head)
+                return nullptr;
+            ((InMsg *) & pool[tail])->state = IN_WRAP;
+            tail = 0;
+        }
+    } else if (need >= (uint32_t) (head - tail))
+        return nullptr;
+
+    InMsg * const msg = (InMsg *) & pool[tail];
+    msg->size  = (uint16_t) need;
+    msg->state = IN_WRITING;
+    tail += need;
+    mInTail = (tail == InPoolLen) ? 0 : tail;
+    return msg;
+}
+
+void Mqtinator::PubDrain()
+{
+    // retire finished slots in order of queueing
+    while (mPubHead != mPubTail) {
+        PubSlot & slot = mPubSlot[mPubHead % PubQueueLen];
+        uint8_t const state = slot.state;
+        if ((state == PUB_INFLIGHT) && ((long) (now() - slot.sent) >= (long) s_pubTimeout)) {
+            ESP_LOGE( TAG, "async publish \"%s\" timed out", slot.topic );
+            ++mPubStats[slot.topicGroup].timo;
+            ++mLatHist[LAT_PUBLISH].timo;
+            ++slot.gen;  // ignore late callback
+        } else if (state == PUB_PASSED) {
+            PubStats & stats = mPubStats[slot.topicGroup];
+            uint32_t const latency = now() - slot.queued;
+            ++stats.passed;
+            stats.latSum += latency;
+            if (stats.latMax < latency)
+                stats.latMax = latency;
+        } else if (state == PUB_FAILED) {
+            ++mPubStats[slot.topicGroup].failed;
+        } else
+            break;
+
+        if (slot.callback)
+            slot.callback( slot.userarg, state == PUB_PASSED );
+
+        xSemaphoreTake( mPubMutex, portMAX_DELAY );
+        slot.state = PUB_FREE;
+        ++mPubHead;
+        xSemaphoreGive( mPubMutex );
+    }
+
+    mPubInFlight = 0;
+    for (uint8_t i = mPubHead; i != mPubSend; ++i)
+        if (mPubSlot[i % PubQueueLen].state == PUB_INFLIGHT)
+            ++mPubInFlight;
+
+    if (mConnStatus != MQTT_CONNECT_ACCEPTED) {
+        // keep room for new publishes by moving the oldest ones into nvs
+        while (mSpill && (GetPubDepth() >= PubQueueLen / 2) && SpillPut())
+            ;
+        return;
+    }
+    while (SpillGet())
+        ;
+
+    // hand over queued slots to lwip as long as the in-flight window allows
+    while ((mPubSend != mPubTail) && (mPubInFlight < mPubWindow)) {
+        PubSlot & slot = mPubSlot[mPubSend % PubQueueLen];
+        if (slot.state != PUB_QUEUED) {  // already done before reconnect
+            ++mPubSend;
+            continue;
+        }
+        if (mPubNextSend && ! expired( mPubNextSend ))
+            break;  // draining backlog at limited rate
+        char fullTopic[sizeof(mPubTopic[0]) + PubTopicLen];
+        strcpy( fullTopic, mPubTopic[slot.topicGroup] );
+        if (slot.topic[0]) {
+            if (fullTopic[0])
+                strcat( fullTopic, "/" );
+            strcat( fullTopic, slot.topic );
+        }
+        void * const arg = (void *) (((uintptr_t) slot.gen << 8) | (mPubSend % PubQueueLen));
+
+        xSemaphoreTake( mPubMutex, portMAX_DELAY );  // no more coalescing into this slot
+        slot.sent   = now();
+        slot.sentUs = usNow();
+        slot.state  = PUB_INFLIGHT;
+        xSemaphoreGive( mPubMutex );
+        err_t e = mqtt_publish( & s_client, fullTopic, slot.data, slot.len,
+                                slot.qos, slot.retain, mqtt_pub_async_cb, arg );
+        if (e == ERR_MEM) {  // lwip request queue or tcp buffer full: retry later
+            slot.state = PUB_QUEUED;
+            break;
+        }
+        if (e != ERR_OK) {
+            ESP_LOGE( TAG, "async publish err: %d", e );
+            ++mLatHist[LAT_PUBLISH].failed;
+            slot.state = PUB_FAILED;
+        } else {
+            ++mPubInFlight;
+            ++mMsgCnt[1];
+            mByteCnt[1] += strlen( fullTopic ) + slot.len;
+        }
+        ++mPubSend;
+        if (mDraining && mDrainRate) {
+            mPubNextSend = now() + configTICK_RATE_HZ / mDrainRate;
+            if (! mPubNextSend)
+                --mPubNextSend;
+        }
+    }
+
+    if (mDraining && (mPubHead == mPubTail) && ! mSpillCnt) {
+        ESP_LOGI( TAG, "offline backlog drained" );
+        mDraining   = false;
+        mPubNextSend = 0;
+    }
+}
+
+bool Mqtinator::PubCoalesce( int8_t topicGroup, const char * topic, uint16_t key, uint8_t retain,
+                             const char * string, size_t len )
+{
+    // just the latest value counts for a domoticz device or a retained topic
+    if (! (key || retain))
+        return false;
+    if (! topic)
+        topic = "";
+    for (uint8_t i = mPubSend; i != mPubTail; ++i) {
+        PubSlot & slot = mPubSlot[i % PubQueueLen];
+        if ((slot.state != PUB_QUEUED) || slot.callback || (slot.topicGroup != topicGroup))
+            continue;
+        if (key ? (slot.key != key) : (! slot.retain || strcmp( slot.topic, topic )))
+            continue;
+        slot.len = (uint8_t) len;
+        memcpy( slot.data, string, len );
+        slot.data[len] = 0;
+        return true;
+    }
+    return false;
+}
+
+bool Mqtinator::SpillPut()
+{
+    if (mSpillCnt >= SpillLen)
+        return false;
+
+    SpillRec rec;
+    xSemaphoreTake( mPubMutex, portMAX_DELAY );
+    PubSlot & slot = mPubSlot[mPubHead % PubQueueLen];
+    if ((mPubHead == mPubTail) || (slot.state != PUB_QUEUED) || slot.callback) {
+        xSemaphoreGive( mPubMutex );
+        return false;  // callback cannot survive a reboot
+    }
+    rec.topicGroup = slot.topicGroup;
+    rec.qos        = slot.qos;
+    rec.retain     = slot.retain;
+    rec.len        = slot.len;
+    rec.key        = slot.key;
+    memcpy( rec.topic, slot.topic, sizeof(rec.topic) );
+    memcpy( rec.data,  slot.data,  rec.len );
+    slot.state = PUB_FREE;
+    if (mPubSend == mPubHead)
+        ++mPubSend;
+    ++mPubHead;
+    xSemaphoreGive( mPubMutex );
+
+    PubStats & stats = mPubStats[rec.topicGroup];
+    uint8_t idx = mSpillCnt;
+    if (rec.key)  // replace older value of same device
+        for (uint8_t i = 0; i < mSpillCnt; ++i)
+            if ((mSpillInfo[i].key == rec.key) && (mSpillInfo[i].topicGroup == rec.topicGroup)) {
+                idx = i;
+                break;
+            }
+
+    nvs_handle my_handle;
+    if (nvs_open( s_nvsSpill, NVS_READWRITE, &my_handle ) != ESP_OK) {
+        ESP_LOGE( TAG, "cannot open spill nvs namespace - publish dropped" );
+        ++stats.dropped;
+        return true;
+    }
+    char key[4];
+    SpillKey( key, idx );
+    esp_err_t e = nvs_set_blob( my_handle, key, & rec, offsetof(SpillRec, data) + rec.len );
+    if ((e == ESP_OK) && (idx == mSpillCnt))
+        e = nvs_set_u8( my_handle, s_keySpillCnt, idx + 1 );
+    if (e == ESP_OK)
+        e = nvs_commit( my_handle );
+    nvs_close( my_handle );
+    if (e != ESP_OK) {
+        ESP_LOGE( TAG, "spilling publish failed: %d - dropped", e );
+        ++stats.dropped;
+        return true;
+    }
+
+    mSpillInfo[idx].topicGroup = rec.topicGroup;
+    mSpillInfo[idx].len        = rec.len;
+    mSpillInfo[idx].key        = rec.key;
+    if (idx == mSpillCnt) {
+        ++mSpillCnt;
+        ++stats.spilled;
+    } else
+        ++stats.coalesced;
+    return true;
+}
+
+bool Mqtinator::SpillGet()
+{
+    // the spill area holds publishes older than the queued ones:
+    // move the newest record in front of the queue, when nothing is in flight
+    if ((! mSpillCnt) || (mPubHead != mPubSend) || (GetPubDepth() >= PubQueueLen))
+        return false;
+
+    nvs_handle my_handle;
+    if (nvs_open( s_nvsSpill, NVS_READWRITE, &my_handle ) != ESP_OK) {
+        ESP_LOGE( TAG, "cannot open spill nvs namespace" );
+        return false;
+    }
+    uint8_t const idx = mSpillCnt - 1;
+    SpillRec rec;
+    size_t len = sizeof(rec);
+    char key[4];
+    SpillKey( key, idx );
+    esp_err_t e = nvs_get_blob( my_handle, key, & rec, & len );
+    if ((e == ESP_OK) && ((len < offsetof(SpillRec, data)) || (rec.len != len - offsetof(SpillRec, data))
+                                                           || (rec.len >= PubDataLen)))
+        e = ESP_ERR_NVS_INVALID_LENGTH;
+
+    bool inserted = false;
+    if (e == ESP_OK) {
+        xSemaphoreTake( mPubMutex, portMAX_DELAY );
+        if ((mPubHead == mPubSend) && (GetPubDepth() < PubQueueLen)) {
+            PubSlot & slot = mPubSlot[(uint8_t) (mPubHead - 1) % PubQueueLen];
+            slot.topicGroup = rec.topicGroup & 1;
+            slot.qos        = rec.qos;
+            slot.retain     = rec.retain;
+            slot.len        = rec.len;
+            slot.key        = rec.key;
+            slot.callback   = 0;
+            slot.userarg    = 0;
+            slot.queued     = now();
+            memcpy( slot.topic, rec.topic, sizeof(slot.topic) );
+            slot.topic[sizeof(slot.topic) - 1] = 0;
+            memcpy( slot.data, rec.data, rec.len );
+            slot.data[rec.len] = 0;
+            slot.state      = PUB_QUEUED;
+            --mPubHead;
+            mPubSend = mPubHead;
+            inserted = true;
+        }
+        xSemaphoreGive( mPubMutex );
+        if (! inserted) {
+            nvs_close( my_handle );
+            return false;
+        }
+    } else {
+        ESP_LOGE( TAG, "spilled publish %s unreadable: %d - dropped", key, e );
+        ++mPubStats[0].dropped;
+    }
+
+    nvs_erase_key( my_handle, key );
+    nvs_set_u8( my_handle, s_keySpillCnt, idx );
+    nvs_commit( my_handle );
+    nvs_close( my_handle );
+    mSpillCnt = idx;
+    return inserted;
+}
+
+void Mqtinator::SpillScan()
+{
+    mSpillCnt = 0;
+    nvs_handle my_handle;
+    if (nvs_open( s_nvsSpill, NVS_READONLY, &my_handle ) != ESP_OK)
+        return;  // nothing spilled so far
+
+    uint8_t cnt = 0;
+    nvs_get_u8( my_handle, s_keySpillCnt, & cnt );
+    while ((mSpillCnt < cnt) && (mSpillCnt < SpillLen)) {
+        SpillRec rec;
+        size_t len = sizeof(rec);
+        char key[4];
+        SpillKey( key, mSpillCnt );
+        if (nvs_get_blob( my_handle, key, & rec, & len ) != ESP_OK)
+            break;
+        mSpillInfo[mSpillCnt].topicGroup = rec.topicGroup & 1;
+        mSpillInfo[mSpillCnt].len        = rec.len;
+        mSpillInfo[mSpillCnt].key        = rec.key;
+        ++mSpillCnt;
+    }
+    nvs_close( my_handle );
+    if (mSpillCnt)
+        ESP_LOGI( TAG, "%d publishes pending in nvs spill area", mSpillCnt );
+}
+
+uint32_t Mqtinator::GetPubBytes() const
+{
+    uint32_t bytes = 0;
+    for (uint8_t i = mPubHead; i != mPubTail; ++i)
+        bytes += mPubSlot[i % PubQueueLen].len;
+    for (uint8_t i = 0; i < mSpillCnt; ++i)
+        bytes += mSpillInfo[i].len;
+    return bytes;
+}
+
+void Mqtinator::PubAbort()
+{
+    // lwip drops pending requests without callback on disconnect:
+    // requeue the ones in flight, so they will be sent again after reconnect
+    bool first = true;
+    for (uint8_t i = mPubHead; i != mPubSend; ++i) {
+        PubSlot & slot = mPubSlot[i % PubQueueLen];
+        if (slot.state == PUB_INFLIGHT) {
+            ++slot.gen;  // ignore late callback
+            slot.state = PUB_QUEUED;
+            if (first) {
+                first = false;
+                mPubSend = i;  // PubDrain skips the passed/failed ones behind
             }
         }
     }
+    mPubInFlight = 0;
 }
 
 void Mqtinator::CallPrep( Mqtinator::CALL_STATUS callStatus )
 {
     xSemaphoreTake( mCallMutex, portMAX_DELAY );
+    mCallStart  = usNow();
     mCallStatus = callStatus;
 }
 
 void Mqtinator::CallFailed( Mqtinator::CALL_STATUS callStatus )
 {
+    ++mLatHist[callStatus - CALL_CONNECT].failed;
     mCallStatus = CALL_IDLE;
     xSemaphoreGive( mCallMutex );
 }
@@ -246,6 +697,11 @@ void Mqtinator::CallFailed( Mqtinator::CALL_STATUS callStatus )
 void Mqtinator::CallDone( Mqtinator::CALL_STATUS callStatus, bool passed )
 {
     if (mCallStatus == callStatus) {
+        LatHist & hist = mLatHist[callStatus - CALL_CONNECT];
+        if (passed)
+            hist.Add( usNow() - mCallStart );
+        else
+            ++hist.failed;
         mCallStatus |= passed ? CALL_DONE_PASSED : CALL_DONE_FAILED;
         xSemaphoreGive( mCbWaitSema );
     }
@@ -263,6 +719,7 @@ bool Mqtinator::CallWait( Mqtinator::CALL_STATUS callStatus )
             if (expired( exp )) {
                 ESP_LOGE( TAG, "callback timed out: waiting for call status %#x being changed", callStatus );
                 ++mCbTimoCnt;
+                ++mLatHist[callStatus - CALL_CONNECT].timo;
                 mCallStatus = CALL_IDLE;
                 xSemaphoreGive( mCallMutex );
                 return false;
@@ -280,9 +737,107 @@ bool Mqtinator::CallWait( Mqtinator::CALL_STATUS callStatus )
     return passed;
 }
 
+TickType_t Mqtinator::Backoff()
+{
+    if (! mConnFails)
+        return 0;  // connection lost or parameter changed: try again at once
+
+    uint8_t const shift = mConnFails > 9 ? 8 : mConnFails - 1;
+    uint32_t secs = (uint32_t) BackoffMin << shift;
+    if (secs > BackoffMax)
+        secs = BackoffMax;
+    // jitter +-25%, so several devices don't retry in lockstep after a broker restart
+    TickType_t const ticks = secs * configTICK_RATE_HZ;
+    return ticks - ticks / 4 + esp_random() % (ticks / 2 + 1);
+}
+
+bool Mqtinator::ConnectFailed()
+{
+    Indicator::Instance().Indicate( Indicator::STATUS_ERROR );
+    ++mConnFails;
+    if (mRebootAfter && (mConnFails >= mRebootAfter)) {
+        ESP_LOGE( TAG, "%d connect failures in a row -> reboot in 1 second", mConnFails );
+        while (mSpill && SpillPut())  // keep the queued ones over reboot
+            ;
+        vTaskDelay( configTICK_RATE_HZ );
+        esp_restart();
+
+        ESP_LOGE( TAG, "restart returned" );
+    }
+    if (mHost2.addr && mPort2 && ! (mConnFails % FailoverAfter)) {
+        mBroker ^= 1;
+        ESP_LOGW( TAG, "fail over to %s broker", mBroker ? "secondary" : "primary" );
+    }
+    mToConnect = true;  // try to reconnect
+    return false;
+}
+
+void Mqtinator::ConnEnd()
+{
+    TickType_t const since = mConnSince;
+    if (since) {
+        mConnSince = 0;
+        mConnTotal += (now() - since) / configTICK_RATE_HZ;
+    }
+}
+
+uint32_t Mqtinator::GetConnUptime() const
+{
+    TickType_t const since = mConnSince;
+    return since ? (now() - since) / configTICK_RATE_HZ : 0;
+}
+
+void Mqtinator::LatHist::Add( uint32_t us )
+{
+    uint32_t const n = us >> LatMinShift;
+    uint8_t  b = n ? 32 - __builtin_clz( n ) : 0;  // log2 bucket
+    if (b >= LatBuckets)
+        b = LatBuckets - 1;
+    ++cnt[b];
+    sumUs += us;
+    if (maxUs < us)
+        maxUs = us;
+}
+
+uint32_t Mqtinator::LatHist::Passed() const
+{
+    uint32_t n = 0;
+    for (uint8_t b = 0; b < LatBuckets; ++b)
+        n += cnt[b];
+    return n;
+}
+
+void Mqtinator::MetricsPub()
+{
+    // "<uptime> <msgs in/min> <msgs out/min> <bytes in> <bytes out>
+    //  <connect avg/max> <subscribe avg/max> <publish avg/max> <timeouts> <publish histogram>"
+    Payload<PubDataLen> msg;
+    msg.Add( (long) GetConnUptime() );
+    msg.Add( " " ).Add( (long) mMsgRate[0] ).Add( " " ).Add( (long) mMsgRate[1] );
+    msg.Add( " " ).Add( (long) mByteCnt[0] ).Add( " " ).Add( (long) mByteCnt[1] );
+    uint16_t timo = 0;
+    for (uint8_t op = 0; op < LAT_COUNT; ++op) {
+        const LatHist & hist = mLatHist[op];
+        msg.Add( " " ).Add( (long) hist.AvgMs() ).Add( "/" ).Add( (long) (hist.maxUs / 1000) );
+        timo += hist.timo;
+    }
+    msg.Add( " " ).Add( (long) timo ).Add( " " );
+    for (uint8_t b = 0; b < LatBuckets; ++b) {
+        if (b)
+            msg.Add( "," );
+        msg.Add( (long) mLatHist[LAT_PUBLISH].cnt[b] );
+    }
+    ESP_LOGD( TAG, "publishing metrics \"%s\"", msg.c_str() );
+    WdPubAsync( "metrics", msg.c_str() );
+}
+
 bool Mqtinator::Connect()
 {
-    if (! (mHost.addr && mPort))
+    if (mBroker && ! (mHost2.addr && mPort2))
+        mBroker = 0;  // secondary broker removed meanwhile
+    ip_addr_t const & host = mBroker ? mHost2 : mHost;
+    uint16_t  const   port = mBroker ? mPort2 : mPort;
+    if (! (host.addr && port))
         return false;
 
     ESP_LOGD( TAG, "Connect initiated" );
@@ -295,17 +850,11 @@ bool Mqtinator::Connect()
     CallPrep( CALL_CONNECT );
     ESP_LOGD( TAG, "mqtt_client_connect()... - indicating \"status connect\"" );
     Indicator::Instance().Indicate( Indicator::STATUS_CONNECT );
-    err_t e = mqtt_client_connect( & s_client, & mHost, mPort, &mqtt_connection_cb, 0, & ci );
+    err_t e = mqtt_client_connect( & s_client, & host, port, &mqtt_connection_cb, 0, & ci );
     if (e != ERR_OK) {
         CallFailed( CALL_CONNECT );
-        // For now just reboot if something goes wrong
-        ESP_LOGE( TAG, "mqtt_client_connect return %d -> reboot in 1 second", e );
-        Indicator::Instance().Indicate( Indicator::STATUS_ERROR );
-        vTaskDelay( configTICK_RATE_HZ );
-        esp_restart();
-
-        ESP_LOGE( TAG, "restart returned" );
-        return false;
+        ESP_LOGE( TAG, "mqtt_client_connect return %d", e );
+        return ConnectFailed();
     }
 
     ESP_LOGD( TAG, "mqtt_client_connect initiated - waiting for callback" );
@@ -314,57 +863,132 @@ bool Mqtinator::Connect()
     if (mConnStatus != MQTT_CONNECT_ACCEPTED)
     {
         ESP_LOGW( TAG, "Disconnected - status: %d", mConnStatus );
-        Indicator::Instance().Indicate( Indicator::STATUS_ERROR );
-        // try to reconnect
-        mToConnect = true;
-        return true;
+        return ConnectFailed();
     }
 
-    ESP_LOGI( TAG, "Successfully connected - signaling \"0 0\"" );
+    ESP_LOGI( TAG, "Successfully connected to %s broker - signaling \"0 0\"", mBroker ? "secondary" : "primary" );
     Indicator::Instance().SigMask( 0, 0 );
+    mConnFails = 0;
+    mConnSince = now();
+    if (! mConnSince)
+        --mConnSince;
+    if (mDownSince) {
+        mTtrLast = now() - mDownSince;
+        mDownSince = 0;
+        mTtrSum += mTtrLast;
+        if (mTtrMax < mTtrLast)
+            mTtrMax = mTtrLast;
+        ++mReconnCnt;
+    }
+
+    mPubNextSend = 0;
+    mDraining    = GetPubDepth() || mSpillCnt;
+    if (mDraining)
+        ESP_LOGI( TAG, "draining offline backlog: %d queued, %d spilled", GetPubDepth(), mSpillCnt );
 
     mqtt_set_inpub_callback( & s_client, &mqtt_sub_topic_cb, &mqtt_sub_data_cb, /*arg*/0 );
 
-    for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
-        if (mSubCallbackMap[topicGroup].empty())
-            continue;
-        std::string prefix = mSubTopic[topicGroup];
-        if (!prefix.empty())
-            prefix += "/";
-        for (auto it : mSubCallbackMap[topicGroup]) {
-            std::string fullTopic;
-            if (it.first == "-")
-                fullTopic = mSubTopic[topicGroup];
-            else
-                fullTopic = prefix + it.first;
+    SubscribeAll();
 
-            ESP_LOGD( TAG, "subscribing to %s", fullTopic.c_str() );
-            CallPrep( CALL_SUBSCRIBE );
-            err_t err = mqtt_subscribe( & s_client, fullTopic.c_str(), 1, &mqtt_sub_request_cb, /*arg*/0 );
-            if (err != ESP_OK)
-                CallFailed( CALL_SUBSCRIBE );
-            else
-                CallWait( CALL_SUBSCRIBE );
-        }
-    }
     if (mOnConnected)
         mOnConnected( *this );
     return true;
 }
 
+void Mqtinator::SubscribeAll()
+{
+    std::vector<std::string> topics;
+    for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
+        const TopicRouter & router = mSubRouter[topicGroup];
+        bool sharedDone = false;
+        for (uint8_t i = 0; i < router.Patterns(); ++i) {
+            const char * pattern = router.Pattern( i );
+            if (SubShared( topicGroup, pattern )) {
+                if (sharedDone)
+                    continue;
+                sharedDone = true;
+                pattern = "+";
+            }
+            topics.push_back( FullSubTopic( topicGroup, pattern ) );
+        }
+    }
+    if (topics.empty())
+        return;
+
+    // lwip sends one topic per SUBSCRIBE: keep as many requests outstanding
+    // as lwip allows and wait for all responses at once
+    xSemaphoreTake( mCallMutex, portMAX_DELAY );
+    TickType_t const    start  = now();
+    unsigned long const exp    = expiration( 2 );
+    uint8_t             failed = 0;
+    size_t              next   = 0;
+    mSubSent = 0;
+    mSubDone = 0;
+    mSubFailed = 0;
+    while ((next < topics.size()) || (mSubSent != mSubDone)) {
+        while (next < topics.size()) {
+            ESP_LOGD( TAG, "subscribing to %s", topics[next].c_str() );
+            mSubStart[mSubSent % PubWindowMax] = usNow();  // responses come in order of requests
+            ++mSubSent;
+            err_t err = mqtt_subscribe( & s_client, topics[next].c_str(), 1, &mqtt_sub_batch_cb, /*arg*/0 );
+            if (err != ERR_OK) {
+                --mSubSent;
+                if ((err == ERR_MEM) && (mSubSent != mSubDone))
+                    break;  // no free request: wait for a response
+                ESP_LOGW( TAG, "mqtt_subscribe %s return: %d", topics[next].c_str(), err );
+                ++mLatHist[LAT_SUBSCRIBE].failed;
+                ++failed;
+            }
+            ++next;
+        }
+        if (expired( exp )) {
+            ESP_LOGE( TAG, "subscribe timed out: %d of %d responses missing",
+                           (uint8_t) (mSubSent - mSubDone), topics.size() );
+            ++mCbTimoCnt;
+            mLatHist[LAT_SUBSCRIBE].timo += (uint8_t) (mSubSent - mSubDone);
+            break;
+        }
+        xSemaphoreTake( mCbWaitSema, remaining( exp ) );
+    }
+    failed += mSubFailed;
+    mSubPhase = now() - start;
+    xSemaphoreGive( mCallMutex );
+
+    ESP_LOGI( TAG, "subscribed %d topics in %lu ms (%d failed)", topics.size(),
+                   (unsigned long) (mSubPhase * portTICK_PERIOD_MS), failed );
+}
+
 bool Mqtinator::Pub( uint16_t idx, unsigned long val )
 {
-    return Pub( idx, std::to_string( val ) );
+    char   buf[12];
+    char * bp = & buf[sizeof(buf) - 1];
+    *bp = 0;
+    do {
+        *--bp = (char) ('0' + val % 10);
+        val /= 10;
+    } while (val);
+    return Pub( idx, bp );
 }
 
 bool Mqtinator::Pub( uint16_t idx, const std::string str )
 {
-    std::string msg = "{ \"idx\": " + std::to_string( idx )
-                    + ", \"nvalue\": 0"
-                    + ", \"svalue\": \"" + str + "\""
-                    + " }";
+    return Pub( idx, str.c_str() );
+}
+
+bool Mqtinator::Pub( uint16_t idx, const char * svalue )
+{
+    Payload<PubDataLen> msg;
+    msg.Domoticz( idx, 0, svalue );
+    ESP_LOGD( TAG, "publishing \"%s\"", msg.c_str() );
+    return msg.Ok() && PubEnqueue( 0, nullptr, msg.c_str(), msg.Len(), 1, 0, 0, 0 );
+}
+
+bool Mqtinator::Pub( uint16_t idx, long val, uint8_t decimals )
+{
+    DzPayload msg;
+    msg.Domoticz( idx, 0, val, decimals );
     ESP_LOGD( TAG, "publishing \"%s\"", msg.c_str() );
-    return Pub( nullptr, msg.c_str() );
+    return PubEnqueue( 0, nullptr, msg.c_str(), msg.Len(), 1, 0, 0, 0 );
 }
 
 bool Mqtinator::Pub( const char * topic, const char * string, uint8_t qos, uint8_t retain )
@@ -404,8 +1028,11 @@ bool Mqtinator::PubExtended( int8_t topicGroup, const char * topic, const char *
                             mqtt_pub_request_cb, /*arg*/0 );
     if (e != ESP_OK)
         CallFailed( CALL_PUBLISH );
-    else
+    else {
+        ++mMsgCnt[1];
+        mByteCnt[1] += fullTopic.length() + strlen( string );
         CallWait( CALL_PUBLISH );
+    }
 
     // maybe better to not delay alive on each pub, so we can easily check for alive timeout
     // if (mAlivePeriod)
@@ -418,11 +1045,79 @@ bool Mqtinator::PubExtended( int8_t topicGroup, const char * topic, const char *
     return true;
 }
 
+bool Mqtinator::PubAsync( const char * topic, const char * string, uint8_t qos, uint8_t retain,
+                          PubCallback callback, void * userarg )
+{
+    return PubEnqueue( 0, topic, string, strlen( string ), qos, retain, callback, userarg );
+}
+
+bool Mqtinator::WdPubAsync( const char * topic, const char * string, uint8_t qos, uint8_t retain,
+                            PubCallback callback, void * userarg )
+{
+    if (! mPubTopic[1][0])
+        return false;
+    return PubEnqueue( 1, topic, string, strlen( string ), qos, retain, callback, userarg );
+}
+
+bool Mqtinator::PubEnqueue( int8_t topicGroup, const char * topic, const char * string, size_t len,
+                            uint8_t qos, uint8_t retain, PubCallback callback, void * userarg )
+{
+    PubStats & stats = mPubStats[topicGroup];
+    uint16_t const key = callback ? 0 : DomoticzIdx( topic, string );
+    if ((len >= PubDataLen) || (topic && (strlen( topic ) >= PubTopicLen))) {
+        ESP_LOGE( TAG, "async publish dropped: topic or payload too long" );
+        ++stats.dropped;
+        return false;
+    }
+    if (! mPubMutex)
+        return false;  // not initialized
+
+    xSemaphoreTake( mPubMutex, portMAX_DELAY );
+    if ((! callback) && PubCoalesce( topicGroup, topic, key, retain, string, len )) {
+        ++stats.coalesced;
+        xSemaphoreGive( mPubMutex );
+        return true;
+    }
+    if ((uint8_t) (mPubTail - mPubHead) >= PubQueueLen) {
+        xSemaphoreGive( mPubMutex );
+        ESP_LOGW( TAG, "async publish dropped: queue full" );
+        ++stats.dropped;
+        return false;
+    }
+    PubSlot & slot = mPubSlot[mPubTail % PubQueueLen];
+    slot.topicGroup = topicGroup;
+    slot.qos        = qos;
+    slot.retain     = retain;
+    slot.len        = (uint8_t) len;
+    slot.key        = key;
+    slot.callback   = callback;
+    slot.userarg    = userarg;
+    slot.queued     = now();
+    if (topic)
+        strcpy( slot.topic, topic );
+    else
+        slot.topic[0] = 0;
+    memcpy( slot.data, string, len );
+    slot.data[len]  = 0;
+    slot.state      = PUB_QUEUED;
+    ++mPubTail;
+    ++stats.queued;
+    xSemaphoreGive( mPubMutex );
+
+    xSemaphoreGive( mSemaphore );
+    return true;
+}
+
 bool Mqtinator::Sub( const char * topic, SubCallback callback )
 {
     return SubExtended( 0, topic, callback );
 }
 
+bool Mqtinator::Sub( const char * topic, SubCallback callback, SubQueue & queue )
+{
+    return SubExtended( 0, topic, callback, & queue );  // bound by the router entry: gone on unsubscribe
+}
+
 bool Mqtinator::WdSub( const char * topic, SubCallback callback )
 {
     if (! mSubTopic[1][0])
@@ -430,22 +1125,51 @@ bool Mqtinator::WdSub( const char * topic, SubCallback callback )
     return SubExtended( 1, topic, callback );
 }
 
-bool Mqtinator::SubExtended( int8_t topicGroup, const char * topic, SubCallback callback )
+bool Mqtinator::SubShared( int8_t topicGroup, const char * topic ) const
+{
+    // domoticz: all device idx topics are covered by one subscription "<sub>/+"
+    if ((mFormat != 'd') || ! *topic)
+        return false;
+    for (; *topic; ++topic)
+        if ((*topic < '0') || (*topic > '9'))
+            return false;
+    return true;
+}
+
+std::string Mqtinator::FullSubTopic( int8_t topicGroup, const char * topic ) const
 {
     std::string fullTopic = mSubTopic[topicGroup];
-    if (topic) {
+    if (strcmp( topic, "-" )) {
         if (!fullTopic.empty())
             fullTopic += "/";
         fullTopic += topic;
     }
+    return fullTopic;
+}
 
+bool Mqtinator::SubExtended( int8_t topicGroup, const char * topic, SubCallback callback, SubQueue * queue )
+{
     if (! topic)
         topic = "-";
 
+    TopicRouter & router = mSubRouter[topicGroup];
+    bool const changed = callback ? router.Add( topic, callback, queue ) : router.Remove( topic );
+    if (! changed)
+        return true;  // just another callback on subscribed topic
+    if (SubShared( topicGroup, topic )) {
+        uint8_t shared = 0;
+        for (uint8_t i = 0; i < router.Patterns(); ++i)
+            if (SubShared( topicGroup, router.Pattern( i ) ))
+                ++shared;
+        if (shared != (callback ? 1 : 0))
+            return true;  // shared subscription already there / still in use
+        topic = "+";
+    }
+    std::string fullTopic = FullSubTopic( topicGroup, topic );
+
     err_t e = ERR_OK;
     if (callback) {
         // Subscribe to a topic with QoS level 1, call mqtt_sub_request_cb with result
-        mSubCallbackMap[topicGroup][ topic ] = callback;
         if (mConnStatus == MQTT_CONNECT_ACCEPTED) {
             CallPrep( CALL_SUBSCRIBE );
             e = mqtt_subscribe( & s_client, fullTopic.c_str(), /*qos*/1, &mqtt_sub_request_cb, /*arg*/0 );
@@ -465,7 +1189,6 @@ bool Mqtinator::SubExtended( int8_t topicGroup, const char * topic, SubCallback
             } else
                 CallWait( CALL_SUBSCRIBE );
         }
-        mSubCallbackMap[topicGroup].erase( topic );
     }
     return (e == ERR_OK);
 }
@@ -490,11 +1213,24 @@ bool Mqtinator::ReadParam()
 
     nvs_get_u32( my_handle,    s_keyHost,        & mHost.addr );
     nvs_get_u16( my_handle,    s_keyPort,        & mPort );
+    nvs_get_u32( my_handle,    s_keyHost2,       & mHost2.addr );
+    nvs_get_u16( my_handle,    s_keyPort2,       & mPort2 );
+    nvs_get_u8(  my_handle,    s_keyRebootAfter, & mRebootAfter );
     if (nvs_get_u8( my_handle, s_keyFormat,      & fmtu8 ) == ESP_OK)
                                                    mFormat = fmtu8;
     nvs_get_u16( my_handle,    s_keyPrimStatIdx, & mStatusIdx[0] );
     nvs_get_u16( my_handle,    s_keySecStatIdx,  & mStatusIdx[1] );
     nvs_get_u16( my_handle,    s_keyAlive,       & mAlivePeriod );
+    nvs_get_u8(  my_handle,    s_keyPubWindow,   & mPubWindow );
+    nvs_get_u8(  my_handle,    s_keyDrainRate,   & mDrainRate );
+    if (nvs_get_u8( my_handle, s_keySpill,       & fmtu8 ) == ESP_OK)
+                                                   mSpill = fmtu8 != 0;
+    if (nvs_get_u8( my_handle, s_keyMetrics,     & fmtu8 ) == ESP_OK)
+                                                   mPubMetrics = fmtu8 != 0;
+    if (mPubWindow < 1)
+        mPubWindow = 1;
+    else if (mPubWindow > PubWindowMax)
+        mPubWindow = PubWindowMax;
 
     for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
         len = sizeof(mPubTopic[0]); nvs_get_str( my_handle, s_keyPubTopic[topicGroup], mPubTopic[topicGroup], &len );
@@ -514,6 +1250,9 @@ bool Mqtinator::SetParam()
     esp_err_t e = ESP_OK;
     if (e == ESP_OK) e = nvs_set_u32( my_handle, s_keyHost,        mHost.addr );
     if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keyPort,        mPort );
+    if (e == ESP_OK) e = nvs_set_u32( my_handle, s_keyHost2,       mHost2.addr );
+    if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keyPort2,       mPort2 );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyRebootAfter, mRebootAfter );
     for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
         if (e == ESP_OK) e = nvs_set_str( my_handle, s_keyPubTopic[topicGroup], mPubTopic[topicGroup] );
         if (e == ESP_OK) e = nvs_set_str( my_handle, s_keySubTopic[topicGroup], mSubTopic[topicGroup] );
@@ -522,6 +1261,10 @@ bool Mqtinator::SetParam()
     if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keyPrimStatIdx, mStatusIdx[0] );
     if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keySecStatIdx,  mStatusIdx[1] );
     if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keyAlive,       mAlivePeriod );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyPubWindow,   mPubWindow );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyDrainRate,   mDrainRate );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keySpill,       mSpill ? 1 : 0 );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyMetrics,     mPubMetrics ? 1 : 0 );
     if (e == ESP_OK)
         e = nvs_commit( my_handle );
     else
@@ -540,8 +1283,15 @@ extern "C" void mqtt_connection_cb( mqtt_client_t           * client,
 }
 void Mqtinator::CbConnect( mqtt_client_t * client, void * arg, mqtt_connection_status_t status )
 {
+    bool const lost = (mConnStatus == MQTT_CONNECT_ACCEPTED) && (status != MQTT_CONNECT_ACCEPTED);
     mConnStatus = status;
     CallDone( CALL_CONNECT, status == MQTT_CONNECT_ACCEPTED );
+    if (lost) {  // broker closed connection or keep alive timed out
+        ConnEnd();
+        mDownSince = now();
+        mToConnect = true;
+        xSemaphoreGive( mSemaphore );
+    }
 }
 
 extern "C" void mqtt_pub_request_cb( void * arg, err_t result )
@@ -554,6 +1304,26 @@ void Mqtinator::CbPubDone( void * arg, err_t result )
     CallDone( CALL_PUBLISH, result == ESP_OK );
 }
 
+extern "C" void mqtt_pub_async_cb( void * arg, err_t result )
+{
+    Mqtinator::Instance().CbPubAsync( arg, result );
+}
+void Mqtinator::CbPubAsync( void * arg, err_t result )
+{
+    uintptr_t const id = (uintptr_t) arg;
+    PubSlot & slot = mPubSlot[(id & 0xff) % PubQueueLen];
+    if ((slot.state != PUB_INFLIGHT) || (slot.gen != (uint8_t) (id >> 8))) {
+        ESP_LOGD( TAG, "CbPubAsync: late callback on recycled slot" );
+        return;
+    }
+    if (result == ERR_OK)
+        mLatHist[LAT_PUBLISH].Add( usNow() - slot.sentUs );
+    else
+        ++mLatHist[LAT_PUBLISH].failed;
+    slot.state = (result == ERR_OK) ? PUB_PASSED : PUB_FAILED;
+    xSemaphoreGive( mSemaphore );
+}
+
 extern "C" void mqtt_sub_request_cb( void * arg, err_t result )
 {
     Mqtinator::Instance().CbSubDone( arg, result );
@@ -564,6 +1334,21 @@ void Mqtinator::CbSubDone( void * arg, err_t result )
     CallDone( CALL_SUBSCRIBE, result == ESP_OK );
 }
 
+extern "C" void mqtt_sub_batch_cb( void * arg, err_t result )
+{
+    Mqtinator::Instance().CbSubBatch( arg, result );
+}
+void Mqtinator::CbSubBatch( void * arg, err_t result )
+{
+    if (result != ERR_OK) {
+        ++mSubFailed;
+        ++mLatHist[LAT_SUBSCRIBE].failed;
+    } else
+        mLatHist[LAT_SUBSCRIBE].Add( usNow() - mSubStart[mSubDone % PubWindowMax] );
+    ++mSubDone;
+    xSemaphoreGive( mCbWaitSema );
+}
+
 extern "C" void mqtt_sub_topic_cb( void * arg, const char * topic, u32_t tot_len )
 {
     Mqtinator::Instance().CbSubTopic( arg, topic, tot_len );
@@ -571,6 +1356,8 @@ extern "C" void mqtt_sub_topic_cb( void * arg, const char * topic, u32_t tot_len
 void Mqtinator::CbSubTopic( void * arg, const char * topic, u32_t tot_len )
 {
     ESP_LOGD( TAG, "CbSubTopic \"%s\" with %d bytes", topic, tot_len );
+    ++mMsgCnt[0];
+    mByteCnt[0] += strlen( topic ) + tot_len;
     int8_t topicGroup;
     for (topicGroup = 0; topicGroup < 2; ++topicGroup) {
         uint8_t slen = strlen(mSubTopic[topicGroup]);
@@ -588,8 +1375,28 @@ void Mqtinator::CbSubTopic( void * arg, const char * topic, u32_t tot_len )
     mTopicGroup = topicGroup;
     strncpy( mInTopic, topic, sizeof(mInTopic) - 1 );
     mInTopic[sizeof(mInTopic) - 1] = 0;
-    mInLen = (uint16_t) tot_len;
+    mInLen = tot_len;
     mInReadLen = 0;
+
+    if (mInCur) {  // previous message not completed
+        mInCur->state = IN_DROPPED;
+        mInCur = 0;
+    }
+
+    uint16_t len = (uint16_t) (tot_len > InMaxLen ? InMaxLen : tot_len);
+    mInCur = InAlloc( sizeof(InMsg) + len + 1 );
+    if (! mInCur) {
+        ESP_LOGW( TAG, "inbound pool full - drop \"%s\" (%d bytes)", mInTopic, tot_len );
+        ++mInOverrunCnt;
+        return;
+    }
+    if (len < tot_len) {
+        ESP_LOGW( TAG, "inbound \"%s\" truncated to %d of %d bytes", mInTopic, len, tot_len );
+        ++mInTruncCnt;
+    }
+    mInCur->topicGroup = topicGroup;
+    mInCur->len        = len;
+    strcpy( mInCur->topic, mInTopic );
 }
 
 extern "C" void mqtt_sub_data_cb( void * arg, const u8_t * data, u16_t len, u8_t flags )
@@ -599,18 +1406,23 @@ extern "C" void mqtt_sub_data_cb( void * arg, const u8_t * data, u16_t len, u8_t
 void Mqtinator::CbSubData( void * arg, const u8_t * data, u16_t len, u8_t flags )
 {
     ESP_LOGD( TAG, "CbSubData \"%.*s\"", len, data );
-    char * const end = & mInData[sizeof(mInData) - 1];
-    char * start = & mInData[mInReadLen];
-    if (start > end)
-        start = end;
-    uint16_t thislen = end - start;
-    if (thislen > len)
-        thislen = len;
-    memcpy( start, data, thislen );
-    mInReadLen += len;  // beyond end, we just increase mInReadLen, until complete
-    if (mInReadLen == mInLen) {
-        start[thislen] = 0;  // string terminator to be set on last read
-        mDataComplete = true;
+    uint32_t const offset = mInReadLen;
+    mInReadLen += len;  // beyond stored length, we just increase mInReadLen, until complete
+
+    if (mInCur && (offset < mInCur->len)) {
+        uint32_t thislen = mInCur->len - offset;
+        if (thislen > len)
+            thislen = len;
+        memcpy( mInCur->Data() + offset, data, thislen );
+    }
+
+    if (mInReadLen < mInLen)
+        return;
+    ++mInMsgCnt;
+    if (mInCur) {
+        mInCur->Data()[mInCur->len] = 0;  // string terminator to be set on last read
+        mInCur->state = IN_COMPLETE;
+        mInCur = 0;
         xSemaphoreGive( mSemaphore );
     }
 }
@@ -636,124 +1448,248 @@ std::string InputField( const char * key, uint8_t maxlength, uint16_t value )
 
 }
 
-void Mqtinator::HttpReq( httpd_req_t * req, bool post )
+std::string Mqtinator::PostParam( httpd_req_t * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
 {
-    std::string err{""};
-
-    while (post)
-    {
-        if (!req->content_len) {
-            err = "no data";
-            break;
-        }
+    if (! req->content_len)
+        return "no data";
+
+    char hostBuf[16];
+    char portBuf[8];
+    char host2Buf[16];
+    char port2Buf[8];
+    char rebootAfterBuf[4];
+    char formatBuf[4];
+    char primStatIdxBuf[8];
+    char secStatIdxBuf[8];
+    char aliveBuf[8];
+    char pubWindowBuf[4];
+    char spillBuf[4];
+    char drainRateBuf[4];
+    char metricsBuf[4];
+    char pub[2][sizeof(mPubTopic[0])];
+    char sub[2][sizeof(mSubTopic[0])];
+    HttpParser::Input in[] = {
+        { s_keyHost,        hostBuf,        sizeof(hostBuf) },
+        { s_keyPort,        portBuf,        sizeof(portBuf) },
+        { s_keyHost2,       host2Buf,       sizeof(host2Buf) },
+        { s_keyPort2,       port2Buf,       sizeof(port2Buf) },
+        { s_keyRebootAfter, rebootAfterBuf, sizeof(rebootAfterBuf) },
+        { s_keyPubTopic[0], pub[0],         sizeof(pub[0]) },
+        { s_keySubTopic[0], sub[0],         sizeof(sub[0]) },
+        { s_keyPubTopic[1], pub[1],         sizeof(pub[1]) },
+        { s_keySubTopic[1], sub[1],         sizeof(sub[1]) },
+        { s_keyFormat,      formatBuf,      sizeof(formatBuf) },
+        { s_keyPrimStatIdx, primStatIdxBuf, sizeof(primStatIdxBuf) },
+        { s_keySecStatIdx,  secStatIdxBuf,  sizeof(secStatIdxBuf) },
+        { s_keyAlive,       aliveBuf,       sizeof(aliveBuf) },
+        { s_keyPubWindow,   pubWindowBuf,   sizeof(pubWindowBuf) },
+        { s_keySpill,       spillBuf,       sizeof(spillBuf) },
+        { s_keyDrainRate,   drainRateBuf,   sizeof(drainRateBuf) },
+        { s_keyMetrics,     metricsBuf,     sizeof(metricsBuf) } };
+    HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
+    JsonApi::Prefill( in, sizeof(in) / sizeof(in[0]), defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    uint16_t   changes = 0;
+    ip_addr_t  host;
+    ip_addr_t  host2;
+    char     * end;
+    host.addr  = ipaddr_addr( hostBuf );
+    host2.addr = host2Buf[0] ? ipaddr_addr( host2Buf ) : 0;
+    uint16_t   port        =   (uint16_t) strtoul( portBuf,  & end, 0 );
+    uint16_t   port2       =   (uint16_t) strtoul( port2Buf, & end, 0 );
+    uint8_t    rebootAfter =   (uint8_t)  strtoul( rebootAfterBuf, & end, 0 );
+    char       format      = formatBuf[0] == '-' ? 0 : formatBuf[0];
+    uint16_t   statIdx[2]  = { (uint16_t) strtoul( primStatIdxBuf, & end, 0 ),
+                               (uint16_t) strtoul( secStatIdxBuf, & end, 0 ) };
+    uint16_t   alivePeriod =   (uint16_t) strtoul( aliveBuf, & end, 0 );
+    uint8_t    pubWindow   =   (uint8_t)  strtoul( pubWindowBuf, & end, 0 );
+    if (pubWindow < 1)
+        pubWindow = 1;
+    else if (pubWindow > PubWindowMax)
+        pubWindow = PubWindowMax;
+    bool       spill       =   strtoul( spillBuf, & end, 0 ) != 0;
+    uint8_t    drainRate   =   (uint8_t)  strtoul( drainRateBuf, & end, 0 );
+    bool       pubMetrics  =   strtoul( metricsBuf, & end, 0 ) != 0;
+    uint16_t const oldAlivePeriod = mAlivePeriod;
+
+    if (host.addr   != mHost.addr)    changes |= 1 << 0;
+    if (port        != mPort)         changes |= 1 << 1;
+    for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
+        if (strcmp( pub[topicGroup], mPubTopic[topicGroup] ))
+            changes |= 1 << 2;
+        if (strcmp( sub[topicGroup], mSubTopic[topicGroup] ))
+            changes |= 1 << 3;
+    }
+    if (format      != mFormat)       changes |= 1 << 4;
+    if (statIdx[0]  != mStatusIdx[0]) changes |= 1 << 5;
+    if (statIdx[1]  != mStatusIdx[1]) changes |= 1 << 6;
+    if (alivePeriod != mAlivePeriod)  changes |= 1 << 7;
+    if (pubWindow   != mPubWindow)    changes |= 1 << 8;
+    if (spill       != mSpill)        changes |= 1 << 9;
+    if (drainRate   != mDrainRate)    changes |= 1 << 10;
+    if ((host2.addr != mHost2.addr) || (port2 != mPort2))
+                                      changes |= 1 << 11;
+    if (rebootAfter != mRebootAfter)  changes |= 1 << 12;
+    if (pubMetrics  != mPubMetrics)   changes |= 1 << 13;
+
+    if (! changes)
+        return "data unchanged";
+
+    mHost.addr = host.addr;
+    mPort = port;
+    mHost2.addr = host2.addr;
+    mPort2 = port2;
+    mRebootAfter = rebootAfter;
+    mFormat = format;
+    mStatusIdx[0] = statIdx[0];
+    mStatusIdx[1] = statIdx[1];
+    mStatusFilter[0].Reset();
+    mStatusFilter[1].Reset();
+    mAlivePeriod = alivePeriod;
+    mPubWindow = pubWindow;
+    mSpill = spill;
+    mDrainRate = drainRate;
+    mPubMetrics = pubMetrics;
+    if (! alivePeriod)
+        mNextAlive = 0;
 
-        char hostBuf[16];
-        char portBuf[8];
-        char formatBuf[4];
-        char primStatIdxBuf[8];
-        char secStatIdxBuf[8];
-        char aliveBuf[8];
-        char pub[2][sizeof(mPubTopic[0])];
-        char sub[2][sizeof(mSubTopic[0])];
-        HttpParser::Input in[] = {
-            { s_keyHost,        hostBuf,        sizeof(hostBuf) },
-            { s_keyPort,        portBuf,        sizeof(portBuf) },
-            { s_keyPubTopic[0], pub[0],         sizeof(pub[0]) },
-            { s_keySubTopic[0], sub[0],         sizeof(sub[0]) },
-            { s_keyPubTopic[1], pub[1],         sizeof(pub[1]) },
-            { s_keySubTopic[1], sub[1],         sizeof(sub[1]) },
-            { s_keyFormat,      formatBuf,      sizeof(formatBuf) },
-            { s_keyPrimStatIdx, primStatIdxBuf, sizeof(primStatIdxBuf) },
-            { s_keySecStatIdx,  secStatIdxBuf,  sizeof(secStatIdxBuf) },
-            { s_keyAlive,       aliveBuf,       sizeof(aliveBuf) } };
-        HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
-
-        const char * parseError = parser.ParsePostData( req );
-        if (parseError) {
-            err = "parser error: ";
-            err += parseError;
-            break;
+    for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
+        strncpy( mPubTopic[topicGroup], pub[topicGroup], sizeof( mPubTopic[0]) ); mPubTopic[topicGroup][ sizeof(mPubTopic[0]) - 1 ] = 0;
+        strncpy( mSubTopic[topicGroup], sub[topicGroup], sizeof( mSubTopic[0]) ); mSubTopic[topicGroup][ sizeof(mSubTopic[0]) - 1 ] = 0;
+    }
+    if (! SetParam()) {
+        ReadParam();
+        return "setting MQTT parameter failed - try again";
+    }
+    if ((changes & 0xf) || ((changes & (1 << 11)) && mBroker)) {
+        mBroker = 0;  // start again with primary broker
+        mConnFails = 0;
+        mToConnect = true;
+        xSemaphoreGive( mSemaphore );
+    }
+    else if (changes & 0x80) {  // alive period changed
+        if (mAlivePeriod) {
+            if (! oldAlivePeriod) {
+                mNextAlive = expiration( configTICK_RATE_HZ );
+                xSemaphoreGive( mSemaphore );
+            } else if (oldAlivePeriod > alivePeriod) {
+                TickType_t next = (mNextAlive - ((oldAlivePeriod - mAlivePeriod) * configTICK_RATE_HZ));
+                if (! next)
+                    --next;
+                long diff = next - now();
+                if (diff < configTICK_RATE_HZ)
+                    mNextAlive = expiration( configTICK_RATE_HZ );
+                else
+                    mNextAlive = next;
+                xSemaphoreGive( mSemaphore );
+            } // else: enlarge period -> not change next
         }
+    }
+    return std::string{};
+}
 
-        uint8_t    changes = 0;
-        ip_addr_t  host;
-        char     * end;
-        host.addr = ipaddr_addr( hostBuf );
-        uint16_t   port        =   (uint16_t) strtoul( portBuf,  & end, 0 );
-        char       format      = formatBuf[0] == '-' ? 0 : formatBuf[0];
-        uint16_t   statIdx[2]  = { (uint16_t) strtoul( primStatIdxBuf, & end, 0 ),
-                                   (uint16_t) strtoul( secStatIdxBuf, & end, 0 ) };
-        uint16_t   alivePeriod =   (uint16_t) strtoul( aliveBuf, & end, 0 );
-        uint16_t const oldAlivePeriod = mAlivePeriod;
-
-        if (host.addr   != mHost.addr)    changes |= 1 << 0;
-        if (port        != mPort)         changes |= 1 << 1;
-        for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
-            if (strcmp( pub[topicGroup], mPubTopic[topicGroup] ))
-                changes |= 1 << 2;
-            if (strcmp( sub[topicGroup], mSubTopic[topicGroup] ))
-                changes |= 1 << 3;
-        }
-        if (format      != mFormat)       changes |= 1 << 4;
-        if (statIdx[0]  != mStatusIdx[0]) changes |= 1 << 5;
-        if (statIdx[1]  != mStatusIdx[1]) changes |= 1 << 6;
-        if (alivePeriod != mAlivePeriod)  changes |= 1 << 7;
-
-        if (! changes) {
-            err = "data unchanged";
-            break;
-        }
+void Mqtinator::Api( httpd_req_t * req )
+{
+    JsonApi::Field const fields[] = {
+        JsonApi::Ip( s_keyHost,        mHost.addr ),
+        JsonApi::F(  s_keyPort,        mPort ),
+        JsonApi::Ip( s_keyHost2,       mHost2.addr ),
+        JsonApi::F(  s_keyPort2,       mPort2 ),
+        JsonApi::F(  s_keyRebootAfter, mRebootAfter ),
+        JsonApi::F(  s_keyPubTopic[0], mPubTopic[0] ),
+        JsonApi::F(  s_keySubTopic[0], mSubTopic[0] ),
+        JsonApi::F(  s_keyPubTopic[1], mPubTopic[1] ),
+        JsonApi::F(  s_keySubTopic[1], mSubTopic[1] ),
+        JsonApi::F(  s_keyFormat,      mFormat ),
+        JsonApi::F(  s_keyPrimStatIdx, mStatusIdx[0] ),
+        JsonApi::F(  s_keySecStatIdx,  mStatusIdx[1] ),
+        JsonApi::F(  s_keyAlive,       mAlivePeriod ),
+        JsonApi::F(  s_keyPubWindow,   mPubWindow ),
+        JsonApi::F(  s_keySpill,       mSpill ),
+        JsonApi::F(  s_keyDrainRate,   mDrainRate ),
+        JsonApi::F(  s_keyMetrics,     mPubMetrics ) };
+    uint8_t const n = sizeof(fields) / sizeof(fields[0]);
+    std::string err{};
+    if (req->method == HTTP_POST)
+        err = PostParam( req, fields, n );
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, n );
+
+    json.Open( "conn" );
+    json.Bool( "connected", mConnStatus == MQTT_CONNECT_ACCEPTED );
+    json.Uint( "broker",    mBroker );
+    json.Uint( "fails",     mConnFails );
+    json.Uint( "reconnects", mReconnCnt );
+    json.Uint( "uptime",    GetConnUptime() );
+    json.Uint( "total",     mConnTotal + GetConnUptime() );
+    json.Close();
+
+    json.Open( "traffic" );
+    static const char * const s_dir[2] = { "in", "out" };
+    for (uint8_t dir = 0; dir < 2; ++dir) {
+        json.Open( s_dir[dir] );
+        json.Uint( "msgs",  mMsgCnt[dir] );
+        json.Uint( "rate",  mMsgRate[dir] );
+        json.Uint( "bytes", mByteCnt[dir] );
+        json.Close();
+    }
+    json.Close();
 
-        mHost.addr = host.addr;
-        mPort = port;
-        mFormat = format;
-        mStatusIdx[0] = statIdx[0];
-        mStatusIdx[1] = statIdx[1];
-        mAlivePeriod = alivePeriod;
-        if (! alivePeriod)
-            mNextAlive = 0;
+    json.Open( "pub", '[' );
+    for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
+        const PubStats & stats = mPubStats[topicGroup];
+        JsonApi::Field const pub[] = { JsonApi::F( "queued",    stats.queued ),
+                                       JsonApi::F( "passed",    stats.passed ),
+                                       JsonApi::F( "failed",    stats.failed ),
+                                       JsonApi::F( "timo",      stats.timo ),
+                                       JsonApi::F( "dropped",   stats.dropped ),
+                                       JsonApi::F( "coalesced", stats.coalesced ),
+                                       JsonApi::F( "spilled",   stats.spilled ) };
+        json.Open( 0 );
+        json.Add( pub, sizeof(pub) / sizeof(pub[0]) );
+        json.Close();
+    }
+    json.Close();
+    json.Uint( "pubdepth",   GetPubDepth() );
+    json.Uint( "spilldepth", GetSpillDepth() );
+
+    json.Open( "latency" );
+    static const char * const s_latOp[LAT_COUNT] = { "connect", "subscribe", "publish" };
+    for (uint8_t op = 0; op < LAT_COUNT; ++op) {
+        const LatHist & hist = mLatHist[op];
+        json.Open( s_latOp[op] );
+        json.Uint( "passed", hist.Passed() );
+        json.Uint( "failed", hist.failed );
+        json.Uint( "timo",   hist.timo );
+        json.Uint( "avgms",  hist.AvgMs() );
+        json.Uint( "maxus",  hist.maxUs );
+        json.Open( "hist", '[' );
+        for (uint8_t b = 0; b < LatBuckets; ++b)
+            json.Uint( 0, hist.cnt[b] );
+        json.Close();
+        json.Close();
+    }
+}
 
-        for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
-            strncpy( mPubTopic[topicGroup], pub[topicGroup], sizeof( mPubTopic[0]) ); mPubTopic[topicGroup][ sizeof(mPubTopic[0]) - 1 ] = 0;
-            strncpy( mSubTopic[topicGroup], sub[topicGroup], sizeof( mSubTopic[0]) ); mSubTopic[topicGroup][ sizeof(mSubTopic[0]) - 1 ] = 0;
-        }
-        if (! SetParam()) {
-            ReadParam();
-            err = "setting MQTT parameter failed - try again";
-            break;
-        }
-        if (changes & 0xf) {
-            mToConnect = true;
-            xSemaphoreGive( mSemaphore );
-        }
-        else if (changes & 0x80) {  // alive period changed
-            if (mAlivePeriod) {
-                if (! oldAlivePeriod) {
-                    mNextAlive = expiration( configTICK_RATE_HZ );
-                    xSemaphoreGive( mSemaphore );
-                } else if (oldAlivePeriod > alivePeriod) {
-                    TickType_t next = (mNextAlive - ((oldAlivePeriod - mAlivePeriod) * configTICK_RATE_HZ));
-                    if (! next)
-                        --next;
-                    long diff = next - now();
-                    if (diff < configTICK_RATE_HZ)
-                        mNextAlive = expiration( configTICK_RATE_HZ );
-                    else
-                        mNextAlive = next;
-                    xSemaphoreGive( mSemaphore );
-                } // else: enlarge period -> not change next
-            }
-        }
-        break;
-    } // pseudo while loop - just checked for post with some early break
+void Mqtinator::HttpReq( httpd_req_t * req, bool post )
+{
+    std::string err{""};
+    if (post)
+        err = PostParam( req );
 
     HttpHelper hh{ req, s_subMqtt, "MQTT" };
 
     hh.Add( "  <form method=\"post\">\n"
             "   <table border=0>\n" );
     {
-        Table<11,4> table;
-        table.Right( 0 );
+        Table<18,4,Cols(0)> table;
         table[0][1] = "&nbsp;";
 
         table[0][0] = "Host:";
@@ -770,49 +1706,85 @@ void Mqtinator::HttpReq( httpd_req_t * req, bool post )
         table[1][2] = InputField( s_keyPort, 5, mPort );
         table[1][3] = "(listening port of MQTT broker)";
 
-        table[2][0] = "Publish topic:";
-        table[2][2] = InputField( s_keyPubTopic[0], sizeof(mPubTopic[0])-1, mPubTopic[0] );
-        table[2][3] = "(top level topic for publish)";
+        table[2][0] = "Secondary host:";
+        {
+            char buf[16];
+            buf[0] = 0;
+            if (mHost2.addr)
+                ip4addr_ntoa_r( & mHost2, buf, sizeof(buf) );
+            table[2][2] = InputField( s_keyHost2, 15, buf );
+        }
+        table[2][3] = "(IPv4 address of fail over broker - empty: none)";
+
+        table[3][0] = "Secondary port:";
+        table[3][2] = InputField( s_keyPort2, 5, mPort2 );
+        table[3][3] = "(listening port of fail over broker)";
+
+        table[4][0] = "Publish topic:";
+        table[4][2] = InputField( s_keyPubTopic[0], sizeof(mPubTopic[0])-1, mPubTopic[0] );
+        table[4][3] = "(top level topic for publish)";
 
-        table[3][0] = "Subscribe topic:";
-        table[3][2] = InputField( s_keySubTopic[0], sizeof(mSubTopic[0])-1, mSubTopic[0] );
-        table[3][3] = "(top level subscription topic)";
+        table[5][0] = "Subscribe topic:";
+        table[5][2] = InputField( s_keySubTopic[0], sizeof(mSubTopic[0])-1, mSubTopic[0] );
+        table[5][3] = "(top level subscription topic)";
 
-        table[4][0] = "WD publish topic:";
-        table[4][2] = InputField( s_keyPubTopic[1], sizeof(mPubTopic[0])-1, mPubTopic[1] );
-        table[4][3] = "(top level topic for publish watchdog confirmation)";
+        table[6][0] = "WD publish topic:";
+        table[6][2] = InputField( s_keyPubTopic[1], sizeof(mPubTopic[0])-1, mPubTopic[1] );
+        table[6][3] = "(top level topic for publish watchdog confirmation)";
 
-        table[5][0] = "WD subscribe topic:";
-        table[5][2] = InputField( s_keySubTopic[1], sizeof(mSubTopic[0])-1, mSubTopic[1] );
-        table[5][3] = "(top level watchdog subscription topic)";
+        table[7][0] = "WD subscribe topic:";
+        table[7][2] = InputField( s_keySubTopic[1], sizeof(mSubTopic[0])-1, mSubTopic[1] );
+        table[7][3] = "(top level watchdog subscription topic)";
 
-        table[6][0] = "General format:";
+        table[8][0] = "General format:";
         {
             char buf[2];
             buf[0] = mFormat ? mFormat : '-';
             buf[1] = 0;
-            table[6][2] = InputField( s_keyFormat, 1, buf );
+            table[8][2] = InputField( s_keyFormat, 1, buf );
         }
-        table[6][3] = "(-: flat / d: domoticz)";
+        table[8][3] = "(-: flat / d: domoticz)";
+
+        table[9][0] = "Primary status idx:";
+        table[9][2] = InputField( s_keyPrimStatIdx, 5, mStatusIdx[0] );
+        table[9][3] = "(domoticz device index for publish primary status value)";
+
+        table[10][0] = "Secondary status idx:";
+        table[10][2] = InputField( s_keySecStatIdx, 5, mStatusIdx[1] );
+        table[10][3] = "(domoticz device index for publish scondary status value)";
 
-        table[7][0] = "Primary status idx:";
-        table[7][2] = InputField( s_keyPrimStatIdx, 5, mStatusIdx[0] );
-        table[7][3] = "(domoticz device index for publish primary status value)";
+        table[11][0] = "Alive status message period:";
+        table[11][2] = InputField( s_keyAlive, 5, mAlivePeriod );
+        table[11][3] = "[s] (0 = no keep alives)";
 
-        table[8][0] = "Secondary status idx:";
-        table[8][2] = InputField( s_keySecStatIdx, 5, mStatusIdx[1] );
-        table[8][3] = "(domoticz device index for publish scondary status value)";
+        table[12][0] = "Publish window:";
+        table[12][2] = InputField( s_keyPubWindow, 1, mPubWindow );
+        table[12][3] = "(max. # of async publishes in flight: 1..";
+        table[12][3] += HttpHelper::String( (uint32_t) PubWindowMax ) + ")";
 
-        table[9][0] = "Alive status message period:";
-        table[9][2] = InputField( s_keyAlive, 5, mAlivePeriod );
-        table[9][3] = "[s] (0 = no keep alives)";
+        table[13][0] = "Offline spill:";
+        table[13][2] = InputField( s_keySpill, 1, mSpill ? 1 : 0 );
+        table[13][3] = "(1: move publishes into nvs while broker unreachable - max. ";
+        table[13][3] += HttpHelper::String( (uint32_t) SpillLen ) + ")";
 
-        table[10][2] = "<button type=\"submit\">set</button>";
+        table[14][0] = "Drain rate:";
+        table[14][2] = InputField( s_keyDrainRate, 3, mDrainRate );
+        table[14][3] = "[1/s] (publish rate of offline backlog after reconnect, 0 = no limit)";
+
+        table[15][0] = "Reboot after failures:";
+        table[15][2] = InputField( s_keyRebootAfter, 3, mRebootAfter );
+        table[15][3] = "(# of connect failures in a row to reboot, 0 = never)";
+
+        table[16][0] = "Publish metrics:";
+        table[16][2] = InputField( s_keyMetrics, 1, mPubMetrics ? 1 : 0 );
+        table[16][3] = "(1: publish latency and traffic metrics on WD topic \"metrics\" with alive period)";
+
+        table[17][2] = "<button type=\"submit\">set</button>";
         if (post) {
             if (err.empty())
-                table[10][3] = "setup succeeded";
+                table[17][3] = "setup succeeded";
             else
-                table[10][3] = "setup failed: " + err;
+                table[17][3] = "setup failed: " + err;
         }
 
         table.AddTo( hh );
@@ -822,17 +1794,197 @@ void Mqtinator::HttpReq( httpd_req_t * req, bool post )
 
     hh.Add( "  <table border=0>\n" );
     {
-        Table<3,3> table;
-        table.Right( 0 );
-        table.Right( 2 );
+        Table<15,3,Cols(0, 2)> table;
         table[0][1] = "&nbsp;";
         table[0][0] = "callback with success:";
         table[1][0] = "callback with error:";
         table[2][0] = "callback timed out:";
+        table[3][0] = "inbound messages:";
+        table[4][0] = "inbound overruns:";
+        table[5][0] = "inbound truncated:";
         table[0][2] = HttpHelper::String( (uint32_t) Mqtinator::Instance().GetCbPassedCnt() );
         table[1][2] = HttpHelper::String( (uint32_t) Mqtinator::Instance().GetCbFailedCnt() );
         table[2][2] = HttpHelper::String( (uint32_t) Mqtinator::Instance().GetCbTimoCnt() );
+        table[3][2] = HttpHelper::String( (uint32_t) GetInMsgCnt() );
+        table[4][2] = HttpHelper::String( (uint32_t) GetInOverrunCnt() );
+        table[5][2] = HttpHelper::String( (uint32_t) GetInTruncCnt() );
+        table[6][0] = "active broker:";
+        table[7][0] = "connect failures in a row:";
+        table[8][0] = "re-connects:";
+        table[9][0] = "avg. time to re-connect [s]:";
+        table[10][0] = "max. time to re-connect [s]:";
+        table[11][0] = "last time to re-connect [s]:";
+        table[6][2] = mBroker ? "secondary" : "primary";
+        table[7][2] = HttpHelper::String( (uint32_t) mConnFails );
+        table[8][2] = HttpHelper::String( (uint32_t) mReconnCnt );
+        if (mReconnCnt)
+            table[9][2] = HttpHelper::String( (float) mTtrSum / mReconnCnt / configTICK_RATE_HZ, 1 );
+        table[10][2] = HttpHelper::String( (float) mTtrMax / configTICK_RATE_HZ, 1 );
+        table[11][2] = HttpHelper::String( (float) mTtrLast / configTICK_RATE_HZ, 1 );
+        table[12][0] = "last subscribe phase [ms]:";
+        table[12][2] = HttpHelper::String( (uint32_t) (mSubPhase * portTICK_PERIOD_MS) );
+        table[13][0] = "connection uptime [s]:";
+        table[14][0] = "total time connected [s]:";
+        table[13][2] = HttpHelper::String( GetConnUptime() );
+        table[14][2] = HttpHelper::String( mConnTotal + GetConnUptime() );
         table.AddTo( hh );
     }
     hh.Add( "\n  </table>\n" );
+
+    hh.Add( "  <br />\n"
+            "  <table border=0>\n" );
+    {
+        Table<13,4,Cols(0, 2, 3)> table;
+        table[0][1] = "&nbsp;";
+        table[0][2] = "publish";
+        table[0][3] = "WD publish";
+        table[1][0] = "async queued:";
+        table[2][0] = "async passed:";
+        table[3][0] = "async failed:";
+        table[4][0] = "async timed out:";
+        table[5][0] = "async dropped:";
+        table[6][0] = "async coalesced:";
+        table[7][0] = "async spilled:";
+        table[8][0] = "avg. latency [ms]:";
+        table[9][0] = "max. latency [ms]:";
+        table[10][0] = "queue depth:";
+        table[11][0] = "spill depth:";
+        table[12][0] = "bytes pending:";
+        for (int8_t topicGroup = 0; topicGroup < 2; ++topicGroup) {
+            const PubStats & stats = mPubStats[topicGroup];
+            const uint8_t c = 2 + topicGroup;
+            table[1][c] = HttpHelper::String( (uint32_t) stats.queued );
+            table[2][c] = HttpHelper::String( (uint32_t) stats.passed );
+            table[3][c] = HttpHelper::String( (uint32_t) stats.failed );
+            table[4][c] = HttpHelper::String( (uint32_t) stats.timo );
+            table[5][c] = HttpHelper::String( (uint32_t) stats.dropped );
+            table[6][c] = HttpHelper::String( (uint32_t) stats.coalesced );
+            table[7][c] = HttpHelper::String( (uint32_t) stats.spilled );
+            if (stats.passed)
+                table[8][c] = HttpHelper::String( (uint32_t) (stats.latSum * portTICK_PERIOD_MS / stats.passed) );
+            table[9][c] = HttpHelper::String( (uint32_t) (stats.latMax * portTICK_PERIOD_MS) );
+        }
+        table[10][2] = HttpHelper::String( (uint32_t) GetPubDepth() ) + " / "
+                     + HttpHelper::String( (uint32_t) PubQueueLen );
+        table[11][2] = HttpHelper::String( (uint32_t) GetSpillDepth() ) + " / "
+                     + HttpHelper::String( (uint32_t) SpillLen );
+        table[12][2] = HttpHelper::String( GetPubBytes() );
+        table.AddTo( hh, 1 );
+    }
+    hh.Add( "\n  </table>\n" );
+
+    hh.Add( "  <br />\n"
+            "  <table border=0>\n" );
+    {
+        Table<4,4,Cols(0, 2, 3)> table;
+        table[0][1] = "&nbsp;";
+        table[0][2] = "in";
+        table[0][3] = "out";
+        table[1][0] = "messages:";
+        table[2][0] = "messages last minute:";
+        table[3][0] = "bytes:";
+        for (uint8_t dir = 0; dir < 2; ++dir) {
+            table[1][2 + dir] = HttpHelper::String( mMsgCnt[dir] );
+            table[2][2 + dir] = HttpHelper::String( (uint32_t) mMsgRate[dir] );
+            table[3][2 + dir] = HttpHelper::String( mByteCnt[dir] );
+        }
+        table.AddTo( hh, 1 );
+    }
+    hh.Add( "\n  </table>\n" );
+
+    hh.Add( "  <br />\n"
+            "  <table border=0>\n" );
+    {
+        static const char * const s_latOp[LAT_COUNT] = { "connect", "subscribe", "publish" };
+        Table<1,6 + LatBuckets,ColRange(1, 6 + LatBuckets)> table;
+        table[0][0] = "latency [ms]";
+        table[0][1] = "passed";
+        table[0][2] = "failed";
+        table[0][3] = "timed out";
+        table[0][4] = "avg.";
+        table[0][5] = "max.";
+        for (uint8_t b = 0; b < LatBuckets - 1; ++b)
+            table[0][6 + b] = "&lt;" + HttpHelper::String( (uint32_t) ((1ul << (LatMinShift + b)) / 1000) );
+        table[0][5 + LatBuckets] = "more";
+        table.AddTo( hh, /*headrows*/ 1 );
+
+        for (uint8_t op = 0; op < LAT_COUNT; ++op) {
+            const LatHist & hist = mLatHist[op];
+            table[0][0] = s_latOp[op];
+            table[0][1] = HttpHelper::String( hist.Passed() );
+            table[0][2] = HttpHelper::String( (uint32_t) hist.failed );
+            table[0][3] = HttpHelper::String( (uint32_t) hist.timo );
+            table[0][4] = HttpHelper::String( hist.AvgMs() );
+            table[0][5] = HttpHelper::String( (float) hist.maxUs / 1000, 1 );
+            for (uint8_t b = 0; b < LatBuckets; ++b)
+                table[0][6 + b] = HttpHelper::String( (uint32_t) hist.cnt[b] );
+            table.AddTo( hh, 0, /*headcols*/ 1 );
+        }
+    }
+    hh.Add( "\n  </table>\n" );
+
+    if (SubQueue::First()) {
+        hh.Add( "  <br />\n"
+                "  <table border=0>\n" );
+        static const char * const s_policy[] = { "drop new", "drop oldest", "block" };
+        Table<1,9,ColRange(2, 9)> table;
+        table[0][0] = "dispatch queue";
+        table[0][1] = "policy";
+        table[0][2] = "depth";
+        table[0][3] = "waiting";
+        table[0][4] = "max. waiting";
+        table[0][5] = "posted";
+        table[0][6] = "processed";
+        table[0][7] = "dropped";
+        table[0][8] = "truncated";
+        table.AddTo( hh, /*headrows*/ 1 );
+
+        for (SubQueue * queue = SubQueue::First(); queue; queue = queue->Next()) {
+            table[0][0] = queue->Name();
+            table[0][1] = s_policy[queue->Policy()];
+            table[0][2] = HttpHelper::String( (uint32_t) queue->Depth() );
+            table[0][3] = HttpHelper::String( (uint32_t) queue->Waiting() );
+            table[0][4] = HttpHelper::String( (uint32_t) queue->HighWater() );
+            table[0][5] = HttpHelper::String( queue->Posted() );
+            table[0][6] = HttpHelper::String( queue->Processed() );
+            table[0][7] = HttpHelper::String( (uint32_t) queue->Dropped() );
+            table[0][8] = HttpHelper::String( (uint32_t) queue->Truncated() );
+            table.AddTo( hh, 0, /*headcols*/ 1 );
+        }
+        hh.Add( "\n  </table>\n" );
+    }
+
+    if (! PubFilter::First())
+        return;
+
+    hh.Add( "  <br />\n"
+            "  <table border=0>\n" );
+    {
+        Table<1,9,ColRange(1, 9)> table;
+        table[0][0] = "channel";
+        table[0][1] = "abs. band";
+        table[0][2] = "rel. band [&permil;]";
+        table[0][3] = "min. interval [s]";
+        table[0][4] = "max. silence [s]";
+        table[0][5] = "sent";
+        table[0][6] = "suppressed";
+        table[0][7] = "rate limited";
+        table[0][8] = "heartbeats";
+        table.AddTo( hh, /*headrows*/ 1 );
+
+        for (PubFilter * filter = PubFilter::First(); filter; filter = filter->Next()) {
+            const PubFilter::Config & cfg = filter->Cfg();
+            table[0][0] = filter->Name();
+            table[0][1] = HttpHelper::String( (uint32_t) cfg.absBand );
+            table[0][2] = HttpHelper::String( (uint32_t) cfg.relBand );
+            table[0][3] = HttpHelper::String( (uint32_t) cfg.minInterval );
+            table[0][4] = HttpHelper::String( (uint32_t) cfg.maxSilence );
+            table[0][5] = HttpHelper::String( (uint32_t) filter->Sent() );
+            table[0][6] = HttpHelper::String( (uint32_t) filter->Suppressed() );
+            table[0][7] = HttpHelper::String( (uint32_t) filter->Limited() );
+            table[0][8] = HttpHelper::String( (uint32_t) filter->Heartbeats() );
+            table.AddTo( hh, 0, /*headcols*/ 1 );
+        }
+    }
+    hh.Add( "\n  </table>\n" );
 }
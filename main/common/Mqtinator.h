@@ -3,13 +3,17 @@
  */
 
 #include <stdint.h>
-#include <map>
+
+#include "TopicRouter.h"
+#include "PubFilter.h"
+#include "JsonApi.h"
 
 #include <mqtt_client.h>
 #include <lwip/apps/mqtt.h>
 
 struct httpd_req;
 class WebServer;
+class SubQueue;
 
 class Mqtinator
 {
@@ -24,37 +28,116 @@ public:
         CALL_DONE_FAILED = 0x80,
     };
     typedef void (*ConnectedCallback)( Mqtinator & mqtinator );
-    typedef void (*SubCallback)( const char * topic, const char * data );
+    typedef TopicRouter::Callback SubCallback;  // void (*)( const char * topic, const char * data )
+    typedef void (*PubCallback)( void * userarg, bool passed );  // async publish completion
+
+    static constexpr uint8_t  PubQueueLen   = 8;    // # of async publish slots (power of 2)
+    static constexpr uint8_t  PubTopicLen   = 32;   // sub topic length (behind mPubTopic + "/")
+    static constexpr uint16_t PubDataLen    = 128;  // max. payload length of async publish
+    static constexpr uint8_t  PubWindowMax  = MQTT_REQ_MAX_IN_FLIGHT;  // lwip limit of pending requests
+    static constexpr uint8_t  SpillLen      = 32;   // # of publishes to spill into nvs while offline
+    static constexpr uint16_t InPoolLen     = 1280; // bytes for inbound messages waiting for the task
+    static constexpr uint16_t InMaxLen      = 800;  // max. payload kept per message (more gets truncated)
+    static constexpr uint16_t BackoffMin    = 2;    // [s] re-connect delay after 1st failure
+    static constexpr uint16_t BackoffMax    = 300;  // [s] max. re-connect delay
+    static constexpr uint8_t  FailoverAfter = 2;    // # of failures in a row to switch the broker
+    static constexpr uint8_t  LatBuckets    = 12;   // latency histogram: < 1 ms, < 2 ms, < 4 ms ... < 1 s, more
+    static constexpr uint8_t  LatMinShift   = 10;   // upper bound of 1st bucket: 2^10 us
+
+    struct PubStats {
+        uint16_t queued  { 0 };  // # of publishes accepted into queue
+        uint16_t passed  { 0 };  // # of publishes confirmed by broker
+        uint16_t failed  { 0 };  // # of publishes rejected by lwip/broker
+        uint16_t timo    { 0 };  // # of publishes without confirmation in time
+        uint16_t dropped { 0 };  // # of publishes not queued (queue full/payload too long)
+        uint16_t coalesced { 0 };  // # of publishes replaced by newer value of same domoticz idx
+        uint16_t spilled { 0 };  // # of publishes stored in nvs while queue full
+        uint32_t latSum  { 0 };  // [ticks] sum of enqueue -> confirmation time of passed ones
+        uint32_t latMax  { 0 };  // [ticks] max. enqueue -> confirmation time
+    };
+
+    enum LAT_OP {  // latency histograms: request -> broker response
+        LAT_CONNECT = 0,
+        LAT_SUBSCRIBE,
+        LAT_PUBLISH,
+        LAT_COUNT
+    };
+    struct LatHist {
+        uint16_t cnt[LatBuckets] {};  // # of passed requests per log2 latency bucket
+        uint16_t failed  { 0 };  // # of requests rejected by lwip/broker
+        uint16_t timo    { 0 };  // # of requests without response in time
+        uint32_t maxUs   { 0 };  // [us] max. latency
+        uint64_t sumUs   { 0 };  // [us] sum of latencies of passed requests
+
+        void     Add( uint32_t us );
+        uint32_t Passed() const;
+        uint32_t AvgMs()  const { uint32_t n = Passed(); return n ? (uint32_t) (sumUs / n / 1000) : 0; };
+    };
 
     Mqtinator() {};
     static Mqtinator & Instance();
 
     void HttpReq( struct httpd_req * req, bool post );
+    void Api( struct httpd_req * req );  // GET/POST /api/mqtt
     void AddPage( WebServer & webServerInstance );  // controlled way to stack
     bool Init();
     void Run();
     bool Pub( uint16_t idx, unsigned long val );
     bool Pub( uint16_t idx, const std::string str );
+    bool Pub( uint16_t idx, const char * svalue );
+    bool Pub( uint16_t idx, long val, uint8_t decimals );  // fixed point svalue
     bool Pub( const char * topic, const char * string, uint8_t qos = 1, uint8_t retain = 0 );
-    bool Sub( const char * topic, SubCallback callback );
+    bool Sub( const char * topic, SubCallback callback );  // callback 0: unsubscribe topic
+    bool Sub( const char * topic, SubCallback callback, SubQueue & queue );  // callback on topic called by queue consumer
     bool WdPub( const char * topic, const char * string, uint8_t qos = 1, uint8_t retain = 0 );
     bool WdSub( const char * topic, SubCallback callback );
     void OnConnected( ConnectedCallback callback );
 
+    // non-blocking: queue the message to be published by the Mqtinator task
+    bool PubAsync(   const char * topic, const char * string, uint8_t qos = 1, uint8_t retain = 0,
+                     PubCallback callback = 0, void * userarg = 0 );
+    bool WdPubAsync( const char * topic, const char * string, uint8_t qos = 1, uint8_t retain = 0,
+                     PubCallback callback = 0, void * userarg = 0 );
+
     void CbConnect(  mqtt_client_t * client, 
                      void * arg, mqtt_connection_status_t status );  // on status change
     void CbPubDone(  void * arg, err_t result );                     // on Pub finished
+    void CbPubAsync( void * arg, err_t result );                     // on PubAsync finished
     void CbSubDone(  void * arg, err_t result );                     // on Sub finished
+    void CbSubBatch( void * arg, err_t result );                     // on SubscribeAll request finished
     void CbSubTopic( void * arg, const char * topic, u32_t tot_len );         // topic of Sub
     void CbSubData(  void * arg, const u8_t * data, u16_t len, u8_t flags );  // data of Sub
 
     uint16_t GetCbPassedCnt() const { return mCbPassedCnt; };
     uint16_t GetCbFailedCnt() const { return mCbFailedCnt; };
     uint16_t GetCbTimoCnt()   const { return mCbTimoCnt; };
+    uint16_t GetInMsgCnt()    const { return mInMsgCnt; };
+    uint16_t GetInOverrunCnt() const { return mInOverrunCnt; };
+    uint16_t GetInTruncCnt()  const { return mInTruncCnt; };
+    const PubStats & GetPubStats( int8_t topicGroup ) const { return mPubStats[topicGroup & 1]; };
+    uint8_t  GetPubDepth()    const { return (uint8_t) (mPubTail - mPubHead); };
+    uint8_t  GetSpillDepth()  const { return mSpillCnt; };
+    uint32_t GetPubBytes()    const;  // payload bytes held in queue and spill area
+    uint16_t GetPubDropped()  const { return mPubStats[0].dropped + mPubStats[1].dropped; };
+    const LatHist & GetLatHist( LAT_OP op ) const { return mLatHist[op]; };
+    uint32_t GetConnUptime()  const;  // [s] of current connection (0: not connected)
 
 private:
+    std::string PostParam( struct httpd_req * req, const JsonApi::Field * defaults = 0, uint8_t nofDefaults = 0 );
     bool PubExtended( int8_t topicGroup, const char * topic, const char * string, uint8_t qos = 1, uint8_t retain = 0 );
-    bool SubExtended( int8_t topicGroup, const char * topic, SubCallback callback );
+    bool SubExtended( int8_t topicGroup, const char * topic, SubCallback callback, SubQueue * queue = 0 );
+    bool SubShared(   int8_t topicGroup, const char * topic ) const;
+    std::string FullSubTopic( int8_t topicGroup, const char * topic ) const;
+    bool PubEnqueue(  int8_t topicGroup, const char * topic, const char * string, size_t len,
+                      uint8_t qos, uint8_t retain, PubCallback callback, void * userarg );
+    void PubDrain();
+    void PubAbort();
+    bool PubCoalesce( int8_t topicGroup, const char * topic, uint16_t key, uint8_t retain,
+                      const char * string, size_t len );
+    bool SpillPut();   // move oldest queued publish into nvs
+    bool SpillGet();   // move newest spilled publish back in front of the queue
+    void SpillScan();
+    void InDispatch();
 
     void CallPrep(   CALL_STATUS callStatus );
     void CallFailed( CALL_STATUS callStatus );
@@ -62,6 +145,11 @@ private:
     bool CallWait(   CALL_STATUS callStatus );
 
     bool Connect();
+    void SubscribeAll();
+    bool ConnectFailed();
+    void ConnEnd();
+    void MetricsPub();
+    TickType_t Backoff();
     bool ReadParam();
     bool SetParam();
 
@@ -69,12 +157,27 @@ private:
     uint8_t                  mCallStatus { CALL_IDLE };
 
     bool       mToConnect    { false };
-    bool       mDataComplete { false };
 
     ip_addr_t  mHost         { 0 };
     uint16_t   mPort         { 1883 };
+    ip_addr_t  mHost2        { 0 };  // secondary broker (0: none)
+    uint16_t   mPort2        { 1883 };
+    uint8_t    mBroker       { 0 };  // 0: primary / 1: secondary broker in use
+    uint8_t    mRebootAfter  { 10 }; // # of connect failures in a row to reboot (0: never)
+    uint16_t   mConnFails    { 0 };  // # of connect failures in a row
+    uint16_t   mReconnCnt    { 0 };  // # of successful re-connects
+    TickType_t mDownSince    { 0 };  // when connection got lost (0: connected / not yet connected)
+    uint32_t   mTtrSum       { 0 };  // [ticks] sum of time to re-connect
+    uint32_t   mTtrMax       { 0 };  // [ticks] max. time to re-connect
+    uint32_t   mTtrLast      { 0 };  // [ticks] last time to re-connect
+    uint32_t   mSubPhase     { 0 };  // [ticks] duration of last SubscribeAll
+    uint8_t    mSubSent      { 0 };  // SubscribeAll: # of requests sent (by task)
+    volatile uint8_t mSubDone   { 0 };  // SubscribeAll: # of responses (by lwip callback)
+    volatile uint8_t mSubFailed { 0 };  // SubscribeAll: # of negative responses
     uint16_t   mAlivePeriod  { 0 };  // [s] 0 = no alive msgs
     uint16_t   mStatusIdx[2] { 0 };  // domoticz virtual device idx -> '{"idx":..., "nvalue":..., "svalue":""..."}'
+    PubFilter  mStatusFilter[2] { { "status0", { 0, 0, 0, 900 } },   // domoticz status: on change, at least each 15 min.
+                                  { "status1", { 0, 0, 0, 900 } } };
     char       mFormat       { 0 };  // syntax for pub/sub data 0: default / 'd': domoticz / ...
     char       mPubTopic[2][32] { "", "" };  // strlen("keypad/alarm/up") = 15!
     char       mSubTopic[2][32] { "", "" };
@@ -83,15 +186,92 @@ private:
     uint16_t   mCbPassedCnt  { 0 };  // # of CallWait usual behavior with success
     uint16_t   mCbFailedCnt  { 0 };  // # of CallWait usual behavior with error
     uint16_t   mCbTimoCnt    { 0 };  // # of CallWait timeout expirations happened
-    uint16_t   mInLen        { 0 };
-    uint16_t   mInReadLen    { 0 };
+    uint32_t   mCallStart    { 0 };  // [us] CallPrep of current request
+    uint32_t   mSubStart[PubWindowMax] {};  // [us] SubscribeAll: send time of outstanding requests
+    LatHist    mLatHist[LAT_COUNT] {};
+    uint32_t   mMsgCnt[2]    { 0, 0 };  // # of messages [0]: in / [1]: out
+    uint32_t   mByteCnt[2]   { 0, 0 };  // topic + payload bytes [0]: in / [1]: out
+    uint32_t   mMsgBase[2]   { 0, 0 };  // mMsgCnt at begin of current minute
+    uint16_t   mMsgRate[2]   { 0, 0 };  // [1/min] messages during last full minute
+    TickType_t mNextMinute   { 0 };
+    TickType_t mConnSince    { 0 };  // when connection got accepted (0: not connected)
+    uint32_t   mConnTotal    { 0 };  // [s] connected time of previous connections
+    bool       mPubMetrics   { false };  // publish metrics on watchdog topic with alive period
+    uint16_t   mInMsgCnt     { 0 };  // # of inbound messages received
+    uint16_t   mInOverrunCnt { 0 };  // # of inbound messages dropped (pool full)
+    uint16_t   mInTruncCnt   { 0 };  // # of inbound messages truncated to InMaxLen
+    uint32_t   mInLen        { 0 };  // total payload length of current inbound message
+    uint32_t   mInReadLen    { 0 };
     int8_t     mTopicGroup  { -1 };  // to which topic group we get subscription data
-    char       mInTopic[31] { "" };  // just string behind (mSubTopic + "/")
-    char       mInData[800] { "" };
+    char       mInTopic[30] { "" };  // just string behind (mSubTopic + "/")
 
-    std::map<std::string, SubCallback> mSubCallbackMap[2] {};
+    TopicRouter         mSubRouter[2] {};  // pattern relative to mSubTopic ("-": mSubTopic itself), context: SubQueue
     ConnectedCallback   mOnConnected { 0 };
 
+    enum PUB_STATE {
+        PUB_FREE = 0,
+        PUB_QUEUED,     // waiting for a free in-flight slot
+        PUB_INFLIGHT,   // handed over to lwip - waiting for CbPubAsync
+        PUB_PASSED,     // confirmed - to be retired by task
+        PUB_FAILED,     // rejected - to be retired by task
+    };
+    struct PubSlot {
+        volatile uint8_t state  { PUB_FREE };
+        uint8_t       gen       { 0 };      // generation to detect late callbacks on recycled slots
+        int8_t        topicGroup{ 0 };
+        uint8_t       qos       { 1 };
+        uint8_t       retain    { 0 };
+        uint8_t       len       { 0 };
+        uint16_t      key       { 0 };      // domoticz idx to coalesce with newer value (0: none)
+        PubCallback   callback  { 0 };
+        void        * userarg   { 0 };
+        TickType_t    queued    { 0 };      // when accepted by PubAsync
+        TickType_t    sent      { 0 };      // when handed over to mqtt_publish
+        uint32_t      sentUs    { 0 };      // [us] same for latency histogram
+        char          topic[PubTopicLen] { "" };
+        char          data[PubDataLen]   { "" };
+    };
+    PubSlot           mPubSlot[PubQueueLen] {};
+    uint8_t           mPubHead     { 0 };  // oldest slot in use (free running)
+    uint8_t           mPubSend     { 0 };  // next slot to send  (free running)
+    uint8_t           mPubTail     { 0 };  // next slot to fill  (free running)
+    uint8_t           mPubInFlight { 0 };  // # of slots in state PUB_INFLIGHT
+    uint8_t           mPubWindow   { 2 };  // max. # of concurrent publishes in flight
+    PubStats          mPubStats[2] {};
+    SemaphoreHandle_t mPubMutex  { 0 };
+
+    uint8_t           mDrainRate   { 5 };  // [1/s] max. publish rate on draining offline backlog (0: no limit)
+    bool              mDraining    { false };  // backlog from offline time to be sent
+    TickType_t        mPubNextSend { 0 };  // rate limit while draining
+    bool              mSpill       { false };  // spill to nvs, when queue gets full while offline
+    uint8_t           mSpillCnt    { 0 };  // # of records in nvs spill area (oldest publishes)
+    struct {
+        int8_t   topicGroup;
+        uint8_t  len;                      // payload length of spilled record
+        uint16_t key;                      // domoticz idx of spilled record (0: none)
+    }                 mSpillInfo[SpillLen] {};
+
+    enum IN_STATE {
+        IN_WRITING = 0, // filled by lwip callback
+        IN_COMPLETE,    // to be dispatched by task
+        IN_DROPPED,     // incomplete - to be skipped by task
+        IN_WRAP,        // no record - continue at start of pool
+    };
+    struct InMsg {
+        uint16_t          size;         // bytes in pool incl. header (multiple of 4)
+        volatile uint8_t  state;
+        int8_t            topicGroup;
+        uint16_t          len;          // payload bytes stored
+        char              topic[30];
+        char * Data() { return (char *) (this + 1); };  // payload behind header
+    };
+    InMsg * InAlloc( uint32_t need );
+
+    uint32_t          mInPool[InPoolLen / 4] {};  // ring of InMsg records
+    volatile uint16_t mInHead    { 0 };  // oldest record (advanced by task)
+    volatile uint16_t mInTail    { 0 };  // next free byte (advanced by lwip callback)
+    InMsg           * mInCur     { 0 };  // record being filled (0: dropped)
+
     TaskHandle_t      mTaskHandle{ 0 };
     SemaphoreHandle_t mSemaphore { 0 };
     SemaphoreHandle_t mCbWaitSema{ 0 };
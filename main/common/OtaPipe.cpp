@@ -0,0 +1,197 @@
+/*
+ * OtaPipe.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "OtaPipe.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+
+#include <task.h>
+#include <esp_log.h>
+#include <esp_timer.h>  // esp_timer_get_time()
+
+namespace
+{
+const char * const TAG = "OtaPipe";
+}
+
+extern "C" void OtaPipeTask( void * pipe )
+{
+    ((OtaPipe *) pipe)->Run();
+}
+
+OtaPipe::~OtaPipe()
+{
+    if (mTask)
+        End();
+    if (mSync)
+        vSemaphoreDelete( mSync );
+    if (mFull)
+        vQueueDelete( mFull );
+    if (mFree)
+        vQueueDelete( mFree );
+    for (uint8_t i = 0; i < BufCount; ++i)
+        free( mBuf[i] );
+    mbedtls_sha256_free( & mSha );
+}
+
+esp_err_t OtaPipe::Begin()
+{
+    if (! mFree) {
+        mFree = xQueueCreate( BufCount, sizeof(uint8_t *) );
+        mFull = xQueueCreate( BufCount + 1, sizeof(Item) );  // + marker
+        mSync = xSemaphoreCreateBinary();
+        if (! (mFree && mFull && mSync))
+            return ESP_ERR_NO_MEM;
+        for (uint8_t i = 0; i < BufCount; ++i) {
+            mBuf[i] = (uint8_t *) malloc( BufLen );
+            if (! mBuf[i])
+                return ESP_ERR_NO_MEM;
+            xQueueSend( mFree, & mBuf[i], 0 );
+        }
+    }
+    mQueued  = 0;
+    mWritten = 0;
+    mBusyUs  = 0;
+    mHashUs  = 0;
+    mError   = 0;
+    mbedtls_sha256_init( & mSha );
+    mbedtls_sha256_starts_ret( & mSha, /*is224*/ 0 );
+
+    // image size 1: esp_ota_begin erases the 1st sector only - the others get erased ahead of writing
+    int64_t const start = esp_timer_get_time();
+    esp_err_t const e = esp_ota_begin( mPartition, 1, & mHandle );
+    if (e != ESP_OK)
+        return e;
+    mErased = BufLen;
+    mBusyUs = (uint32_t) (esp_timer_get_time() - start);
+
+    if (! mTask)
+        xTaskCreate( OtaPipeTask, TAG, /*stack size*/2048, this, /*prio*/ 2, & mTask );  // prior to Updator
+    return mTask ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+bool OtaPipe::Queue( Item item )
+{
+    return xQueueSend( mFull, & item, portMAX_DELAY ) == pdTRUE;
+}
+
+bool OtaPipe::Write( const uint8_t * data, size_t len )
+{
+    while (len) {
+        if (! mFill) {
+            xQueueReceive( mFree, & mFill, portMAX_DELAY );  // wait for the writer
+            mFillLen = 0;
+        }
+        size_t const n = (len < (size_t) (BufLen - mFillLen)) ? len : BufLen - mFillLen;
+        memcpy( & mFill[mFillLen], data, n );
+        mFillLen += n;
+        mQueued  += n;
+        data     += n;
+        len      -= n;
+        if (mFillLen == BufLen) {
+            Queue( Item{ mFill, mFillLen } );
+            mFill = 0;
+        }
+    }
+    return ! mError;
+}
+
+const char * OtaPipe::Flush()
+{
+    if (mFill) {
+        if (mFillLen)
+            Queue( Item{ mFill, mFillLen } );
+        else
+            xQueueSend( mFree, & mFill, 0 );
+        mFill = 0;
+    }
+    if (mTask) {
+        Queue( Item{ 0, 0 } );
+        xSemaphoreTake( mSync, portMAX_DELAY );
+    }
+    return mError;
+}
+
+esp_err_t OtaPipe::End()
+{
+    Flush();
+    if (mTask) {
+        Queue( Item{ 0, 1 } );
+        xSemaphoreTake( mSync, portMAX_DELAY );
+        mTask = 0;  // deleted itself
+    }
+    mbedtls_sha256_finish_ret( & mSha, mDigest );
+    mbedtls_sha256_free( & mSha );
+    ESP_LOGI( TAG, "%u bytes written, %u bytes erased, %u bytes/s, sha256 %u us/KB",
+                   mWritten, mErased, Rate(), HashCost() );
+    return esp_ota_end( mHandle );
+}
+
+uint32_t OtaPipe::Rate() const
+{
+    return mBusyUs ? (uint32_t) ((uint64_t) mWritten * 1000000 / mBusyUs) : 0;
+}
+
+uint32_t OtaPipe::HashCost() const
+{
+    return mWritten ? (uint32_t) ((uint64_t) mHashUs * 1024 / mWritten) : 0;
+}
+
+bool OtaPipe::EraseNext()
+{
+    if (mErased >= mPartition->size)
+        return false;
+    if (esp_partition_erase_range( mPartition, mErased, BufLen ) != ESP_OK) {
+        ESP_LOGE( TAG, "erase at 0x%x failed", mPartition->address + mErased );
+        mError = "flash erase";
+        return false;
+    }
+    mErased += BufLen;
+    return true;
+}
+
+void OtaPipe::Run()
+{
+    while (1) {
+        Item item;
+        // idle: erase ahead, otherwise wait for data
+        bool const ahead = (! mError) && (mErased < mWritten + AheadLen) && (mErased < mPartition->size);
+        if (xQueueReceive( mFull, & item, ahead ? 0 : portMAX_DELAY ) != pdTRUE) {
+            int64_t const start = esp_timer_get_time();
+            EraseNext();
+            mBusyUs += (uint32_t) (esp_timer_get_time() - start);
+            continue;
+        }
+        if (! item.buf) {  // marker
+            xSemaphoreGive( mSync );
+            if (item.len)
+                break;
+            continue;
+        }
+        if (! mError) {
+            int64_t const start = esp_timer_get_time();
+            while ((mErased < mWritten + item.len) && EraseNext())
+                ;
+            if (mErased < mWritten + item.len) {
+                if (! mError)
+                    mError = "image exceeds partition";
+            } else if (esp_ota_write( mHandle, item.buf, item.len ) != ESP_OK) {
+                ESP_LOGE( TAG, "esp_ota_write at %u failed", mWritten );
+                mError = "flash write";
+            } else {
+                mWritten += item.len;
+            }
+            int64_t const written = esp_timer_get_time();
+            mBusyUs += (uint32_t) (written - start);
+            if (! mError) {  // hash of what got flashed: no 2nd pass on the partition
+                mbedtls_sha256_update_ret( & mSha, item.buf, item.len );
+                mHashUs += (uint32_t) (esp_timer_get_time() - written);
+            }
+        }
+        xQueueSend( mFree, & item.buf, portMAX_DELAY );
+    }
+    vTaskDelete( 0 );
+}
@@ -0,0 +1,86 @@
+/*
+ * OtaPipe.h
+ *
+ * flash writer of the Updator in an own task, so the download continues while
+ * a sector gets erased or programmed:
+ * - the Updator task (http read, decompress, patch) copies the image into one of
+ *   BufCount sector sized buffers (Write) - a full one is queued to the writer task
+ * - the writer task erases the sector ahead of the write pointer and calls
+ *   esp_ota_write; waiting for data, it erases up to AheadLen in advance
+ * - Begin() erases just the 1st sector (instead of the whole partition)
+ * - the writer hashes each written buffer: the sha256 of the image is ready
+ *   with End(), without reading back the partition
+ * a write error is sticky: later buffers get discarded, Write returns false
+ *
+ *   OtaPipe pipe{ partition };
+ *   pipe.Begin();  ... pipe.Write( data, len ) ...  err = pipe.Flush();  pipe.End();  pipe.Digest();
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>             // size_t
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+
+#include <esp_partition.h>      // esp_partition_t
+#include <esp_ota_ops.h>        // esp_ota_handle_t
+#include <mbedtls/sha256.h>     // mbedtls_sha256_context
+
+class OtaPipe
+{
+public:
+    static constexpr uint8_t  BufCount = 2;
+    static constexpr uint16_t BufLen   = 4096;           // SPI_FLASH_SEC_SIZE
+    static constexpr uint32_t AheadLen = 8 * BufLen;     // erased in advance
+
+    static constexpr uint8_t  DigestLen = 32;            // sha256
+
+    OtaPipe( const esp_partition_t * partition ) : mPartition { partition } {};
+    ~OtaPipe();
+    OtaPipe( const OtaPipe & ) = delete;
+    OtaPipe & operator=( const OtaPipe & ) = delete;
+
+    esp_err_t    Begin();  // esp_ota_begin, start writer task
+    bool         Write( const uint8_t * data, size_t len );  // by reader: false on write error
+    const char * Flush();  // by reader: wait until all written - 0 or error
+    esp_err_t    End();    // stop writer task, esp_ota_end, finish digest
+
+    void         Run();    // writer task routine, but must be public
+
+    uint32_t Queued()    const { return mQueued; };   // bytes passed to Write
+    uint32_t Written()   const { return mWritten; };  // bytes programmed
+    uint32_t Erased()    const { return mErased; };   // partition offset erased up to
+    uint32_t Rate()      const;                       // write incl. erase [bytes/s of busy time]
+    uint32_t HashCost()  const;                       // sha256 [us per KB]
+    const uint8_t * Digest() const { return mDigest; };  // sha256 of the written image (after End)
+
+private:
+    struct Item {
+        uint8_t * buf;  // 0: marker
+        uint16_t  len;  // marker: 0: sync / 1: stop
+    };
+
+    bool Queue( Item item );
+    bool EraseNext();
+
+    const esp_partition_t * mPartition;
+    esp_ota_handle_t        mHandle  { 0 };
+    uint8_t               * mBuf[BufCount] {};
+    uint8_t               * mFill    { 0 };  // buffer filled by Write
+    uint16_t                mFillLen { 0 };
+    QueueHandle_t           mFree    { 0 };  // buffers to fill
+    QueueHandle_t           mFull    { 0 };  // buffers to write
+    SemaphoreHandle_t       mSync    { 0 };  // marker processed
+    TaskHandle_t            mTask    { 0 };
+    uint32_t                mQueued  { 0 };
+    uint32_t                mWritten { 0 };
+    uint32_t                mErased  { 0 };
+    uint32_t                mBusyUs  { 0 };
+    uint32_t                mHashUs  { 0 };
+    mbedtls_sha256_context  mSha     {};
+    uint8_t                 mDigest[DigestLen] {};
+    const char * volatile   mError   { 0 };
+};
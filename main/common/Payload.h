@@ -0,0 +1,91 @@
+/*
+ * Payload.h
+ *
+ * fixed size buffer to format publish payloads without heap allocation
+ *
+ *   Payload<64> p;
+ *   p.Domoticz( idx, 0, 215, 1 );     // { "idx": <idx>, "nvalue": 0, "svalue": "21.5" }
+ *   mqtinator.PubAsync( 0, p.c_str() );
+ *
+ * on overflow the content gets truncated and Ok() returns false
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+template <uint16_t N>
+class Payload
+{
+public:
+    Payload() { mBuf[0] = 0; };
+
+    void Clear() { mLen = 0; mOverflow = false; mBuf[0] = 0; };
+
+    Payload & Add( const char * str, uint16_t len )
+    {
+        if (len > N - 1 - mLen) {
+            len = N - 1 - mLen;
+            mOverflow = true;
+        }
+        memcpy( & mBuf[mLen], str, len );
+        mLen += len;
+        mBuf[mLen] = 0;
+        return *this;
+    };
+    Payload & Add( const char * str ) { return Add( str, (uint16_t) strlen( str ) ); };
+
+    // decimal number as fixed point: Add( -215, 1 ) -> "-21.5" / Add( 5, 2 ) -> "0.05"
+    Payload & Add( long val, uint8_t decimals = 0 )
+    {
+        char   buf[16];
+        char * bp = & buf[sizeof(buf)];
+        if (decimals > 9)
+            decimals = 9;
+        unsigned long uval = val < 0 ? 0ul - (unsigned long) val : (unsigned long) val;
+        do {
+            *--bp = (char) ('0' + uval % 10);
+            uval /= 10;
+            if (decimals && ! --decimals) {
+                *--bp = '.';
+                if (! uval)
+                    *--bp = '0';
+            }
+        } while (uval || decimals);
+        if (val < 0)
+            *--bp = '-';
+        return Add( bp, (uint16_t) (& buf[sizeof(buf)] - bp) );
+    };
+
+    // domoticz layouts: { "idx": <idx>, "nvalue": <nvalue>[, "svalue": "<svalue>"] }
+    Payload & Domoticz( uint16_t idx, long nvalue )
+    {
+        return DzHead( idx, nvalue ).Add( " }" );
+    };
+    Payload & Domoticz( uint16_t idx, long nvalue, const char * svalue )
+    {
+        return DzHead( idx, nvalue ).Add( ", \"svalue\": \"" ).Add( svalue ).Add( "\" }" );
+    };
+    Payload & Domoticz( uint16_t idx, long nvalue, long svalue, uint8_t decimals = 0 )
+    {
+        return DzHead( idx, nvalue ).Add( ", \"svalue\": \"" ).Add( svalue, decimals ).Add( "\" }" );
+    };
+
+    const char * c_str() const { return mBuf; };
+    uint16_t     Len()   const { return mLen; };
+    bool         Ok()    const { return ! mOverflow; };
+
+private:
+    Payload & DzHead( uint16_t idx, long nvalue )
+    {
+        Clear();
+        return Add( "{ \"idx\": " ).Add( (long) idx ).Add( ", \"nvalue\": " ).Add( nvalue );
+    };
+
+    uint16_t mLen      { 0 };
+    bool     mOverflow { false };
+    char     mBuf[N];
+};
+
+typedef Payload<64> DzPayload;  // fits domoticz layout with short svalue
@@ -0,0 +1,79 @@
+/*
+ * PubFilter.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "PubFilter.h"
+
+#include <string.h>
+#include <stdlib.h>     // labs()
+
+#include <task.h>       // xTaskGetTickCount()
+#include <esp_log.h>
+
+namespace
+{
+const char * const TAG = "PubFilter";
+
+PubFilter * s_first = nullptr;  // registered channels
+}
+
+PubFilter::PubFilter( const char * name, const Config & config )
+    : mConfig { config }
+{
+    strncpy( mName, name, sizeof(mName) - 1 );
+    mName[sizeof(mName) - 1] = 0;
+
+    // append to keep order of registration
+    PubFilter ** link = & s_first;
+    while (*link)
+        link = & (*link)->mNext;
+    *link = this;
+}
+
+PubFilter::~PubFilter()
+{
+    for (PubFilter ** link = & s_first; *link; link = & (*link)->mNext)
+        if (*link == this) {
+            *link = mNext;
+            break;
+        }
+}
+
+PubFilter * PubFilter::First()
+{
+    return s_first;
+}
+
+bool PubFilter::Check( long value, bool force )
+{
+    TickType_t const now     = xTaskGetTickCount();
+    TickType_t const elapsed = now - mLastSent;
+
+    bool publish = force || ! mValid;
+    if (! publish) {
+        unsigned long const diff = labs( value - mLast );
+        bool const changed = (diff > mConfig.absBand)
+                          && (! mConfig.relBand || (diff * 1000 > labs( mLast ) * mConfig.relBand));
+        if (mConfig.minInterval && (elapsed < (TickType_t) mConfig.minInterval * configTICK_RATE_HZ)) {
+            if (changed)
+                ++mLimited;
+        } else if (changed)
+            publish = true;
+        else if (mConfig.maxSilence && (elapsed >= (TickType_t) mConfig.maxSilence * configTICK_RATE_HZ)) {
+            publish = true;
+            ++mHeartbeats;
+        }
+    }
+
+    if (! publish) {
+        ++mSuppressed;
+        return false;
+    }
+    ESP_LOGD( TAG, "%s: publish %ld (last %ld)", mName, value, mLast );
+    mLast     = value;
+    mLastSent = now;
+    mValid    = true;
+    ++mSent;
+    return true;
+}
@@ -0,0 +1,55 @@
+/*
+ * PubFilter.h
+ *
+ * publish-on-change filter per channel (e.g. one sensor value):
+ * - deadband: changes within absBand / relBand of the last published value are suppressed
+ * - rate limit: no publish within minInterval after the last one (unless forced)
+ * - heartbeat: unchanged value is published again after maxSilence
+ * all channels register themselves, so sent/suppressed counts can be shown on one page
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <FreeRTOS.h>
+#include <portmacro.h>  // TickType_t
+
+class PubFilter
+{
+public:
+    struct Config {
+        uint16_t absBand;      // suppress changes <= absBand (0: publish any change)
+        uint16_t relBand;      // [1/1000] suppress changes <= last * relBand as well (0: off)
+        uint16_t minInterval;  // [s] min. time between two publishes (0: no rate limit)
+        uint16_t maxSilence;   // [s] publish unchanged value after this time (0: never)
+    };
+
+    PubFilter( const char * name, const Config & config );
+    ~PubFilter();
+
+    bool Check( long value, bool force = false );  // true: publish value now
+    void Reset() { mValid = false; };             // next Check will publish
+
+    Config     & Cfg()              { return mConfig; };
+    const char * Name()       const { return mName; };
+    uint16_t     Sent()       const { return mSent; };
+    uint16_t     Suppressed() const { return mSuppressed; };
+    uint16_t     Limited()    const { return mLimited; };     // suppressed by rate limit
+    uint16_t     Heartbeats() const { return mHeartbeats; };  // sent unchanged after max. silence
+
+    static PubFilter * First();
+    PubFilter        * Next() const { return mNext; };
+
+private:
+    char         mName[16];
+    Config       mConfig;
+    long         mLast       { 0 };      // last published value
+    TickType_t   mLastSent   { 0 };
+    bool         mValid      { false };  // mLast/mLastSent set
+    uint16_t     mSent       { 0 };
+    uint16_t     mSuppressed { 0 };
+    uint16_t     mLimited    { 0 };
+    uint16_t     mHeartbeats { 0 };
+    PubFilter  * mNext       { 0 };
+};
@@ -3,7 +3,9 @@
  */
 
 #include "Relay.h"
+#include "EventStream.h"
 
+#include <stdio.h>          // snprintf()
 #include <esp_log.h>        // ESP_LOGI()
 
 #include <FreeRTOSConfig.h>
@@ -90,6 +92,9 @@ void Relay::RealOn( bool on )
         SwitchTime = yet;
         ESP_LOGI( TAG, "switched off" );
     }
+    char event[EventStream::NameLen];
+    snprintf( event, sizeof(event), "relay%d", (int) Pin );
+    EventStream::Instance().Post( event, on ? "1" : "0" );
 }
 
 unsigned long Relay::TotalOn()
@@ -0,0 +1,144 @@
+/*
+ * SubQueue.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "SubQueue.h"
+
+#include <stddef.h>     // offsetof()
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>
+
+#include <task.h>
+#include <esp_log.h>
+
+namespace
+{
+const char * const TAG = "SubQueue";
+
+SubQueue * s_first = nullptr;  // registered queues
+}
+
+extern "C" void SubQueueTask( void * queue )
+{
+    ((SubQueue *) queue)->Worker();
+}
+
+SubQueue::SubQueue( const char * name, uint8_t depth, uint16_t dataLen, POLICY policy )
+    : mPolicy  { policy }
+    , mDepth   { depth }
+    , mDataLen { dataLen }
+{
+    strncpy( mName, name, sizeof(mName) - 1 );
+    mName[sizeof(mName) - 1] = 0;
+
+    size_t const itemSize = offsetof(Item, data) + dataLen + 1;
+    mQueue    = xQueueCreate( depth, itemSize );
+    mPostItem = (Item *) malloc( itemSize );
+    mTakeItem = (Item *) malloc( itemSize );
+    if ((policy == DROP_OLDEST) && (depth > 1))  // depth 1: overwritten in place
+        mDropItem = (Item *) malloc( itemSize );
+    if (! (mQueue && mPostItem && mTakeItem && (mDropItem || (policy != DROP_OLDEST) || (depth <= 1))))
+        ESP_LOGE( TAG, "%s: no memory for %d x %d bytes", mName, depth, itemSize );
+
+    SubQueue ** link = & s_first;
+    while (*link)
+        link = & (*link)->mNext;
+    *link = this;
+}
+
+SubQueue::~SubQueue()
+{
+    for (SubQueue ** link = & s_first; *link; link = & (*link)->mNext)
+        if (*link == this) {
+            *link = mNext;
+            break;
+        }
+    if (mTask)
+        vTaskDelete( mTask );
+    if (mQueue)
+        vQueueDelete( mQueue );
+    free( mPostItem );
+    free( mTakeItem );
+    free( mDropItem );
+}
+
+SubQueue * SubQueue::First()
+{
+    return s_first;
+}
+
+bool SubQueue::StartWorker( uint16_t stackSize, UBaseType_t prio )
+{
+    if (mTask)
+        return true;
+    xTaskCreate( SubQueueTask, mName, stackSize, this, prio, & mTask );
+    if (! mTask) {
+        ESP_LOGE( TAG, "%s: xTaskCreate failed", mName );
+        return false;
+    }
+    return true;
+}
+
+void SubQueue::Worker()
+{
+    while (true)
+        Process( portMAX_DELAY );
+}
+
+bool SubQueue::Post( Callback callback, const char * topic, const char * data )
+{
+    if (! (mQueue && mPostItem))
+        return false;
+
+    mPostItem->callback = callback;
+    strncpy( mPostItem->topic, topic, TopicLen - 1 );
+    mPostItem->topic[TopicLen - 1] = 0;
+    size_t len = strlen( data );
+    if (len > mDataLen) {
+        len = mDataLen;
+        ++mTruncated;
+    }
+    memcpy( mPostItem->data, data, len );
+    mPostItem->data[len] = 0;
+
+    if ((mPolicy == DROP_OLDEST) && (mDepth == 1)) {  // latest state in a mailbox
+        if (uxQueueMessagesWaiting( mQueue ))
+            ++mDropped;
+        xQueueOverwrite( mQueue, mPostItem );
+        ++mPosted;
+        mHighWater = 1;
+        return true;
+    }
+
+    TickType_t const wait = (mPolicy == BLOCK) ? BlockMax : 0;
+    bool sent = xQueueSendToBack( mQueue, mPostItem, wait ) == pdTRUE;
+    if (! sent && mDropItem) {
+        xQueueReceive( mQueue, mDropItem, 0 );  // consumer might have taken it meanwhile
+        ++mDropped;
+        sent = xQueueSendToBack( mQueue, mPostItem, 0 ) == pdTRUE;
+    }
+    if (! sent) {
+        ESP_LOGW( TAG, "%s: queue full - drop \"%s\"", mName, mPostItem->topic );
+        ++mDropped;
+        return false;
+    }
+    ++mPosted;
+    uint8_t const waiting = Waiting();
+    if (mHighWater < waiting)
+        mHighWater = waiting;
+    return true;
+}
+
+bool SubQueue::Process( TickType_t wait )
+{
+    if (! (mQueue && mTakeItem))
+        return false;
+    if (xQueueReceive( mQueue, mTakeItem, wait ) != pdTRUE)
+        return false;
+
+    ESP_LOGD( TAG, "%s: dispatch \"%s\"", mName, mTakeItem->topic );
+    mTakeItem->callback( mTakeItem->topic, mTakeItem->data );
+    ++mProcessed;
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * SubQueue.h
+ *
+ * hand over subscription data from the Mqtinator task to a consumer task:
+ * - Mqtinator::Sub( topic, callback, queue ) binds the callback on that topic to the queue
+ *   (until unsubscribed)
+ * - the Mqtinator task just copies topic and data into the queue (Post)
+ * - the callback gets called by the consumer task calling Process,
+ *   or by an own worker task (StartWorker)
+ * on a full queue the policy decides: drop the new or the oldest message,
+ * or block the Mqtinator task for up to BlockMax (then drop the new one)
+ * - DROP_OLDEST of depth 1 is a mailbox: overwritten in place, no extra buffer
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+
+#include "TopicRouter.h"
+
+class SubQueue
+{
+public:
+    typedef TopicRouter::Callback Callback;  // void (*)( const char * topic, const char * data )
+
+    enum POLICY {
+        DROP_NEW,       // keep queued messages
+        DROP_OLDEST,    // latest state wins
+        BLOCK,          // back pressure to Mqtinator task (inbound pool fills up)
+    };
+    static constexpr uint8_t    TopicLen = 30;  // as Mqtinator inbound topic
+    static constexpr TickType_t BlockMax = configTICK_RATE_HZ / 2;
+
+    SubQueue( const char * name, uint8_t depth, uint16_t dataLen, POLICY policy = DROP_OLDEST );
+    ~SubQueue();
+
+    bool Post( Callback callback, const char * topic, const char * data );  // by Mqtinator task
+    bool Process( TickType_t wait = portMAX_DELAY );  // by consumer task: true when callback called
+    bool StartWorker( uint16_t stackSize = 2048, UBaseType_t prio = 1 );
+    void Worker();  // Process loop of own task (never returns)
+
+    const char * Name()      const { return mName; };
+    POLICY       Policy()    const { return mPolicy; };
+    uint8_t      Depth()     const { return mDepth; };
+    uint16_t     DataLen()   const { return mDataLen; };
+    uint8_t      Waiting()   const { return mQueue ? (uint8_t) uxQueueMessagesWaiting( mQueue ) : 0; };
+    uint8_t      HighWater() const { return mHighWater; };
+    uint32_t     Posted()    const { return mPosted; };
+    uint32_t     Processed() const { return mProcessed; };
+    uint16_t     Dropped()   const { return mDropped; };
+    uint16_t     Truncated() const { return mTruncated; };
+
+    static SubQueue * First();
+    SubQueue        * Next() const { return mNext; };
+
+private:
+    struct Item {
+        Callback callback;
+        char     topic[TopicLen];
+        char     data[1];  // dataLen + 1 bytes
+    };
+
+    char            mName[16];
+    POLICY const    mPolicy;
+    uint8_t const   mDepth;
+    uint16_t const  mDataLen;
+    QueueHandle_t   mQueue     { 0 };
+    Item          * mPostItem  { 0 };  // built by Post
+    Item          * mTakeItem  { 0 };  // received by Process
+    Item          * mDropItem  { 0 };  // oldest one removed by Post (DROP_OLDEST, depth > 1)
+    TaskHandle_t    mTask      { 0 };  // own worker task (0: consumer calls Process)
+    uint8_t         mHighWater { 0 };  // max. # of waiting messages
+    uint32_t        mPosted    { 0 };
+    uint32_t        mProcessed { 0 };
+    uint16_t        mDropped   { 0 };
+    uint16_t        mTruncated { 0 };
+    SubQueue      * mNext      { 0 };
+};
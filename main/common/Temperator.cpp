@@ -10,6 +10,8 @@
 #include "HttpHelper.h"
 #include "HttpParser.h"
 #include "HttpTable.h"
+#include "JsonApi.h"
+#include "EventStream.h"
 
 #include <math.h>               // isnanf()
 #include <driver/gpio.h>        // gpio_config(), gpio_set_level()
@@ -51,6 +53,13 @@ extern "C" esp_err_t post_temperator_config( httpd_req_t * req )
     return ESP_OK;
 }
 
+extern "C" esp_err_t api_temperator( httpd_req_t * req )
+{
+    if (s_temperator)
+        s_temperator->Api( req );
+    return ESP_OK;
+}
+
 namespace {
 const httpd_uri_t s_get_uri   = { .uri = s_subpage, .method = HTTP_GET,  .handler = get_temperator_config,  .user_ctx = 0 };
 const httpd_uri_t s_post_uri  = { .uri = s_subpage, .method = HTTP_POST, .handler = post_temperator_config, .user_ctx = 0 };
@@ -61,6 +70,7 @@ Temperator::Temperator( gpio_num_t pin ) : mPin{ pin }
 {
     s_temperator = this;
     WebServer::Instance().AddPage( s_page, & s_post_uri );
+    WebServer::Instance().AddApi( "temperature", api_temperator );
     s_keyInterval[INTERVAL::FAST] = "fast";
     s_keyInterval[INTERVAL::SLOW] = "slow";
     s_keyInterval[INTERVAL::ERROR] = "error";
@@ -78,83 +88,131 @@ void Temperator::Rescan()
     xSemaphoreGive( mSemaphore );
 }
 
-void Temperator::Setup( httpd_req_t * req, bool post )
+uint8_t Temperator::NofDevInfo() const
 {
-    HttpHelper hh{ req, "Configure temperature sensors settings", "Temperature" };
-
-    uint8_t const n = mDevInfo.size() < MaxDevStored ? mDevInfo.size() : MaxDevStored;
-
-    ESP_LOGD( TAG, "have %d device infos -> n set to %d", mDevInfo.size(), n );
+    return mDevInfo.size() < MaxDevStored ? mDevInfo.size() : MaxDevStored;
+}
 
-    std::string postError{};
+std::string Temperator::PostParam( httpd_req_t * req )
+{
+    uint8_t const n = NofDevInfo();
 
-    while (post) {
-        ESP_LOGD( TAG, "got POST data" );
-        if (n) {
-            HttpParser::Input in[(2 * n) + INTERVAL::COUNT];
-            char namekey[n][8];
-            char namebuf[n][32];
-            for (uint8_t i = 0; i < n; ++i) {
-                strcpy( namekey[i], "name_" );
-                namekey[i][5] = i + 'A';
-                namekey[i][6] = 0;
-                in[i] = HttpParser::Input{ namekey[i], namebuf[i], sizeof(namebuf[i]) };
+    ESP_LOGD( TAG, "got POST data" );
+    if (n) {
+        HttpParser::Input in[(2 * n) + INTERVAL::COUNT];
+        char namekey[n][8];
+        char namebuf[n][32];
+        for (uint8_t i = 0; i < n; ++i) {
+            strcpy( namekey[i], "name_" );
+            namekey[i][5] = i + 'A';
+            namekey[i][6] = 0;
+            in[i] = HttpParser::Input{ namekey[i], namebuf[i], sizeof(namebuf[i]) };
+        }
+        char idxkey[n][8];
+        char idxbuf[n][8];
+        for (uint8_t i = 0; i < n; ++i) {
+            strcpy( idxkey[i], "idx_" );
+            idxkey[i][4] = i + 'A';
+            idxkey[i][5] = 0;
+            in[n+i] = HttpParser::Input{ idxkey[i], idxbuf[i], sizeof(idxbuf[i]) };
+        }
+        char bufInterval[INTERVAL::COUNT][8];
+        for (uint8_t i = 0; i < INTERVAL::COUNT; ++i)
+            in[(2*n)+i] = HttpParser::Input{ s_keyInterval[i], bufInterval[i], sizeof(bufInterval[i]) };
+
+        HttpParser parser{ in, (uint8_t) (sizeof(in)/sizeof(in[0])) };
+
+        const char * parseError = parser.ParsePostData( req );
+        if (parseError)
+            return std::string{ "parser error: " } + parseError;
+
+        for (uint8_t i = 0; i < n; ++i) {
+            bool mod = false;
+            if (in[i].len) {
+                std::string name{ namebuf[i] };
+                if (mDevInfo[i].name != name) {
+                    mDevInfo[i].name = name;
+                    mod = true;
+                }
             }
-            char idxkey[n][8];
-            char idxbuf[n][8];
-            for (uint8_t i = 0; i < n; ++i) {
-                strcpy( idxkey[i], "idx_" );
-                idxkey[i][4] = i + 'A';
-                idxkey[i][5] = 0;
-                in[n+i] = HttpParser::Input{ idxkey[i], idxbuf[i], sizeof(idxbuf[i]) };
+            if (in[n+i].len) {
+                uint16_t idx = (uint16_t) strtoul( idxbuf[i], 0, 0 );
+                if (mDevInfo[i].idx != idx) {
+                    mDevInfo[i].idx = idx;
+                    if (mFilter[i])
+                        mFilter[i]->Reset();  // new domoticz device: publish next value
+                    mod = true;
+                }
             }
-            char bufInterval[INTERVAL::COUNT][8];
-            for (uint8_t i = 0; i < INTERVAL::COUNT; ++i)
-                in[(2*n)+i] = HttpParser::Input{ s_keyInterval[i], bufInterval[i], sizeof(bufInterval[i]) };
-
-            HttpParser parser{ in, (uint8_t) (sizeof(in)/sizeof(in[0])) };
-
-            const char * parseError = parser.ParsePostData( req );
-            if (parseError) {
-                postError = "parser error: ";
-                postError += parseError;
-                break;
+            if (mod) {
+                WriteDevInfo( i );
             }
-
-            for (uint8_t i = 0; i < n; ++i) {
-                bool mod = false;
-                if (in[i].len) {
-                    std::string name{ namebuf[i] };
-                    if (mDevInfo[i].name != name) {
-                        mDevInfo[i].name = name;
-                        mod = true;
-                    }
-                }
-                if (in[n+i].len) {
-                    uint16_t idx = (uint16_t) strtoul( idxbuf[i], 0, 0 );
-                    if (mDevInfo[i].idx != idx) {
-                        mDevInfo[i].idx = idx;
-                        mod = true;
+        }
+        for (uint8_t i = 0; i < INTERVAL::COUNT; ++i)
+            if (in[(2*n)+i].len) {
+                unsigned long interval = strtoul( bufInterval[i], 0, 0 );
+                if (interval) {
+                    interval *= configTICK_RATE_HZ;
+                    if (mInterval[i] != interval) {
+                        mInterval[i] = interval;
+                        WriteInterval( i );
                     }
                 }
-                if (mod) {
-                    WriteDevInfo( i );
-                }
             }
-            for (uint8_t i = 0; i < INTERVAL::COUNT; ++i)
-                if (in[(2*n)+i].len) {
-                    unsigned long interval = strtoul( bufInterval[i], 0, 0 );
-                    if (interval) {
-                        interval *= configTICK_RATE_HZ;
-                        if (mInterval[i] != interval) {
-                            mInterval[i] = interval;
-                            WriteInterval( i );
-                        }
-                    }
-                }
+    }
+    return std::string{};
+}
+
+void Temperator::Api( httpd_req_t * req )
+{
+    std::string err{};
+    if (req->method == HTTP_POST)
+        err = PostParam( req );
+
+    uint8_t const n = NofDevInfo();
+    uint32_t interval[INTERVAL::COUNT];
+    JsonApi::Field fields[INTERVAL::COUNT];
+    for (uint8_t i = 0; i < INTERVAL::COUNT; ++i) {
+        interval[i] = (mInterval[i] + configTICK_RATE_HZ/2) / configTICK_RATE_HZ;  // [s]
+        fields[i] = JsonApi::F( s_keyInterval[i], interval[i] );
+    }
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, INTERVAL::COUNT );
+    json.Open( "devices", '[' );  // post as name_<dev> / idx_<dev>
+    for (uint8_t i = 0; i < n; ++i) {
+        const DevInfo & info = mDevInfo[i];
+        char const dev[2] = { (char) (i + 'A'), 0 };
+        json.Open( 0 );
+        json.Str(  "dev",  dev );
+        json.Str(  "addr", HttpHelper::HexString( info.addr ).c_str() );
+        json.Str(  "name", info.name.c_str() );
+        json.Uint( "idx",  info.idx );
+        json.Bool( "used", mDevMask & (1 << i) );
+        if (isnanf( info.value ))
+            json.Null( "temp" );
+        else {
+            json.Int(  "temp", lroundf( info.value * 10 ), 1 );
+            json.Uint( "age",  (xTaskGetTickCount() - info.time + configTICK_RATE_HZ/2) / configTICK_RATE_HZ );
         }
-        break;
-    } // end ot pseudo while
+        json.Close();
+    }
+}
+
+void Temperator::Setup( httpd_req_t * req, bool post )
+{
+    std::string postError{};
+    if (post)
+        postError = PostParam( req );
+
+    HttpHelper hh{ req, "Configure temperature sensors settings", "Temperature" };
+
+    uint8_t const n = NofDevInfo();
+
+    ESP_LOGD( TAG, "have %d device infos -> n set to %d", mDevInfo.size(), n );
+
     if (! post) {
         // ESP_LOGD( TAG, "got GET data" );
         HttpParser::Input in[] = { { "rescan", 0, 0 } };
@@ -530,6 +588,8 @@ void Temperator::Run()
                 }
                 assert( i < MaxDevStored );
                 DevInfo devInfo{ addr[j], 0, 0 };
+                if (mFilter[i])
+                    mFilter[i]->Reset();  // other device: publish first value
                 if (i < mDevInfo.size()) 
                     mDevInfo[i] = devInfo;
                 else
@@ -601,8 +661,21 @@ void Temperator::Run()
                     ESP_LOGD( TAG, "temperature %08x-%08x: %.1g°C", (uint32_t) (addr >> 32), (uint32_t) addr, temperature );
                 }
 #endif
+                {
+                    char event[] = "tempA";
+                    event[4] = 'A' + i;  // same suffix as the nvs keys
+                    EventStream::Instance().Post( event, lroundf( temperature * 10 ), 1 );
+                }
                 if (mDevInfo[i].idx) {
-                    Mqtinator::Instance().Pub( mDevInfo[i].idx, HttpHelper::String( temperature, 1 ) );
+                    if (! mFilter[i]) {
+                        char name[8] = "temp";
+                        name[4] = 'A' + i;  // same suffix as the nvs keys
+                        name[5] = 0;
+                        mFilter[i] = new PubFilter( name, { 0, 0, 0, 300 } );  // publish 0.1°C changes, at least each 5 min.
+                    }
+                    long const value = lroundf( temperature * 10 );
+                    if (mFilter[i]->Check( value ))
+                        Mqtinator::Instance().Pub( mDevInfo[i].idx, value, 1 );
                 }
             }
         }
@@ -11,6 +11,8 @@
 #include <math.h>   // NANF
 
 #include <driver/gpio.h>
+
+#include "PubFilter.h"
 // include <pair>
 // incldue <ds18b20/ds18b20.h>    // ds18b20_addr_t
 
@@ -59,6 +61,7 @@ public:
     void OnTempRead( callback_t callback, void * userarg );
     bool Start();  // create task and Run inside that task
     void Setup( struct httpd_req * req, bool post = false );
+    void Api( struct httpd_req * req );  // GET/POST /api/temperature
     void Run();   // to let it run in main loop (never returns)
     void Rescan();
     void ReadConfig();
@@ -67,6 +70,9 @@ public:
     void WriteInterval( uint8_t idx );
 
 private:
+    uint8_t     NofDevInfo() const;  // # of devices shown in web interface
+    std::string PostParam( struct httpd_req * req );
+
     gpio_num_t const        mPin;
     MODE                    mMode { NORMAL };
     uint16_t                mDevMask {0};   // bit mask as indices to mDevInfo to found devices
@@ -74,6 +80,7 @@ private:
     TickType_t              mInterval[INTERVAL::COUNT] { configTICK_RATE_HZ, configTICK_RATE_HZ * 10, configTICK_RATE_HZ * 60 };
     TaskHandle_t            mTaskHandle { 0 };
     SemaphoreHandle_t       mSemaphore {};
+    PubFilter             * mFilter[MaxDevStored] {};  // per device publish filter (created on first publish)
     callback_t              mCallback { nullptr };
     void                  * mUserArg{ nullptr };
 };
@@ -0,0 +1,197 @@
+/*
+ * TopicRouter.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "TopicRouter.h"
+
+#include <string.h>
+
+namespace
+{
+// length and key (hash) of the topic level, rest: next level or nullptr
+uint8_t LevelLen( const char * level, const char ** rest, uint16_t * key )
+{
+    uint16_t h = 0;
+    const char * end = level;
+    for (; *end && (*end != '/'); ++end)
+        h = (uint16_t) ((h * 31) + (uint8_t) *end);
+    *rest = *end ? end + 1 : nullptr;
+    *key  = h;
+    return (uint8_t) (end - level);
+}
+}
+
+int16_t TopicRouter::Child( int16_t node, const char * level, uint8_t len, uint16_t key ) const
+{
+    if (mIndex.empty())
+        return None;
+    uint16_t const mask = (uint16_t) (mIndex.size() - 1);
+    for (uint16_t i = Slot( node, key ) & mask; mIndex[i] != None; i = (i + 1) & mask) {
+        const Node & c = mNodes[mIndex[i]];
+        if ((c.parent == node) && (c.key == key) && (c.level.size() == len) && ! memcmp( c.level.data(), level, len ))
+            return mIndex[i];
+    }
+    return None;
+}
+
+void TopicRouter::Index( int16_t n )
+{
+    uint16_t const mask = (uint16_t) (mIndex.size() - 1);
+    uint16_t i = Slot( mNodes[n].parent, mNodes[n].key ) & mask;
+    while (mIndex[i] != None)
+        i = (i + 1) & mask;
+    mIndex[i] = n;
+}
+
+int16_t TopicRouter::Find( int16_t node, const char * level, uint8_t len, uint16_t key, bool create )
+{
+    bool const plus = (len == 1) && (*level == '+');
+    int16_t n = plus ? mNodes[node].plus : Child( node, level, len, key );
+    if ((n != None) || ! create)
+        return n;
+
+    n = (int16_t) mNodes.size();
+    mNodes.emplace_back();
+    mNodes[n].level.assign( level, len );
+    mNodes[n].key    = key;
+    mNodes[n].parent = node;
+    if (plus) {
+        mNodes[node].plus = n;
+        return n;
+    }
+    if (mNodes.size() * 2 > mIndex.size()) {  // load <= 1/2: rebuild
+        mIndex.assign( mIndex.empty() ? 16 : mIndex.size() * 2, int16_t( None ) );  // no odr-use of None
+        for (int16_t i = 1; i < (int16_t) mNodes.size(); ++i)
+            if (mNodes[mNodes[i].parent].plus != i)
+                Index( i );
+    } else
+        Index( n );
+    return n;
+}
+
+int16_t * TopicRouter::List( const char * pattern, bool create )
+{
+    int16_t      node  = 0;
+    const char * level = pattern;
+    while (level) {
+        const char * rest;
+        uint16_t     key;
+        uint8_t const len = LevelLen( level, & rest, & key );
+        if ((len == 1) && (*level == '#') && ! rest)
+            return & mNodes[node].hash;
+        node = Find( node, level, len, key, create );
+        if (node == None)
+            return nullptr;
+        level = rest;
+    }
+    return & mNodes[node].entry;
+}
+
+bool TopicRouter::Add( const char * pattern, Callback callback, void * context )
+{
+    int16_t * link = List( pattern, true );
+    bool const isNew = (*link == None);
+    for (; *link != None; link = & mEntries[*link].next)
+        if (mEntries[*link].callback == callback) {
+            mEntries[*link].context = context;
+            return false;  // already there
+        }
+
+    int16_t e = mFree;
+    if (e != None)
+        mFree = mEntries[e].next;
+    else {
+        e = (int16_t) mEntries.size();
+        mEntries.emplace_back();
+        link = List( pattern, false );  // mEntries may have moved
+        while (*link != None)
+            link = & mEntries[*link].next;
+    }
+    mEntries[e].callback = callback;
+    mEntries[e].context  = context;
+    mEntries[e].next     = None;
+    *link = e;  // append: call in order of Add
+
+    if (isNew)
+        mPatterns.push_back( pattern );
+    return isNew;
+}
+
+bool TopicRouter::Remove( const char * pattern, Callback callback )
+{
+    int16_t * const list = List( pattern, false );
+    if (! list || (*list == None))
+        return false;
+
+    int16_t * link = list;
+    while (*link != None) {
+        int16_t const e = *link;
+        if (callback && (mEntries[e].callback != callback)) {
+            link = & mEntries[e].next;
+            continue;
+        }
+        *link = mEntries[e].next;
+        mEntries[e].callback = 0;
+        mEntries[e].context  = 0;
+        mEntries[e].next     = mFree;
+        mFree = e;
+    }
+    if (*list != None)
+        return false;  // other callbacks left on this pattern
+
+    for (auto it = mPatterns.begin(); it != mPatterns.end(); ++it)
+        if (*it == pattern) {
+            mPatterns.erase( it );
+            break;
+        }
+    return true;
+}
+
+uint8_t TopicRouter::Dispatch( const char * topic, const char * data ) const
+{
+    // collect first: callbacks may change the subscriptions
+    Callback found[MaxMatches];
+    uint8_t const cnt = Lookup( topic, found, MaxMatches );
+    for (uint8_t i = 0; i < cnt; ++i)
+        found[i]( topic, data );
+    return cnt;
+}
+
+uint8_t TopicRouter::Lookup( const char * topic, Callback * found, uint8_t max, void ** contexts ) const
+{
+    uint8_t cnt = 0;
+    Match( 0, topic, found, contexts, max, cnt );
+    if (! cnt)  // "#" as fallback (as the former lookup of "#" on a miss)
+        Collect( mNodes[0].hash, found, contexts, max, cnt );
+    return cnt;
+}
+
+void TopicRouter::Match( int16_t node, const char * level, Callback * found, void ** contexts, uint8_t max, uint8_t & cnt ) const
+{
+    const Node & n = mNodes[node];
+    if (node)
+        Collect( n.hash, found, contexts, max, cnt );  // "<levels>/#" covers this level and all below
+    if (! level) {
+        Collect( n.entry, found, contexts, max, cnt );
+        return;
+    }
+
+    const char * rest;
+    uint16_t     key;
+    uint8_t const len = LevelLen( level, & rest, & key );
+    int16_t const c = Child( node, level, len, key );
+    if (c != None)
+        Match( c, rest, found, contexts, max, cnt );
+    if (n.plus != None)
+        Match( n.plus, rest, found, contexts, max, cnt );
+}
+
+void TopicRouter::Collect( int16_t entry, Callback * found, void ** contexts, uint8_t max, uint8_t & cnt ) const
+{
+    for (; (entry != None) && (cnt < max); entry = mEntries[entry].next) {
+        if (contexts)
+            contexts[cnt] = mEntries[entry].context;
+        found[cnt++] = mEntries[entry].callback;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * TopicRouter.h
+ *
+ * dispatch of inbound topics to subscribed callbacks
+ * - patterns are split into levels and compiled into a tree on Add/Remove
+ * - the child nodes are found by a hash index on (parent, level) - no sibling scan
+ * - '+' matches one level, '#' (as last level) matches the parent and all levels below
+ * - several callbacks per pattern, all matching callbacks get called
+ * - an optional context per pattern and callback (e.g. the queue of the consumer) is returned by Lookup
+ * - the bare pattern "#" is a fallback: just called when no other pattern matches
+ * - Lookup/Dispatch walk the tree on the given topic without any allocation
+ */
+
+#ifndef MAIN_TOPICROUTER_H_
+#define MAIN_TOPICROUTER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class TopicRouter
+{
+public:
+    typedef void (*Callback)( const char * topic, const char * data );
+
+    static constexpr uint8_t MaxMatches = 8;  // max. # of callbacks called by Dispatch
+
+    TopicRouter() : mNodes( 1 ) {};  // [0]: root
+
+    bool    Add(    const char * pattern, Callback callback, void * context = 0 );  // true: new pattern (to be subscribed)
+    bool    Remove( const char * pattern, Callback callback = 0 );  // true: pattern gone (to be unsubscribed)
+    uint8_t Dispatch( const char * topic, const char * data ) const;  // returns # of callbacks called
+    uint8_t Lookup( const char * topic, Callback * found, uint8_t max, void ** contexts = 0 ) const;  // returns # found
+
+    bool         Empty()    const { return mPatterns.empty(); };
+    uint8_t      Patterns() const { return (uint8_t) mPatterns.size(); };
+    const char * Pattern( uint8_t i ) const { return mPatterns[i].c_str(); };
+
+private:
+    static constexpr int16_t None = -1;
+
+    struct Node {
+        std::string level;            // topic level w/o '/' ("+" for single level wildcard)
+        uint16_t    key     { 0 };    // hash of level
+        int16_t     parent  { None };
+        int16_t     plus    { None }; // child node "+"
+        int16_t     entry   { None }; // callbacks of patterns ending here
+        int16_t     hash    { None }; // callbacks of patterns ending here with "/#"
+    };
+    struct Entry {
+        Callback    callback { 0 };
+        void      * context  { 0 };
+        int16_t     next     { None };
+    };
+
+    static uint16_t Slot( int16_t node, uint16_t key ) { return (uint16_t) (key ^ (node * 0x9e37)); };
+    int16_t Child( int16_t node, const char * level, uint8_t len, uint16_t key ) const;  // by mIndex
+    void    Index( int16_t node );
+    int16_t Find( int16_t node, const char * level, uint8_t len, uint16_t key, bool create );
+    void    Match( int16_t node, const char * level, Callback * found, void ** contexts, uint8_t max, uint8_t & cnt ) const;
+    void    Collect( int16_t entry, Callback * found, void ** contexts, uint8_t max, uint8_t & cnt ) const;
+    int16_t * List( const char * pattern, bool create );
+
+    std::vector<Node>        mNodes;
+    std::vector<int16_t>     mIndex  {};        // open addressing on (parent, key): child nodes w/o "+"
+    std::vector<Entry>       mEntries {};
+    int16_t                  mFree   { None };  // unused entries
+    std::vector<std::string> mPatterns {};
+};
+
+#endif /* MAIN_TOPICROUTER_H_ */
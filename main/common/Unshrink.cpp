@@ -0,0 +1,141 @@
+/*
+ * Unshrink.cpp
+ */
+//define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+
+#include "Unshrink.h"
+
+#include <stdlib.h>     // calloc(), free()
+
+#include <esp_log.h>
+
+namespace
+{
+const char * const TAG = "Unshrink";
+}
+
+Unshrink::~Unshrink()
+{
+    free( mRing );
+}
+
+const char * Unshrink::Header( uint8_t byte )
+{
+    switch (mHeaderPos++)
+    {
+        case 0: if (byte != Magic0) return "no compressed image"; break;
+        case 1: if (byte != Magic1) return "no compressed image"; break;
+        case 2:
+            mWindowBits = byte;
+            if ((mWindowBits < 4) || (mWindowBits > WindowBitsMax))
+                return "unsupported window size";
+            break;
+        case 3:
+            mCountBits = byte;
+            if ((mCountBits < 3) || (mCountBits >= mWindowBits))
+                return "unsupported lookahead size";
+            break;
+        default:
+            mSize |= (uint32_t) byte << (8 * (mHeaderPos - 5));
+            if (mHeaderPos < HeaderLen)
+                break;
+            // zeroed: a back reference before the 1st byte reads 0 (as heatshrink)
+            mRing = (uint8_t *) calloc( RingLen, 1 );
+            if (! mRing)
+                return "no memory for decoder";
+            ESP_LOGI( TAG, "window %d bits, lookahead %d bits, %u bytes", mWindowBits, mCountBits, mSize );
+            mState = TAG;
+            break;
+    }
+    return 0;
+}
+
+bool Unshrink::Flush()
+{
+    uint16_t const start = mFlushed & (RingLen - 1);
+    uint16_t const end   = mPos ? mPos : RingLen;
+    if (mOut == mFlushed)
+        return true;
+    mFlushed = mOut;
+    return mSink( mCtx, & mRing[start], end - start );
+}
+
+bool Unshrink::Put( uint8_t byte )
+{
+    if (mOut >= mSize) {
+        mError = "more data than announced";
+        return false;
+    }
+    mRing[mPos] = byte;
+    mPos = (mPos + 1) & (RingLen - 1);
+    ++mOut;
+    if ((! mPos) && ! Flush()) {
+        mError = "write failed";
+        return false;
+    }
+    return true;
+}
+
+const char * Unshrink::Feed( const uint8_t * in, size_t len )
+{
+    while (len && ! mError) {
+        if (mState == HEADER) {
+            mError = Header( *in++ );
+            --len;
+            continue;
+        }
+        mBits = (mBits << 8) | *in++;  // max. 7 + 8 bits in use
+        mNofBits += 8;
+        --len;
+
+        bool more = true;
+        while (more && ! mError) {
+            uint8_t const need = (mState == TAG)     ? 1
+                               : (mState == LITERAL) ? 8
+                               : (mState == INDEX)   ? mWindowBits
+                               :                       mCountBits;
+            if (mNofBits < need)
+                break;
+            mNofBits -= need;
+            uint16_t const val = (mBits >> mNofBits) & ((1 << need) - 1);
+
+            switch (mState)
+            {
+                case TAG:
+                    mState = val ? LITERAL : INDEX;
+                    break;
+                case LITERAL:
+                    more = Put( (uint8_t) val );
+                    mState = TAG;
+                    break;
+                case INDEX:
+                    mIndex = val + 1;
+                    mState = COUNT;
+                    break;
+                case COUNT:
+                    for (uint16_t count = val + 1; more && count; --count)
+                        more = Put( mRing[(mPos - mIndex) & (RingLen - 1)] );
+                    mState = TAG;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return mError;
+}
+
+const char * Unshrink::Finish()
+{
+    if (mError)
+        return mError;
+    if (mState == HEADER)
+        return "incomplete header";
+    if (! Flush())
+        return "write failed";
+    if (mOut != mSize) {
+        ESP_LOGE( TAG, "decoded %u of %u bytes", mOut, mSize );
+        return "image incomplete";
+    }
+    return 0;
+}
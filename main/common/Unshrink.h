@@ -0,0 +1,71 @@
+/*
+ * Unshrink.h
+ *
+ * streaming decoder of images compressed by shrink.py (heatshrink LZSS bit stream):
+ * - header: 'h' 's' <window bits> <lookahead bits> <original length: uint32 LE>
+ * - then bits MSB first: 1 <8 bit literal> | 0 <window bits: offset - 1> <lookahead bits: count - 1>
+ * input may be fed in pieces of any size; the decoded data is collected in a ring
+ * of RingLen bytes (also the back reference window) and passed to the sink in
+ * RingLen chunks at ring offset 0 (sector aligned flash writes)
+ *
+ *   Unshrink unshrink{ sink, ctx };
+ *   while (...) err = unshrink.Feed( buf, len );
+ *   err = unshrink.Finish();
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>     // size_t
+
+class Unshrink
+{
+public:
+    typedef bool (*Sink)( void * ctx, const uint8_t * data, size_t len );  // false: abort
+
+    static constexpr uint8_t  Magic0        = 'h';  // 1st byte of a compressed image
+    static constexpr uint8_t  Magic1        = 's';
+    static constexpr uint8_t  HeaderLen     = 8;
+    static constexpr uint8_t  WindowBitsMax = 12;
+    static constexpr uint16_t RingLen       = 1 << WindowBitsMax;
+
+    Unshrink( Sink sink, void * ctx ) : mSink { sink }, mCtx { ctx } {};
+    ~Unshrink();
+    Unshrink( const Unshrink & ) = delete;
+    Unshrink & operator=( const Unshrink & ) = delete;
+
+    const char * Feed( const uint8_t * in, size_t len );  // 0 or error message
+    const char * Finish();                                // flush, check length
+
+    uint32_t Size() const { return mSize; };  // original length (0 until header parsed)
+    uint32_t Out()  const { return mOut; };   // bytes decoded so far
+
+private:
+    enum STATE : uint8_t {
+        HEADER,
+        TAG,
+        LITERAL,
+        INDEX,
+        COUNT,
+    };
+
+    const char * Header( uint8_t byte );
+    bool         Put( uint8_t byte );
+    bool         Flush();
+
+    Sink      mSink;
+    void    * mCtx;
+    uint8_t * mRing       { 0 };
+    uint16_t  mPos        { 0 };  // next write position in mRing
+    uint16_t  mIndex      { 0 };  // back reference offset
+    uint32_t  mBits       { 0 };  // bit accumulator
+    uint8_t   mNofBits    { 0 };
+    uint8_t   mWindowBits { 0 };
+    uint8_t   mCountBits  { 0 };
+    uint8_t   mHeaderPos  { 0 };
+    STATE     mState      { HEADER };
+    uint32_t  mSize       { 0 };
+    uint32_t  mOut        { 0 };
+    uint32_t  mFlushed    { 0 };  // mOut at last sink call
+    const char * mError   { 0 };  // sticky
+};
@@ -10,15 +10,31 @@
 #include "HttpParser.h"
 #include "HttpHelper.h"
 #include "HttpTable.h"
+#include "Unshrink.h"
+#include "Delta.h"
+#include "OtaPipe.h"
 
+#include <stdio.h>              // snprintf()
+#include <stdlib.h>             // strtoul()
 #include <string.h>             // memset()
+#include <string>               // std::string
 
 #include <esp_http_client.h>   	// esp_http_client_config_t
 #include <esp_ota_ops.h>   		// esp_ota_begin(), ...
 #include <esp_system.h>   	    // esp_restart()
 #include <esp_log.h>
+#include <esp_timer.h>          // esp_timer_get_time()
 #include <esp_flash_data_types.h> // esp_ota_select_entry_t, OTA_TEST_STAGE
 #include <nvs.h>                // nvs_open(), ...
+#include <mbedtls/pk.h>         // mbedtls_pk_verify()
+#include <mbedtls/ecdsa.h>      // MBEDTLS_ECDSA_MAX_LEN
+
+#ifdef OTA_SIGNED               // build option: signed images only
+#if defined(__has_include) && ! __has_include("otakey.i")
+#error "OTA_SIGNED: main/common/otakey.i missing - generate the key pair by sign.py --keygen"
+#endif
+#include "otakey.i"             // s_otaKey by sign.py --keygen
+#endif
 
 
 #if (LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG)
@@ -31,7 +47,38 @@ namespace {
 const char *const TAG            = "Updator";
 const char *const s_nvsNamespace = "update";
 const char *const s_keyUri       = "uri";
+const char *const s_keyRetries   = "retries";
 Updator           s_updator{};
+
+// 64 hex digits of sha256sum output
+bool parseDigest( const char * hex, uint8_t * digest )
+{
+    for (uint8_t i = 0; i < 64; ++i) {
+        char const c = hex[i] | 0x20;  // lower case
+        uint8_t const v = ((c >= '0') && (c <= '9')) ? c - '0'
+                        : ((c >= 'a') && (c <= 'f')) ? c - 'a' + 10 : 0xff;
+        if (v > 15)
+            return false;
+        digest[i / 2] = (i & 1) ? (digest[i / 2] | v) : (v << 4);
+    }
+    return true;
+}
+
+#ifdef OTA_SIGNED
+// ECDSA signature (DER) of the image digest by the key pair of s_otaKey
+const char * verifySignature( const uint8_t * digest, const uint8_t * sig, size_t len )
+{
+    const char * err = 0;
+    mbedtls_pk_context pk;
+    mbedtls_pk_init( & pk );
+    if (mbedtls_pk_parse_public_key( & pk, (const unsigned char *) s_otaKey, sizeof(s_otaKey) ) != 0)
+        err = "public key invalid";
+    else if (mbedtls_pk_verify( & pk, MBEDTLS_MD_SHA256, digest, 32, sig, len ) != 0)
+        err = "signature invalid";
+    mbedtls_pk_free( & pk );
+    return err;
+}
+#endif
 };
 
 extern "C" void UpdatorTask( void * updator )
@@ -39,6 +86,16 @@ extern "C" void UpdatorTask( void * updator )
     ((Updator *) updator)->Run();
 }
 
+extern "C" bool UpdatorOtaWrite( void * pipe, const uint8_t * data, size_t len )
+{
+    return ((OtaPipe *) pipe)->Write( data, len );
+}
+
+extern "C" bool UpdatorDeltaFeed( void * delta, const uint8_t * data, size_t len )
+{
+    return ! ((Delta *) delta)->Feed( data, len );
+}
+
 Updator& Updator::Instance()
 {
     return s_updator;
@@ -120,6 +177,7 @@ void Updator::ReadUri()
         ESP_LOGD( TAG, "Reading URI" );
         size_t len = sizeof(mUri);
         nvs_get_str( my_handle, s_keyUri, mUri, &len );
+        nvs_get_u8( my_handle, s_keyRetries, &mMaxRetries );
 
         nvs_close( my_handle );
     }
@@ -153,6 +211,33 @@ bool Updator::SetUri( const char * uri )
     return esp == ESP_OK;
 }
 
+bool Updator::SetMaxRetries( uint8_t retries )
+{
+    nvs_handle my_handle;
+    if (nvs_open( s_nvsNamespace, NVS_READWRITE, &my_handle ) != ESP_OK)
+        return false;
+    esp_err_t esp = nvs_set_u8( my_handle, s_keyRetries, retries );
+    nvs_commit( my_handle );
+    nvs_close( my_handle );
+
+    if (esp == ESP_OK)
+        mMaxRetries = retries;
+    return esp == ESP_OK;
+}
+
+uint32_t Updator::ReadRate() const
+{
+    return mReadUs ? (uint32_t) ((uint64_t) mReceived * 1000000 / mReadUs) : 0;
+}
+
+uint32_t Updator::Throughput() const
+{
+    int64_t const end = mEndUs ? mEndUs : esp_timer_get_time();
+    if ((! mStartUs) || (end <= mStartUs))
+        return 0;
+    return (uint32_t) ((int64_t) mReceived * 1000000 / (end - mStartUs));
+}
+
 bool Updator::Go( void )
 {
     if (!mUri[0]) {
@@ -231,35 +316,38 @@ void Updator::Run( void )
     }
 }
 
-void Updator::Update( void )
+// download url into the update partition: plain, compressed or patch of the running image
+const char * Updator::Download( const char * url, OtaPipe & pipe, char * buf, bool patch )
 {
     esp_http_client_config_t config;
     memset( & config, 0, sizeof(config) );
-    config.url = GetUri();
-
-    mProgress = 3;
-    mMsg = "malloc";
-    char *upgrade_data_buf = (char *) malloc( CONFIG_OTA_BUF_SIZE );
-    if (!upgrade_data_buf) {
-        ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
-        return;
-    }
+    config.url = url;
+    mTotal = 0;
+    mReceived = 0;
+    mWritten = 0;
+    mRetries = 0;
+    mStartUs = 0;
+    mEndUs = 0;
+    mReadUs = 0;
 
     mProgress = 4;
     mMsg = "http client init";
     esp_http_client_handle_t client = esp_http_client_init( & config );
     if (client == NULL) {
         ESP_LOGE(TAG, "Failed to initialize HTTP connection");
-        free( upgrade_data_buf );
-        return;
+        return mMsg;
     }
 
+    const char * err      = 0;
+    Unshrink   * unshrink = 0;  // compressed image or patch (shrink.py): 1st byte Unshrink::Magic0
+    Delta      * delta    = 0;  // patch.py: patch of the running image
     do { // while(0)
         mProgress = 5;
         mMsg = "http client open";
         esp_err_t e = esp_http_client_open( client, 0 );
         if (e != ESP_OK) {
             ESP_LOGE( TAG, "Failed to open HTTP connection: %d", e );
+            err = mMsg;
             break;
         }
         mProgress = 6;
@@ -267,10 +355,215 @@ void Updator::Update( void )
         int const totalLen = esp_http_client_fetch_headers( client );
         if (totalLen <= 0) {
             ESP_LOGE( TAG, "Failed to fetch headers: len = %d", totalLen );
+            err = mMsg;
+            break;
+        }
+        int const status_code = esp_http_client_get_status_code( client );
+        if (status_code != 200) {
+            ESP_LOGW( TAG, "%s: status %d", url, status_code );
+            err = "server response other than 200";
+            break;
+        }
+        mTotal = totalLen;
+        mStartUs = esp_timer_get_time();
+        if (patch) {
+            delta    = new Delta{ esp_ota_get_running_partition(), UpdatorOtaWrite, & pipe };
+            unshrink = new Unshrink{ UpdatorDeltaFeed, delta };
+        }
+
+        ESP_LOGI( TAG, "Please Wait. This may take time" );
+        mProgress = 9;
+        mMsg = "loop on http read and flash write";
+        while (1) {
+            int64_t const readStart = esp_timer_get_time();
+            int data_read = esp_http_client_read( client, buf, CONFIG_OTA_BUF_SIZE );
+            mReadUs += (uint32_t) (esp_timer_get_time() - readStart);
+            if ((data_read < 0) || ((data_read == 0) && (mReceived < (uint32_t) totalLen))) {
+                // connection lost: the decoders continue with the bytes following mReceived
+                err = Resume( client, totalLen );
+                if (err)
+                    break;
+                continue;
+            }
+            if (data_read == 0) {
+                ESP_LOGI( TAG, "Connection closed - all data received" );
+                if (unshrink)
+                    err = unshrink->Finish();
+                if (delta && ! err)
+                    err = delta->Finish();
+                break;
+            }
+            if ((! mReceived) && (! unshrink) && (buf[0] == Unshrink::Magic0)) {
+                ESP_LOGI( TAG, "compressed image" );
+                unshrink = new Unshrink{ UpdatorOtaWrite, & pipe };
+            }
+            mReceived += data_read;
+            if (unshrink) {
+                err = unshrink->Feed( (const uint8_t *) buf, data_read );
+                mWritten = delta ? delta->Out() : unshrink->Out();
+            } else {
+                if (! pipe.Write( (const uint8_t *) buf, data_read ))
+                    err = "flash write";
+                mWritten += data_read;
+            }
+            if (err)
+                break;
+            mFlashRate = pipe.Rate();
+            mHashCost  = pipe.HashCost();
+            ESP_LOGD( TAG, "Received %u, written image length %u", mReceived, mWritten );
+            mProgress = 10 + (mReceived * 76 + totalLen/2) / totalLen;
+        }
+        if (delta && delta->Error())
+            err = delta->Error();  // instead of unshrink's "write failed"
+        const char * const pipeErr = pipe.Flush();  // all data flashed
+        if (pipeErr)
+            err = pipeErr;
+        mFlashRate = pipe.Rate();
+        mHashCost  = pipe.HashCost();
+        mEndUs = esp_timer_get_time();
+        ESP_LOGI( TAG, "Received %u bytes, written %u bytes, %d retries, %u bytes/s (read %u, flash %u), sha256 %u us/KB",
+                       mReceived, mWritten, mRetries, Throughput(), ReadRate(), mFlashRate, mHashCost );
+    } while (0);
+
+    delete unshrink;
+    delete delta;
+    esp_http_client_cleanup( client );
+    if (err)
+        ESP_LOGE( TAG, "%s: %s", url, err );
+    return err;
+}
+
+const char * Updator::Resume( esp_http_client_handle_t client, int totalLen )
+{
+    char range[24];
+    snprintf( range, sizeof(range), "bytes=%u-", mReceived );
+    while (mRetries < mMaxRetries) {
+        ++mRetries;
+        ESP_LOGW( TAG, "connection lost at %u of %d bytes - retry %d of %d",
+                       mReceived, totalLen, mRetries, mMaxRetries );
+        mMsg = "reconnect";
+        esp_http_client_close( client );
+        vTaskDelay( configTICK_RATE_HZ * mRetries );  // increasing back off
+        esp_http_client_set_header( client, "Range", range );
+        if (esp_http_client_open( client, 0 ) != ESP_OK)
+            continue;
+        int const len    = esp_http_client_fetch_headers( client );
+        int const status = esp_http_client_get_status_code( client );
+        if (((status == 206) && (len == totalLen - (int) mReceived))
+         || ((status == 200) && (len == totalLen) && ! mReceived)) {
+            mMsg = "loop on http read and flash write";
+            return 0;
+        }
+        ESP_LOGE( TAG, "resume at %u refused: status %d, length %d", mReceived, status, len );
+        return "resume refused by server";  // no Range support or file changed
+    }
+    return "connection lost - retries exhausted";
+}
+
+int Updator::Fetch( const char * url, char * buf, int size )
+{
+    esp_http_client_config_t config;
+    memset( & config, 0, sizeof(config) );
+    config.url = url;
+    esp_http_client_handle_t client = esp_http_client_init( & config );
+    if (client == NULL)
+        return -1;
+
+    int len = -1;
+    do { // while (0)
+        if (esp_http_client_open( client, 0 ) != ESP_OK)
             break;
+        int const totalLen = esp_http_client_fetch_headers( client );
+        int const status   = esp_http_client_get_status_code( client );
+        if (status == 404) {
+            len = 0;
+            break;
+        }
+        if ((status != 200) || (totalLen <= 0) || (totalLen > size)) {
+            ESP_LOGE( TAG, "%s: status %d, length %d", url, status, totalLen );
+            break;
+        }
+        int got = 0;
+        while (got < totalLen) {
+            int const n = esp_http_client_read( client, & buf[got], totalLen - got );
+            if (n <= 0)
+                break;
+            got += n;
         }
+        if (got == totalLen)
+            len = got;
+    } while (0);
+
+    esp_http_client_cleanup( client );
+    return len;
+}
+
+// <image>.sha256 (and <image>.sig) by sign.py: checked against the streamed image before the boot switch
+const char * Updator::Expect( const std::string & image )
+{
+    mHasDigest = false;
+    mMsg = "fetch image digest";
+    char buf[100];
+    int len = Fetch( (image + ".sha256").c_str(), buf, sizeof(buf) - 1 );
+    if (len < 0)
+        return "digest download failed";
+    if (len == 0) {
+#ifdef OTA_SIGNED
+        return "no digest published (signed images only)";
+#else
+        ESP_LOGW( TAG, "%s.sha256 not found - image not checked", image.c_str() );
+        mCheck = "unchecked (no digest published)";
+        return 0;
+#endif
+    }
+    buf[len] = 0;
+    if ((len < 64) || ((len > 64) && (buf[64] != ' ') && (buf[64] != '\n')) || ! parseDigest( buf, mDigest ))
+        return "digest malformed";
+#ifdef OTA_SIGNED
+    mMsg = "verify signature";
+    uint8_t sig[MBEDTLS_ECDSA_MAX_LEN];
+    len = Fetch( (image + ".sig").c_str(), (char *) sig, sizeof(sig) );
+    if (len <= 0)
+        return "no signature published (signed images only)";
+    int64_t const start = esp_timer_get_time();
+    const char * const err = verifySignature( mDigest, sig, len );
+    ESP_LOGI( TAG, "signature check: %s (%u ms)", err ? err : "ok",
+                   (uint32_t) ((esp_timer_get_time() - start) / 1000) );
+    if (err)
+        return err;
+    mCheck = "signed sha256 published";
+#else
+    mCheck = "sha256 published";
+#endif
+    mHasDigest = true;
+    return 0;
+}
 
+void Updator::Update( void )
+{
+    mProgress = 3;
+    mMsg = "malloc";
+    char *upgrade_data_buf = (char *) malloc( CONFIG_OTA_BUF_SIZE );
+    if (!upgrade_data_buf) {
+        ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
+        mProgress = 99;
+        return;
+    }
+
+    do { // while(0)
         ESP_LOGI(TAG, "Starting OTA...");
+        mCheck = 0;
+        mHashCost = 0;
+        std::string image{ mUri };  // digest published for the uncompressed image
+        if ((image.size() > 3) && (image.compare( image.size() - 3, 3, ".hs" ) == 0))
+            image.resize( image.size() - 3 );
+        const char * err = Expect( image );
+        if (err) {
+            ESP_LOGE( TAG, "%s: %s", image.c_str(), err );
+            mMsg = err;
+            break;
+        }
+
         const esp_partition_t *update_partition = NULL;
         mProgress = 7;
         mMsg = "get next partition";
@@ -282,59 +575,67 @@ void Updator::Update( void )
         ESP_LOGI( TAG, "Writing to partition subtype %d at offset 0x%x",
                   update_partition->subtype, update_partition->address );
 
-        esp_ota_handle_t update_handle = 0;
+        OtaPipe pipe{ update_partition };  // flash writer task, erases ahead
         mProgress = 8;
         mMsg = "flash erase";
-        e = esp_ota_begin( update_partition, OTA_SIZE_UNKNOWN, &update_handle );
+        esp_err_t e = pipe.Begin();
         if (e != ESP_OK) {
             ESP_LOGE( TAG, "esp_ota_begin failed, error=%d", e );
             break;
         }
         ESP_LOGI( TAG, "esp_ota_begin succeeded" );
-        ESP_LOGI( TAG, "Please Wait. This may take time" );
-        int data_written = 0;
-        mProgress = 9;
-        mMsg = "loop on http read and flash write";
-        const char * lastAction;
-        while (1) {
-            lastAction = "http client read";
-            int data_read = esp_http_client_read( client, upgrade_data_buf, CONFIG_OTA_BUF_SIZE );
-            if (data_read == 0) {
-                ESP_LOGI( TAG, "Connection closed - all data received" );
-                e = ESP_OK;
-                break;
-            }
-            if (data_read < 0) {
-                ESP_LOGE( TAG, "Error: SSL data read error" );
-                e = ESP_FAIL;
-                break;
-            }
-            if (data_read > 0) {
-                lastAction = "flash write";
-                e = esp_ota_write( update_handle, (const void *)upgrade_data_buf, data_read );
-                if (e != ESP_OK) {
-                    ESP_LOGE( TAG, "Error: esp_ota_write failed! err=0x%d", e );
-                    break;
+
+        // delta update: <uri>.patch (patch.py) - full image on any failure
+        err = "no patch";
+        size_t const uriLen = strlen( mUri );
+        if ((uriLen > 4) && (strcmp( & mUri[uriLen - 4], ".bin" ) == 0)) {
+            std::string const patchUri = std::string{ mUri } + ".patch";
+            err = Download( patchUri.c_str(), pipe, upgrade_data_buf, true );
+            if (err) {
+                ESP_LOGW( TAG, "delta update failed (%s) - full image download", err );
+                if (pipe.Queued()) {  // partition got written: start over
+                    pipe.End();
+                    mProgress = 8;
+                    mMsg = "flash erase";
+                    e = pipe.Begin();
+                    if (e != ESP_OK) {
+                        ESP_LOGE( TAG, "esp_ota_begin failed, error=%d", e );
+                        break;
+                    }
                 }
-                data_written += data_read;
-                ESP_LOGD( TAG, "Written image length %d", data_written );
-                mProgress = 10 + (data_written * 76 + totalLen/2) / totalLen;
             }
         }
-        ESP_LOGD( TAG, "Total binary data length writen: %d", data_written );
+        if (err)
+            err = Download( mUri, pipe, upgrade_data_buf, false );
 
         mProgress = 87;
         mMsg = "flash finalize";
-        esp_err_t e2 = esp_ota_end( update_handle );
+        esp_err_t e2 = pipe.End();
         if (e2 != ESP_OK) {
             ESP_LOGE( TAG, "Error: esp_ota_end failed! err=0x%d. Image is invalid", e2 );
+            if (err)
+                mMsg = err;
             break;
         }
         mProgress = 88;
-        if (e != ESP_OK) {
-            mMsg = lastAction;
+        if (err) {
+            mMsg = err;
             break;
         }
+        mHashCost = pipe.HashCost();
+        if (mHasDigest) {  // sha256 streamed by the flash writer
+            if (memcmp( pipe.Digest(), mDigest, OtaPipe::DigestLen ) != 0) {
+                ESP_LOGE( TAG, "sha256 of the image does not match %s.sha256", image.c_str() );
+                mCheck = "sha256 mismatch";
+                mMsg = "image sha256 mismatch - boot partition not switched";
+                break;
+            }
+#ifdef OTA_SIGNED
+            mCheck = "signature and sha256 verified";
+#else
+            mCheck = "sha256 verified";
+#endif
+        }
 
         mProgress = 89;
         mMsg = "set boot partition";
@@ -354,7 +655,6 @@ void Updator::Update( void )
     } while(0);
 
     free( upgrade_data_buf );
-    esp_http_client_cleanup( client );
 
     if (mProgress != 90) {
         mProgress = 99;  // enables retry
@@ -501,10 +801,12 @@ void Updator::PostFavicon( httpd_req_t * req )
             hh.Add( "failed to store type" );
         } else {
             esp = nvs_set_blob( my_handle, "favicon", buf, totalLen );
-            if (esp == ESP_OK)
-                hh.Add( "failed to store image (size %d)", totalLen );
+            if (esp != ESP_OK)
+                hh.Add( "failed to store image (size " + std::to_string( totalLen ) + ")" );
+            else if (nvs_commit( my_handle ) != ESP_OK)
+                hh.Add( "failed to commit image" );
             else {
-                nvs_commit( my_handle );
+                WebServer::Instance().FaviconChanged();  // new ETag: clients reload the icon
                 hh.Add( "success" );
             }
         }
@@ -534,7 +836,7 @@ void Updator::GetUpdate( httpd_req_t * req )
     }
 
     if (editable) {
-        Table<4,9> table;
+        Table<4,9,Cols(0, 1, 5, 6, 8)> table;
         table[0][0] = "Idx";
         table[0][1] = "Partition";
         table[0][2] = "&nbsp;";
@@ -545,12 +847,6 @@ void Updator::GetUpdate( httpd_req_t * req )
         table[0][7] = "Description";
         table[0][8] = "Address";
 
-        table.Right(0);
-        table.Right(1);
-        table.Right(5);
-        table.Right(6);
-        table.Right(8);
-
         const esp_partition_t* running = esp_ota_get_running_partition();
         const esp_partition_t* otadata = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_OTA, NULL);
         const uint8_t n = get_ota_partition_count();
@@ -682,8 +978,7 @@ void Updator::GetUpdate( httpd_req_t * req )
         hh.Add( "  <form method=\"post\">\n" );
     hh.Add( "  <table>\n" );
     {
-        Table<4,4> table;
-        table.Right( 0 );       // 1st column: right aligned
+        Table<7,4,Cols(0)> table;  // 1st column: right aligned
         table[0][1] = "&nbsp;"; // some padding
 
         table[0][0] = "uri:";
@@ -725,15 +1020,38 @@ void Updator::GetUpdate( httpd_req_t * req )
             table[2][2] += buf;
             table[2][2] += "\" />";
         }
+        table[3][0] = "retries:";
+        if (editable)
+            table[3][2] = "<input type=\"number\" name=\"retries\" min=0 max=20 value=\""
+                        + std::to_string( updator.MaxRetries() ) + "\">";
+        else
+            table[3][2] = std::to_string( updator.Retries() ) + " of " + std::to_string( updator.MaxRetries() );
+        if (updator.Received()) {
+            table[4][0] = "received:";
+            table[4][2] = std::to_string( updator.Received() ) + " of " + std::to_string( updator.Total() )
+                        + " bytes, written " + std::to_string( updator.Written() )
+                        + ", " + std::to_string( updator.Throughput() / 1024 ) + " KB/s"
+                        + " (download " + std::to_string( updator.ReadRate() / 1024 ) + " KB/s"
+                        + ", flash " + std::to_string( updator.FlashRate() / 1024 ) + " KB/s)";
+            if (editable && updator.Retries())
+                table[4][2] += ", " + std::to_string( updator.Retries() ) + " retries";
+        }
+
+        if (updator.GetCheck()) {
+            table[5][0] = "image check:";
+            table[5][2] = updator.GetCheck();
+            if (updator.HashCost())
+                table[5][2] += " (sha256 " + std::to_string( updator.HashCost() ) + " us/KB)";
+        }
 
         if (showmsg) {
             const char * msg = updator.GetMsg();
             if (msg && *msg) {
                 if (progress == 99)
-                    table[3][0] = "last status message:";
+                    table[6][0] = "last status message:";
                 else
-                    table[3][0] = "status message:";
-                table[3][2] = msg;
+                    table[6][0] = "status message:";
+                table[6][2] = msg;
             }
         }
         table.AddTo( hh );
@@ -750,8 +1068,7 @@ void Updator::GetUpdate( httpd_req_t * req )
                 "  <form method=\"post\" action=\"/favicon\">\n"
                 "   <table>\n" );
         {
-            Table<3,4> table;
-            table.Right( 0 );
+            Table<3,4,Cols(0)> table;
             table[0][1] = "&nbsp;";
 
             table[0][0] = "type:";
@@ -768,7 +1085,9 @@ void Updator::GetUpdate( httpd_req_t * req )
             if (*strFw) {
                 table[1][2] += " value=\"";
                 int lenFw = strlen( strFw );
-                if (strcmp( strFw + lenFw - 4, ".bin" ) == 0)
+                if ((lenFw > 3) && (strcmp( strFw + lenFw - 3, ".hs" ) == 0))  // compressed image
+                    lenFw -= 3;
+                if ((lenFw > 4) && (strncmp( strFw + lenFw - 4, ".bin", 4 ) == 0))
                     lenFw -= 4;
                 char const * build = strstr( strFw, "/build/" );
                 if (build) {
@@ -839,7 +1158,9 @@ void Updator::PostUpdate( httpd_req_t * req )
     }
 
     char uri[80];
-    HttpParser::Input in[] = { {"uri",uri,sizeof(uri)} };
+    char retries[4];
+    HttpParser::Input in[] = { {"uri",uri,sizeof(uri)},
+                               {"retries",retries,sizeof(retries)} };
     HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
 
     const char * parseError = parser.ParsePostData( req );
@@ -855,6 +1176,13 @@ void Updator::PostUpdate( httpd_req_t * req )
         if (! updator.SetUri( uri ))
             err = "failed to store new uri";
     }
+    if (retries[0] && ! err) {
+        unsigned long const n = strtoul( retries, 0, 10 );
+        if (n > 20)
+            err = "retries: 0..20";
+        else if ((n != updator.MaxRetries()) && ! updator.SetMaxRetries( (uint8_t) n ))
+            err = "failed to store retries";
+    }
     if (err) {
         hh.Add( "  <form method=\"post\">\n" // enctype=\"multipart/form-data\"
                 "   <table>\n"
@@ -10,8 +10,12 @@
 #include <semphr.h>
 
 #include <driver/gpio.h>    // gpio_num_t
+#include <esp_http_client.h>  // esp_http_client_handle_t
+
+#include <string>           // std::string
 
 class WebServer;
+class OtaPipe;
 
 class Updator
 {
@@ -26,6 +30,17 @@ public:
     const char * GetUri()   const { return mUri; };       // get uri to be used for download
     const char * GetMsg()   const { return mMsg; };       // status message
     uint8_t      Progress() const { return mProgress; };  // to be used for progress bar
+    uint32_t     Total()    const { return mTotal; };     // content length of the image download
+    uint32_t     Received() const { return mReceived; };  // bytes downloaded (compressed or not)
+    uint32_t     Written()  const { return mWritten; };   // bytes written to flash
+    uint8_t      Retries()  const { return mRetries; };   // reconnects of the current/last download
+    uint8_t      MaxRetries() const { return mMaxRetries; };
+    uint32_t     Throughput() const;                      // of the current/last download [bytes/s]
+    uint32_t     ReadRate()   const;                      // http read stage [bytes/s of read time]
+    uint32_t     FlashRate()  const { return mFlashRate; };  // flash stage (OtaPipe) [bytes/s of busy time]
+    uint32_t     HashCost()   const { return mHashCost; };   // streaming sha256 [us per KB]
+    const char * GetCheck()   const { return mCheck; };      // image check: digest/signature status
+    bool         SetMaxRetries( uint8_t retries );        // set in nvs
 
     bool Init();
     void AddPage( WebServer & webserver );
@@ -37,11 +52,28 @@ public:
     void Run();  // internal thread routine, but must be public
 private:
     void Update();
+    const char * Download( const char * url, OtaPipe & pipe, char * buf, bool patch );  // 0 or error
+    const char * Resume( esp_http_client_handle_t client, int totalLen );  // reconnect at mReceived
+    const char * Expect( const std::string & image );  // digest/signature published by sign.py: 0 or error
+    int          Fetch( const char * url, char * buf, int size );  // small file: length, 0: not found, -1: error
     void ReadUri();
 
     uint8_t           mProgress   {0};   // 0: idle / 1:..94,96..98: progress / 95: confirm / 99: failed / 100: success
     char              mUri[80]    {""};  // http://my.really.long.uri:8888/to/firmware/location/is/67/in/length
     const char      * mMsg        {0};   // status information
+    uint32_t          mTotal      {0};
+    uint32_t          mReceived   {0};
+    uint32_t          mWritten    {0};
+    uint8_t           mRetries    {0};
+    uint8_t           mMaxRetries {3};   // reconnects per download (Range: bytes=<received>-)
+    int64_t           mStartUs    {0};   // download start/end: throughput
+    int64_t           mEndUs      {0};
+    uint32_t          mReadUs     {0};   // time in esp_http_client_read
+    uint32_t          mFlashRate  {0};
+    uint32_t          mHashCost   {0};
+    const char      * mCheck      {0};   // image check status
+    bool              mHasDigest  {false};
+    uint8_t           mDigest[32] {};    // expected sha256 of the image
     TaskHandle_t      mTaskHandle {0};
     SemaphoreHandle_t mSemaphore  {0};
 };
@@ -13,16 +13,24 @@
 #include "HttpHelper.h"
 #include "HttpTable.h"
 #include "HttpParser.h"
-#include "favicon.i"            // favicon_ico (when no image in nvs)
+#include "JsonApi.h"
+#include "EventStream.h"
+#include "Assets.h"
 
+#include <stdio.h>      // snprintf()
+#include <stdlib.h>     // strtoul(), malloc()
 #include <string.h>     // memmove()
 #include <string>       // std::string
 
 #include <esp_log.h>   			// ESP_LOGI()
+#include <esp_timer.h>          // esp_timer_get_time()
+#include <esp_system.h>         // esp_get_free_heap_size()
 #include <esp_event_base.h>   	// esp_event_base_t
 #include <esp_ota_ops.h>        // esp_ota_get_app_description()
 #include <esp_flash_data_types.h> // esp_ota_select_entry_t, OTA_TEST_STAGE
 #include <esp_http_client.h>   	// esp_http_client_config_t
+#include <esp_partition.h>        // esp_partition_find_first()
+#include <esp_spi_flash.h>        // spi_flash_read()
 #include <nvs.h>
 
 #if (LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG)
@@ -35,7 +43,7 @@ extern "C" {
 
 extern uint64_t g_esp_os_cpu_clk;
 
-httpd_handle_t  start_webserver( void );
+httpd_handle_t  start_webserver( const WebServer::Config & cfg );
 void            stop_webserver( httpd_handle_t server );
 void            disconnect_handler( void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data );
 void            connect_handler(    void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data );
@@ -43,6 +51,12 @@ void            connect_handler(    void * arg, esp_event_base_t event_base, int
 esp_err_t       handler_get_main(      httpd_req_t * req );
 esp_err_t       handler_get_favicon(   httpd_req_t * req );
 esp_err_t       handler_get_readflash( httpd_req_t * req );
+esp_err_t       handler_api(           httpd_req_t * req );
+esp_err_t       handler_api_main(      httpd_req_t * req );
+esp_err_t       handler_get_stats(     httpd_req_t * req );
+esp_err_t       handler_api_stats(     httpd_req_t * req );
+esp_err_t       handler_api_config(    httpd_req_t * req );
+esp_err_t       handler_timed(         httpd_req_t * req );
 
 }
 
@@ -54,7 +68,87 @@ WebServer          s_WebServer{};
 const httpd_uri_t uri_main        = { .uri = "/",            .method = HTTP_GET, .handler = handler_get_main,      .user_ctx = 0 };
 const httpd_uri_t uri_readflash   = { .uri = "/readflash",   .method = HTTP_GET, .handler = handler_get_readflash, .user_ctx = 0 };
 const httpd_uri_t uri_get_favicon = { .uri = "/favicon.ico", .method = HTTP_GET, .handler = handler_get_favicon,   .user_ctx = 0 };
+const httpd_uri_t uri_get_api     = { .uri = "/api/*",       .method = HTTP_GET,  .handler = handler_api,          .user_ctx = 0 };
+const httpd_uri_t uri_post_api    = { .uri = "/api/*",       .method = HTTP_POST, .handler = handler_api,          .user_ctx = 0 };
+const httpd_uri_t uri_get_stats   = { .uri = "/stats",       .method = HTTP_GET,  .handler = handler_get_stats,    .user_ctx = 0 };
 const WebServer::Page page_home     { uri_main, "Home" };
+const WebServer::Page page_stats    { uri_get_stats, "Stats" };
+
+const char * const s_nvsNamespace = "httpd";
+const char * const s_keySockets    = "sockets";
+const char * const s_keyLruPurge   = "lru";
+const char * const s_keyRecvTmo    = "rcvtmo";
+const char * const s_keySendTmo    = "sndtmo";
+const char * const s_keyStack      = "stack";
+const char * const s_keyUriSlots   = "uris";
+
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+uint8_t const MaxSockets = CONFIG_LWIP_MAX_SOCKETS - 3;  // httpd needs 3 internally
+#else
+uint8_t const MaxSockets = 7;
+#endif
+uint8_t  const TimeoutMax = 60;     // [s] recv/send timeout
+uint16_t const StackMin   = 4096;   // httpd task: handlers run on its stack
+uint16_t const StackMax   = 16384;
+uint8_t  const UrisMin    = 8;
+uint8_t  const UrisMax    = 64;
+
+// value out of range (e.g. nvs written by an older firmware): default used
+template <typename T> void checkRange( const char * name, T & val, unsigned min, unsigned max, T def )
+{
+    if ((val >= min) && (val <= max))
+        return;
+    ESP_LOGW( TAG, "%s %u not in %u..%u - using %u", name, (unsigned) val, min, max, (unsigned) def );
+    val = def;
+}
+
+// Range: bytes=<from>-<to> | <from>- | -<suffix length>
+// false: no single byte range (ignored) / from > to: not satisfiable
+bool parseRange( const char * hdr, unsigned long size, unsigned long & from, unsigned long & to )
+{
+    if (strncmp( hdr, "bytes=", 6 ) || strchr( hdr, ',' ))
+        return false;
+    const char * const spec = & hdr[6];
+    char * end;
+    unsigned long first;
+    unsigned long last = size - 1;
+    if (*spec == '-') {  // suffix
+        unsigned long const len = strtoul( & spec[1], & end, 10 );
+        if (*end || (end == & spec[1]))
+            return false;
+        first = (len < size) ? size - len : 0;
+        if (! len)
+            first = size;  // not satisfiable
+    } else {
+        first = strtoul( spec, & end, 10 );
+        if ((end == spec) || (*end != '-'))
+            return false;
+        if (end[1]) {
+            last = strtoul( & end[1], & end, 10 );
+            if (*end || (last < first))
+                return false;  // invalid: to be ignored
+            if (last >= size)
+                last = size - 1;
+        }
+    }
+    from = first;  // first >= size: not satisfiable (from > to)
+    to   = last;
+    return true;
+}
+
+char s_faviconEtag[Assets::EtagLen] {};  // of the favicon sent last (cleared on upload)
+
+void sendFavicon( httpd_req_t * req, const char * type, const char * data, size_t len )
+{
+    if (! s_faviconEtag[0]) {
+        Assets::Etag( s_faviconEtag, data, len );
+        if (Assets::NotModified( req, s_faviconEtag, "no-cache" ))
+            return;
+    }
+    httpd_resp_set_type( req, type );
+    httpd_resp_send( req, data, len );
+    HttpHelper::Sent( len );
+}
 
 } // namespace
 
@@ -73,29 +167,117 @@ void WebServer::AddPage( const WebServer::Page & page, const httpd_uri_t * postU
         mAnchor = elem;
     }
     mLastElem = elem;
+    HttpHelper::InvalidateHead();  // menu changed
 
-    httpd_register_uri_handler( mServer, &page.Uri );
+    Register( page.Uri );
     if (postUri)
-        httpd_register_uri_handler( mServer, postUri );
+        Register( *postUri );
 }
 
 void WebServer::AddUri( const httpd_uri_t & uri )
 {
-    httpd_register_uri_handler( mServer, & uri );
+    Register( uri );
+}
+
+void WebServer::Register( const httpd_uri_t & uri )
+{
+    UriStats * stats = new UriStats{ uri };
+    httpd_uri_t timed = uri;  // uri string gets copied by httpd
+    timed.handler  = handler_timed;
+    timed.user_ctx = stats;
+    if (httpd_register_uri_handler( mServer, & timed ) != ESP_OK) {
+        ESP_LOGE( TAG, "cannot register %s", uri.uri );
+        delete stats;
+        return;
+    }
+    UriStats ** link = & mUriStats;
+    while (*link)
+        link = & (*link)->Next;
+    *link = stats;
+}
+
+esp_err_t WebServer::Timed( httpd_req_t * req, UriStats & stats )
+{
+    req->user_ctx = stats.UserCtx;
+    uint32_t const bytes = HttpHelper::GetStats().bytes;
+    HttpHelper::HeapLowReset();
+    int64_t const start = esp_timer_get_time();
+
+    esp_err_t const ret = stats.Handler( req );
+
+    uint32_t const us = (uint32_t) (esp_timer_get_time() - start);
+    uint32_t const heapLow = HttpHelper::HeapLow();
+    ++stats.Calls;
+    stats.TotalUs += us;
+    if (stats.MaxUs < us)
+        stats.MaxUs = us;
+    stats.Bytes += HttpHelper::GetStats().bytes - bytes;
+    if (stats.HeapLow > heapLow)
+        stats.HeapLow = heapLow;
+    if (us > 1000000)
+        ESP_LOGW( TAG, "%s blocked the httpd task for %u ms", stats.Uri, us / 1000 );
+    return ret;
 }
 
-void WebServer::Init()
+void WebServer::FaviconChanged()
 {
+    s_faviconEtag[0] = 0;
+}
+
+void WebServer::AddApi( const char * name, ApiHandler handler )
+{
+    ApiList ** link = & mApi;
+    while (*link)
+        link = & (*link)->Next;
+    *link = new ApiList { name, handler };
+}
+
+void WebServer::ReadConfig()
+{
+    nvs_handle my_handle;
+    if (nvs_open( s_nvsNamespace, NVS_READONLY, &my_handle ) != ESP_OK)
+        return;  // defaults
+    uint8_t lru;
+    nvs_get_u8(  my_handle, s_keySockets,  & mConfig.maxSockets );
+    if (nvs_get_u8( my_handle, s_keyLruPurge, & lru ) == ESP_OK)
+        mConfig.lruPurge = lru;
+    nvs_get_u8(  my_handle, s_keyRecvTmo,  & mConfig.recvTimeout );
+    nvs_get_u8(  my_handle, s_keySendTmo,  & mConfig.sendTimeout );
+    nvs_get_u16( my_handle, s_keyStack,    & mConfig.stackSize );
+    nvs_get_u8(  my_handle, s_keyUriSlots, & mConfig.uriSlots );
+    nvs_close( my_handle );
+}
+
+void WebServer::Init( const Config * config )
+{
+    if (config)
+        mConfig = *config;
+    else
+        ReadConfig();
+    Config const def{};
+    checkRange( s_keySockets,  mConfig.maxSockets,  1, MaxSockets, (def.maxSockets < MaxSockets) ? def.maxSockets : MaxSockets );
+    checkRange( s_keyRecvTmo,  mConfig.recvTimeout, 1, TimeoutMax, def.recvTimeout );
+    checkRange( s_keySendTmo,  mConfig.sendTimeout, 1, TimeoutMax, def.sendTimeout );
+    checkRange( s_keyStack,    mConfig.stackSize,   StackMin, StackMax, def.stackSize );
+    checkRange( s_keyUriSlots, mConfig.uriSlots,    UrisMin,  UrisMax,  def.uriSlots );
+
     ESP_LOGI( TAG, "Start web server" );
-    mServer = start_webserver();
+    mServer = start_webserver( mConfig );
     if (! mServer)
         return;
 
     ESP_LOGD( TAG, "Registering URI handlers" ); EXPRD( vTaskDelay(1) )
 
-    httpd_register_uri_handler( mServer, &uri_readflash );  // debug interface to read flash data
+    Register( uri_readflash );  // debug interface to read flash data
+    Register( uri_get_api );
+    Register( uri_post_api );
+    EventStream::Instance().Init( *this );  // /events
+    Assets::Init( *this );                  // /static/*
 
     AddPage( page_home, &uri_main );
+    AddApi( "status", handler_api_main );
+    AddApi( "stats",  handler_api_stats );
+    AddApi( "httpd",  handler_api_config );
 }
 
 void WebServer::InitPages()
@@ -105,14 +287,15 @@ void WebServer::InitPages()
     Wifi::Instance()     .AddPage( *this );
     Mqtinator::Instance().AddPage( *this );
     Updator::Instance()  .AddPage( *this );
+    AddPage( page_stats );
 
-    httpd_register_uri_handler( mServer, &uri_get_favicon );
+    Register( uri_get_favicon );
 }
 
 void WebServer::MainPage( httpd_req_t * req )
 {
     HttpHelper hh{ req, 0, "Home" };
-    Table<8,3> table;
+    Table<9,3> table;
     Indicator & indicator = Indicator::Instance();
 
     const esp_app_desc_t *const desc = esp_ota_get_app_description();
@@ -126,6 +309,7 @@ void WebServer::MainPage( httpd_req_t * req )
         table[5][0] = "sec. sig. mask:";
     table[6][0] = "boot counter:";     table[6][2] = HttpHelper::String( (uint32_t) BootCnt::Instance().Cnt() );
     table[7][0] = "uptime:";
+    table[8][0] = "page head [us]:";   table[8][2] = HttpHelper::String( HttpHelper::HeadUs() );  // of previous request
 
     {
         const unsigned long * mask  = indicator.SigMask();
@@ -173,18 +357,243 @@ void WebServer::MainPage( httpd_req_t * req )
     hh.Add( "  </table>\n" );
 }
 
+void WebServer::MainApi( httpd_req_t * req )
+{
+    Indicator & indicator = Indicator::Instance();
+    const esp_app_desc_t *const desc = esp_ota_get_app_description();
+    uint32_t const bootCnt = BootCnt::Instance().Cnt();
+    uint32_t const uptime  = (uint32_t) (g_esp_os_cpu_clk / (CPU_CLK_FREQ));
+    uint32_t const headUs  = HttpHelper::HeadUs();
+    const HttpHelper::Stats & stats = HttpHelper::GetStats();
+    EventStream & events = EventStream::Instance();
+    const EventStream::Stats & evStats = events.GetStats();
+    uint8_t const clients = events.Clients();
+
+    JsonApi::Field const fields[] = { JsonApi::F( "project", desc->project_name ),
+                                      JsonApi::F( "version", desc->version ),
+                                      JsonApi::F( "idf",     desc->idf_ver ),
+                                      JsonApi::F( "rtos",    tskKERNEL_VERSION_NUMBER ),
+                                      JsonApi::F( "bootcnt", bootCnt ),
+                                      JsonApi::F( "uptime",  uptime ),   // [s]
+                                      JsonApi::F( "headus",  headUs ) };
+    JsonApi::Field const http[]   = { JsonApi::F( "responses", stats.responses ),
+                                      JsonApi::F( "chunks",    stats.chunks ),
+                                      JsonApi::F( "bytes",     stats.bytes ),
+                                      JsonApi::F( "maxchunks", stats.maxChunks ),
+                                      JsonApi::F( "poolmiss",  stats.poolMiss ) };
+    JsonApi::Field const sse[]    = { JsonApi::F( "clients",   clients ),
+                                      JsonApi::F( "posted",    evStats.posted ),
+                                      JsonApi::F( "coalesced", evStats.coalesced ),
+                                      JsonApi::F( "sent",      evStats.sent ),
+                                      JsonApi::F( "noslot",    evStats.noslot ),
+                                      JsonApi::F( "rejected",  evStats.rejected ),
+                                      JsonApi::F( "failed",    evStats.failed ) };
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( "read only" );
+    json.Add( fields, sizeof(fields) / sizeof(fields[0]) );
+
+    json.Open( "sigmask", '[' );
+    const unsigned long * mask = indicator.SigMask();
+    for (uint8_t led = 0; led < indicator.NofLEDs(); ++led)
+        json.Uint( 0, mask[led] );
+    json.Close();
+
+    json.Open( "http" );
+    json.Add( http, sizeof(http) / sizeof(http[0]) );
+    json.Close();
+
+    json.Open( "events" );
+    json.Add( sse, sizeof(sse) / sizeof(sse[0]) );
+}
+
+void WebServer::StatsPage( httpd_req_t * req )
+{
+    HttpHelper hh{ req, "Handler statistics", "Stats" };
+
+    hh.Add( "  <table border=0>\n" );
+    Table<1,9,ColRange(2, 9)> table;
+    table[0][0] = "uri";
+    table[0][1] = "method";
+    table[0][2] = "calls";
+    table[0][3] = "avg. [ms]";
+    table[0][4] = "max. [ms]";
+    table[0][5] = "total [s]";
+    table[0][6] = "bytes";
+    table[0][7] = "avg. bytes";
+    table[0][8] = "min. free heap";
+    table.AddTo( hh, /*headrows*/ 1 );
+
+    for (const UriStats * stats = mUriStats; stats; stats = stats->Next) {
+        table[0][0] = stats->Uri;
+        table[0][1] = (stats->Method == HTTP_POST) ? "POST" : "GET";
+        table[0][2] = HttpHelper::String( stats->Calls );
+        if (stats->Calls) {
+            table[0][3] = HttpHelper::String( (double) stats->TotalUs / stats->Calls / 1000, 1 );
+            table[0][4] = HttpHelper::String( (double) stats->MaxUs / 1000, 1 );
+            table[0][5] = HttpHelper::String( (double) stats->TotalUs / 1000000, 1 );
+            table[0][6] = HttpHelper::String( stats->Bytes );
+            table[0][7] = HttpHelper::String( stats->Bytes / stats->Calls );
+            table[0][8] = HttpHelper::String( stats->HeapLow );
+        } else {
+            for (uint8_t c = 3; c < 9; ++c)
+                table[0][c] = "-";
+        }
+        table.AddTo( hh, 0, /*headcols*/ 1 );
+    }
+    hh.Add( "  </table>\n" );
+}
+
+void WebServer::StatsApi( httpd_req_t * req )
+{
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( "read only" );
+    json.Uint( "heap", esp_get_free_heap_size() );
+    json.Open( "handlers", '[' );
+    for (const UriStats * stats = mUriStats; stats; stats = stats->Next) {
+        uint32_t const totalMs = (uint32_t) (stats->TotalUs / 1000);
+        JsonApi::Field const fields[] = { JsonApi::F( "uri",     stats->Uri ),
+                                          JsonApi::F( "calls",   stats->Calls ),
+                                          JsonApi::F( "totalms", totalMs ),
+                                          JsonApi::F( "maxus",   stats->MaxUs ),
+                                          JsonApi::F( "bytes",   stats->Bytes ) };
+        json.Open( 0 );
+        json.Add( fields, sizeof(fields) / sizeof(fields[0]) );
+        json.Str( "method", (stats->Method == HTTP_POST) ? "POST" : "GET" );
+        if (stats->Calls)
+            json.Uint( "heaplow", stats->HeapLow );
+        else
+            json.Null( "heaplow" );
+        json.Close();
+    }
+}
+
+std::string WebServer::PostConfig( httpd_req_t * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
+{
+    if (! req->content_len)
+        return "no data";
+
+    char socketsBuf[4];
+    char lruBuf[4];
+    char recvBuf[4];
+    char sendBuf[4];
+    char stackBuf[8];
+    char urisBuf[4];
+    HttpParser::Input in[] = { { s_keySockets,  socketsBuf, sizeof(socketsBuf) },
+                               { s_keyLruPurge, lruBuf,     sizeof(lruBuf) },
+                               { s_keyRecvTmo,  recvBuf,    sizeof(recvBuf) },
+                               { s_keySendTmo,  sendBuf,    sizeof(sendBuf) },
+                               { s_keyStack,    stackBuf,   sizeof(stackBuf) },
+                               { s_keyUriSlots, urisBuf,    sizeof(urisBuf) } };
+    HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
+    JsonApi::Prefill( in, sizeof(in) / sizeof(in[0]), defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    unsigned long const sockets = strtoul( socketsBuf, 0, 0 );
+    unsigned long const recvTmo = strtoul( recvBuf,    0, 0 );
+    unsigned long const sendTmo = strtoul( sendBuf,    0, 0 );
+    unsigned long const stack   = strtoul( stackBuf,   0, 0 );
+    unsigned long const uris    = strtoul( urisBuf,    0, 0 );
+    if ((sockets < 1) || (sockets > MaxSockets))
+        return "sockets: 1.." + std::to_string( MaxSockets );
+    if ((recvTmo < 1) || (recvTmo > TimeoutMax) || (sendTmo < 1) || (sendTmo > TimeoutMax))
+        return "timeouts: 1.." + std::to_string( TimeoutMax ) + " s";
+    if ((stack < StackMin) || (stack > StackMax))
+        return "stack: " + std::to_string( StackMin ) + ".." + std::to_string( StackMax );
+    if ((uris < UrisMin) || (uris > UrisMax))
+        return "uris: " + std::to_string( UrisMin ) + ".." + std::to_string( UrisMax );
+
+    nvs_handle my_handle;
+    esp_err_t e = nvs_open( s_nvsNamespace, NVS_READWRITE, &my_handle );
+    if (e != ESP_OK)
+        return "cannot open nvs namespace";
+    e = nvs_set_u8( my_handle, s_keySockets, (uint8_t) sockets );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyLruPurge, (lruBuf[0] == '1') || (lruBuf[0] == 't') );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyRecvTmo,  (uint8_t) recvTmo );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keySendTmo,  (uint8_t) sendTmo );
+    if (e == ESP_OK) e = nvs_set_u16( my_handle, s_keyStack,    (uint16_t) stack );
+    if (e == ESP_OK) e = nvs_set_u8(  my_handle, s_keyUriSlots, (uint8_t) uris );
+    if (e == ESP_OK)
+        e = nvs_commit( my_handle );
+    nvs_close( my_handle );
+    if (e != ESP_OK)
+        return "failed to store configuration";
+    return "";
+}
+
+void WebServer::ConfigApi( httpd_req_t * req )
+{
+    JsonApi::Field const fields[] = { JsonApi::F( s_keySockets,  mConfig.maxSockets ),
+                                      JsonApi::F( s_keyLruPurge, mConfig.lruPurge ),
+                                      JsonApi::F( s_keyRecvTmo,  mConfig.recvTimeout ),
+                                      JsonApi::F( s_keySendTmo,  mConfig.sendTimeout ),
+                                      JsonApi::F( s_keyStack,    mConfig.stackSize ),
+                                      JsonApi::F( s_keyUriSlots, mConfig.uriSlots ) };
+    uint8_t const nofFields = sizeof(fields) / sizeof(fields[0]);
+
+    std::string err{};
+    if (req->method == HTTP_POST)
+        err = PostConfig( req, fields, nofFields );
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST) {
+        json.Result( err );
+        json.Bool( "restart", err.empty() );  // stored: effective after restart
+    }
+    json.Add( fields, nofFields );  // running configuration
+    json.Uint( "maxsockets", MaxSockets );
+}
+
+void WebServer::Api( httpd_req_t * req )
+{
+    const char * const name = & req->uri[sizeof("/api/") - 1];
+    size_t const len = strcspn( name, "?" );
+
+    for (const ApiList * api = mApi; api; api = api->Next)
+        if ((! strncmp( name, api->Name, len )) && ! api->Name[len]) {
+            api->Handler( req );
+            return;
+        }
+
+    std::string err{};
+    if (len) {
+        httpd_resp_set_status( req, HTTPD_404 );
+        err = "unknown api \"";
+        err.append( name, len );
+        err += "\"";
+    }
+    JsonApi json{ req };
+    if (! err.empty())
+        json.Str( "result", err.c_str() );
+    json.Open( "apis", '[' );
+    for (const ApiList * api = mApi; api; api = api->Next)
+        json.Str( 0, api->Name );
+}
+
 /////////////////// extern "C" ///////////////////
 
 extern "C" {
 
-httpd_handle_t start_webserver( void )
+httpd_handle_t start_webserver( const WebServer::Config & cfg )
 {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 20;
+    config.max_open_sockets   = cfg.maxSockets;
+    config.lru_purge_enable   = cfg.lruPurge;  // new connection instead of refused (e.g. by idle keep-alive)
+    config.recv_wait_timeout  = cfg.recvTimeout;
+    config.send_wait_timeout  = cfg.sendTimeout;
+    config.stack_size         = cfg.stackSize;
+    config.max_uri_handlers   = cfg.uriSlots;
+    config.uri_match_fn = httpd_uri_match_wildcard;  // /api/*
 
     // Start the httpd server
-    ESP_LOGI( TAG, "Starting web server on port: '%d'", config.server_port );
+    ESP_LOGI( TAG, "Starting web server on port: '%d' (%d sockets%s, %d uris, stack %d)", config.server_port,
+                   cfg.maxSockets, cfg.lruPurge ? " lru" : "", cfg.uriSlots, cfg.stackSize );
     if (httpd_start( &server, &config ) == ESP_OK) {
         return server;
     }
@@ -207,7 +616,7 @@ void connect_handler( void * arg, esp_event_base_t event_base,
     httpd_handle_t *server = (httpd_handle_t*) arg;
     if (*server == NULL) {
         ESP_LOGI( TAG, "Starting web server" );
-        *server = start_webserver();
+        *server = start_webserver( s_WebServer.GetConfig() );
     }
 }
 
@@ -231,8 +640,47 @@ esp_err_t handler_get_main( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t handler_api( httpd_req_t * req )
+{
+    s_WebServer.Api( req );
+    return ESP_OK;
+}
+
+esp_err_t handler_api_main( httpd_req_t * req )
+{
+    s_WebServer.MainApi( req );
+    return ESP_OK;
+}
+
+esp_err_t handler_get_stats( httpd_req_t * req )
+{
+    s_WebServer.StatsPage( req );
+    return ESP_OK;
+}
+
+esp_err_t handler_api_stats( httpd_req_t * req )
+{
+    s_WebServer.StatsApi( req );
+    return ESP_OK;
+}
+
+esp_err_t handler_api_config( httpd_req_t * req )
+{
+    s_WebServer.ConfigApi( req );
+    return ESP_OK;
+}
+
+esp_err_t handler_timed( httpd_req_t * req )
+{
+    return s_WebServer.Timed( req, *(WebServer::UriStats *) req->user_ctx );
+}
+
 esp_err_t handler_get_favicon( httpd_req_t * req )
 {
+    // known etag: favicon did not change since then - no nvs access for 304
+    if (s_faviconEtag[0] && Assets::NotModified( req, s_faviconEtag, "no-cache" ))
+        return ESP_OK;
+
     do { // while(0)
         nvs_handle my_handle;
         if (nvs_open( "images", NVS_READONLY, &my_handle ) != ESP_OK) {
@@ -269,8 +717,7 @@ esp_err_t handler_get_favicon( httpd_req_t * req )
             }
             nvs_close( my_handle );
 
-            httpd_resp_set_type( req, type );
-            httpd_resp_send( req, (char *) data, len );
+            sendFavicon( req, type, (char *) data, len );
             free( data );
             return ESP_OK;
 
@@ -280,19 +727,23 @@ esp_err_t handler_get_favicon( httpd_req_t * req )
 
     ESP_LOGI( TAG, "handler_get_favicon: sending hard-coded favicon" );
 
-    httpd_resp_set_type( req, "image/gif" /*or x-icon*/ );
-    httpd_resp_send( req, favicon_ico, sizeof(favicon_ico) );
+    const Assets::Asset * asset = Assets::Find( "favicon.gif" );
+    if (asset)
+        sendFavicon( req, asset->type, asset->data, asset->len );
     return ESP_OK;
 }
 
 esp_err_t handler_get_readflash( httpd_req_t * req )
 {
+    const esp_partition_t * part = 0;
     unsigned long addr = 0;
     unsigned long size = 0;
     {
+        char partBuf[18];
         char addrBuf[16];
         char sizeBuf[16];
-        HttpParser::Input in[] = { { "addr", addrBuf, sizeof(addrBuf) },
+        HttpParser::Input in[] = { { "part", partBuf, sizeof(partBuf) },
+                                   { "addr", addrBuf, sizeof(addrBuf) },
                                    { "size", sizeBuf, sizeof(sizeBuf) } };
         HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
 
@@ -304,43 +755,109 @@ esp_err_t handler_get_readflash( httpd_req_t * req )
             return ESP_FAIL;
         }
         char * end = 0;
+        const char * partErr = 0;
         const char * addrErr = 0;
         const char * sizeErr = 0;
+        unsigned long limit = spi_flash_get_chip_size();
+        if (partBuf[0]) {
+            part = esp_partition_find_first( ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, partBuf );
+            if (! part)
+                part = esp_partition_find_first( ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partBuf );
+            if (! part)
+                partErr = "no such partition";
+            else
+                limit = part->size;
+        }
         if (addrBuf[0]) {
-            addr = strtoul( addrBuf, & end, 0 );
+            addr = strtoul( addrBuf, & end, 0 );  // relative to the partition
             if (*end)
                 addrErr = "invalid address";
+            else if (addr >= limit)
+                addrErr = "address out of range";
         }
-        if (! sizeBuf[0])
-            sizeErr = "no size specified";
-        else {
+        if (! sizeBuf[0]) {
+            if (! part)
+                sizeErr = "no size specified";
+            else
+                size = limit - addr;  // up to the end of the partition
+        } else {
             size = strtoul( sizeBuf, & end, 0 );
             if (*end)
                 sizeErr = "invalid size";
             else if (! size)
                 sizeErr = "size 0 not allowed";
+            else if (size > limit - addr)
+                size = limit - addr;
         }
-        if (addrErr || sizeErr) {
+        if (partErr || addrErr || sizeErr) {
             HttpHelper hh{ req, "read flash" };
-            if (addrErr)
-                hh.Add( addrErr );
-            if (addrErr && sizeErr)
-                hh.Add( " and " );
-            if (sizeErr)
-                hh.Add( sizeErr );
+            const char * sep = "";
+            for (const char * err : { partErr, addrErr, sizeErr })
+                if (err) {
+                    hh.Add( sep );
+                    hh.Add( err );
+                    sep = " and ";
+                }
             return ESP_FAIL;
         }
     }
-    char buf[0x400];
+    if (part)
+        addr += part->address;
+
+    // single byte range of the selection: continue an interrupted download
+    unsigned long from = 0;
+    unsigned long to   = size - 1;
+    char range[48];
+    bool const ranged = (httpd_req_get_hdr_value_str( req, "Range", range, sizeof(range) ) == ESP_OK)
+                     && parseRange( range, size, from, to );
+    char contentRange[40];
+    httpd_resp_set_hdr( req, "Accept-Ranges", "bytes" );
+    if (ranged && (from > to)) {
+        snprintf( contentRange, sizeof(contentRange), "bytes */%lu", size );
+        httpd_resp_set_hdr( req, "Content-Range", contentRange );
+        httpd_resp_set_status( req, "416 Range Not Satisfiable" );
+        httpd_resp_send( req, 0, 0 );
+        return ESP_OK;
+    }
+    if (ranged) {
+        snprintf( contentRange, sizeof(contentRange), "bytes %lu-%lu/%lu", from, to, size );
+        httpd_resp_set_hdr( req, "Content-Range", contentRange );
+        httpd_resp_set_status( req, "206 Partial Content" );
+    }
+    char disposition[48];
+    snprintf( disposition, sizeof(disposition), "attachment; filename=\"%s.bin\"", part ? part->label : "flash" );
+    httpd_resp_set_hdr( req, "Content-Disposition", disposition );
+    httpd_resp_set_type( req, "application/octet-stream" );
+
+    addr += from;
+    size  = to - from + 1;
+    ESP_LOGD( TAG, "read flash 0x%06lx..0x%06lx", addr, addr + size - 1 );
+
+    // sector sized reads at sector boundaries (1st one up to the boundary)
+    char * const buf = (char *) malloc( SPI_FLASH_SEC_SIZE );
+    if (! buf) {
+        ESP_LOGE( TAG, "read flash: cannot allocate %d bytes", SPI_FLASH_SEC_SIZE );
+        return ESP_FAIL;  // httpd closes the connection
+    }
+    HttpHelper::Sent( size );
+    esp_err_t ret = ESP_OK;
     while (size) {
-        unsigned long len = size < sizeof(buf) ? size : sizeof(buf);
-        spi_flash_read(       addr, buf, len );
-        httpd_resp_send_chunk( req, buf, len );
+        unsigned long len = SPI_FLASH_SEC_SIZE - (addr % SPI_FLASH_SEC_SIZE);
+        if (len > size)
+            len = size;
+        if ((spi_flash_read( addr, buf, len ) != ESP_OK)
+         || (httpd_resp_send_chunk( req, buf, len ) != ESP_OK)) {
+            ESP_LOGW( TAG, "read flash aborted at 0x%06lx", addr );
+            ret = ESP_FAIL;  // close connection: client sees incomplete chunked data
+            break;
+        }
         addr += len;
         size -= len;
     }
-    httpd_resp_send_chunk( req, 0, 0 );
-    return ESP_OK;
+    free( buf );
+    if (ret == ESP_OK)
+        httpd_resp_send_chunk( req, 0, 0 );
+    return ret;
 }
 
 } // extern "C"
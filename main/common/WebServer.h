@@ -6,7 +6,9 @@
 #define MAIN_WEBSERVER_H_
 
 #include "Wifi.h"
+#include "JsonApi.h"
 #include <esp_http_server.h>
+#include <string>               // std::string
 
 class WebServer
 {
@@ -32,21 +34,82 @@ public:
         }
     };
 
+    typedef esp_err_t (*ApiHandler)( httpd_req_t * req );  // GET and POST of /api/<name>
+    struct ApiList
+    {
+        const char *Name;
+        ApiHandler  Handler;
+        ApiList    *Next;
+
+        ApiList( const char * name, ApiHandler handler ) :
+                Name { name }, Handler { handler }, Next { 0 }
+        {
+        }
+    };
+
+    struct Config  // httpd tuning - nvs namespace "httpd", effective on restart
+    {
+        uint8_t  maxSockets  { 7 };     // concurrent connections (lwip sockets - 3 at most)
+        bool     lruPurge    { true };  // close least recently used connection when all in use
+        uint8_t  recvTimeout { 5 };     // [s]
+        uint8_t  sendTimeout { 5 };     // [s]
+        uint16_t stackSize   { 4096 };  // of the httpd task
+        uint8_t  uriSlots    { 24 };    // max. # of uri handlers
+    };
+
+    struct UriStats  // instrumentation of each registered uri handler
+    {
+        const char     *Uri;
+        httpd_method_t  Method;
+        esp_err_t     (*Handler)( httpd_req_t * req );
+        void           *UserCtx;
+        uint32_t        Calls   { 0 };
+        uint64_t        TotalUs { 0 };
+        uint32_t        MaxUs   { 0 };
+        uint32_t        Bytes   { 0 };           // response bytes sent by the handler
+        uint32_t        HeapLow { 0xffffffff };  // min. free heap seen during a call
+        UriStats       *Next    { 0 };
+
+        UriStats( const httpd_uri_t & uri ) :
+                Uri { uri.uri }, Method { uri.method }, Handler { uri.handler }, UserCtx { uri.user_ctx }
+        {
+        }
+    };
+
     WebServer() {};
     static WebServer& Instance();
 
-    void Init();
+    void Init( const Config * config = 0 );  // 0: configuration from nvs
     void InitPages();
     void AddPage( const Page & page, const httpd_uri_t * postUri = 0 );
     void AddUri( const httpd_uri_t & uri );
+    void AddApi( const char * name, ApiHandler handler );  // no own uri handler: /api/* dispatched by Api()
+    void FaviconChanged();  // new favicon in nvs: etag to be recalculated
+    httpd_handle_t Server() { return mServer; }
+
+    esp_err_t Timed( httpd_req_t * req, UriStats & stats );  // calls the handler measured
 
     void MainPage( httpd_req_t * req );
+    void MainApi( httpd_req_t * req );
+    void Api( httpd_req_t * req );
+    void StatsPage( httpd_req_t * req );
+    void StatsApi( httpd_req_t * req );
+    void ConfigApi( httpd_req_t * req );
+    const Config & GetConfig() { return mConfig; }
     PageList const * GetPageList() { return mAnchor; }
+    UriStats const * GetUriStats() { return mUriStats; }
 
 private:
+    void Register( const httpd_uri_t & uri );  // handler wrapped by Timed()
+    void ReadConfig();
+    std::string PostConfig( httpd_req_t * req, const JsonApi::Field * defaults, uint8_t nofDefaults );
+
     httpd_handle_t mServer  { 0 };
     PageList      *mAnchor  { 0 };
     PageList      *mLastElem{ 0 };
+    ApiList       *mApi     { 0 };
+    UriStats      *mUriStats{ 0 };
+    Config         mConfig  {};
 };
 
 #endif /* MAIN_WEBSERVER_H_ */
@@ -11,6 +11,7 @@
 #include "HttpParser.h"
 #include "HttpHelper.h"
 #include "HttpTable.h"
+#include "JsonApi.h"
 
 #include <string.h>         // strncpy()
 
@@ -120,6 +121,7 @@ bool Wifi::SetParam( const char * host, const char * bgcol, const char * ssid0,
         esp = nvs_set_str( my_handle, s_keyHost, host );
         if (esp == ESP_OK) {
             strncpy( mHost, host, sizeof(mHost) );
+            HttpHelper::InvalidateHead();
             // ESP_LOGI( TAG, "hostname set to \"%s\"", mHost );
         // } else {
             // ESP_LOGE( TAG, "attempt to set hostname failed (error %d)", esp );
@@ -129,6 +131,7 @@ bool Wifi::SetParam( const char * host, const char * bgcol, const char * ssid0,
         esp = nvs_set_str( my_handle, s_keyBgCol, bgcol );
         if (esp == ESP_OK) {
             strncpy( mBgCol, bgcol, sizeof(mBgCol) );
+            HttpHelper::InvalidateHead();
         }
     }
     const char * ssid[2] = { ssid0, ssid1 };
@@ -346,6 +349,12 @@ esp_err_t handler_post_wifi( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t handler_api_wifi( httpd_req_t * req )
+{
+    s_wifi.Api( req );
+    return ESP_OK;
+}
+
 }
 
 namespace
@@ -359,72 +368,92 @@ const WebServer::Page page_wifi   { uri_get_wifi, "Wifi" };
 void Wifi::AddPage( WebServer & webserver )
 {
     webserver.AddPage( page_wifi, & uri_post_wifi );
+    webserver.AddApi( "wifi", handler_api_wifi );
 }
 
-void Wifi::Setup( httpd_req_t * req, bool post )
+std::string Wifi::PostParam( httpd_req_t * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
 {
-    std::string postError{};
-    while (post)
-    {
-        if (! req->content_len) {
-            postError = "no data - nothing to be done";
-            break;
-        }
+    if (! req->content_len)
+        return "no data - nothing to be done";
+
+    char * host  = 0;
+    char * bgcol = 0;
+    char * id[2] = { 0, 0 };
+    char * pw[2] = { 0, 0 };
+    char   bufhost[16];
+    char   bufbgcol[16];
+    char   bufid[2][16];
+    char   bufpw[2][32];
+
+    HttpParser::Input in[] = { { "host", bufhost,  sizeof(bufhost)  },
+                               { "bgcol",bufbgcol, sizeof(bufbgcol) },
+                               { "id0",  bufid[0], sizeof(bufid[0]) },
+                               { "pw0",  bufpw[0], sizeof(bufpw[0]) },
+                               { "id1",  bufid[1], sizeof(bufid[1]) },
+                               { "pw1",  bufpw[1], sizeof(bufpw[1]) }
+                             };
+    HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
+    JsonApi::Prefill( in, sizeof(in) / sizeof(in[0]), defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    if (strcmp( bufhost, Wifi::Instance().GetHost() ))
+        host = bufhost;
+    if (strcmp( bufbgcol, Wifi::Instance().GetBgCol() ))
+        bgcol = bufbgcol;
+    for (int i = 0; i < 2; ++i) {
+        if (strcmp( bufid[i], Wifi::Instance().GetSsid(i) ))
+            id[i] = bufid[i];
+        if (bufpw[i][0])
+            if (strcmp( bufpw[i], Wifi::Instance().GetPassword(i) ))
+                pw[i] = bufpw[i];
+    }
 
-        char * host  = 0;
-        char * bgcol = 0;
-        char * id[2] = { 0, 0 };
-        char * pw[2] = { 0, 0 };
-        char   bufhost[16];
-        char   bufbgcol[16];
-        char   bufid[2][16];
-        char   bufpw[2][32];
-
-        HttpParser::Input in[] = { { "host", bufhost,  sizeof(bufhost)  },
-                                   { "bgcol",bufbgcol, sizeof(bufbgcol) },
-                                   { "id0",  bufid[0], sizeof(bufid[0]) },
-                                   { "pw0",  bufpw[0], sizeof(bufpw[0]) },
-                                   { "id1",  bufid[1], sizeof(bufid[1]) },
-                                   { "pw1",  bufpw[1], sizeof(bufpw[1]) }
-                                 };
-        HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
-
-        const char * parseError = parser.ParsePostData( req );
-        if (parseError) {
-            postError = "parser error: ";
-            postError += parseError;
-            break;
-        }
+    if (! (host || bgcol
+            || id[0] || pw[0] || Wifi::Instance().NoStationCounter(0)
+            || id[1] || pw[1] || Wifi::Instance().NoStationCounter(1))) {
+        return "data unchanged";
+    }
 
-        if (strcmp( bufhost, Wifi::Instance().GetHost() ))
-            host = bufhost;
-        if (strcmp( bufbgcol, Wifi::Instance().GetBgCol() ))
-            bgcol = bufbgcol;
-        for (int i = 0; i < 2; ++i) {
-            if (strcmp( bufid[i], Wifi::Instance().GetSsid(i) ))
-                id[i] = bufid[i];
-            if (bufpw[i][0])
-                if (strcmp( bufpw[i], Wifi::Instance().GetPassword(i) ))
-                    pw[i] = bufpw[i];
-        }
+    // ESP_LOGD( TAG, "before SetParam" ); EXPRD( vTaskDelay( 5 ) )
 
-        if (! (host || bgcol
-                || id[0] || pw[0] || Wifi::Instance().NoStationCounter(0)
-                || id[1] || pw[1] || Wifi::Instance().NoStationCounter(1))) {
-            postError = "data unchanged";
-            break;
-        }
+    if (! Wifi::Instance().SetParam( host, bgcol, id[0], pw[0], id[1], pw[1] ))
+        return "setting wifi parameter failed - try again";
 
-        // ESP_LOGD( TAG, "before SetParam" ); EXPRD( vTaskDelay( 5 ) )
+    // ESP_LOGD( TAG, "after SetParam" ); EXPRD( vTaskDelay( 5 ) )
+    return std::string{};
+}
 
-        if (! Wifi::Instance().SetParam( host, bgcol, id[0], pw[0], id[1], pw[1] )) {
-            postError = "setting wifi parameter failed - try again";
-            break;
-        }
+void Wifi::Api( httpd_req_t * req )
+{
+    JsonApi::Field const fields[] = { JsonApi::F( "host",  mHost ),
+                                      JsonApi::F( "bgcol", mBgCol ),
+                                      JsonApi::F( "id0",   mSsid[0] ),
+                                      JsonApi::F( "id1",   mSsid[1] ),
+                                      JsonApi::F( "fail0", mNoStation[0] ),
+                                      JsonApi::F( "fail1", mNoStation[1] ) };  // no passwords
+    uint8_t const n = sizeof(fields) / sizeof(fields[0]);
+    std::string err{};
+    if (req->method == HTTP_POST)
+        err = PostParam( req, fields, n );
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, n );
+    json.Bool( "station", StationMode() );
+    char ip[16];
+    JsonApi::Format( JsonApi::Ip( "ip", mIpAddr.addr ), ip, sizeof(ip) );
+    json.Str( "ip", ip );
+}
 
-        // ESP_LOGD( TAG, "after SetParam" ); EXPRD( vTaskDelay( 5 ) )
-        break;
-    } // pseudo while loop - just checked for post with some early break
+void Wifi::Setup( httpd_req_t * req, bool post )
+{
+    std::string postError{};
+    if (post)
+        postError = PostParam( req );
 
     HttpHelper hh{ req, s_subWifi, "Wifi" };
 
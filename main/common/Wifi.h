@@ -9,6 +9,9 @@
 #include <event_groups.h>
 #include <esp_event_base.h>
 #include <tcpip_adapter.h>
+#include <string>           // std::string
+
+#include "JsonApi.h"
 
 class Indicator;
 class WebServer;
@@ -50,6 +53,7 @@ public:
 
     void AddPage( WebServer & webserver );
     void Setup( struct httpd_req * req, bool post = false );  // set hostname, etc.
+    void Api( struct httpd_req * req );  // GET/POST /api/wifi
 
     bool SetParam( const char * host,  const char * bgcol,
                    const char * ssid0, const char * password0,
@@ -60,6 +64,7 @@ public:
     void LostIp();
     void NewClient( ip_event_ap_staipassigned_t * event );
 private:
+    std::string PostParam( struct httpd_req * req, const JsonApi::Field * defaults = 0, uint8_t nofDefaults = 0 );
     void ReadParam();
     void ModeAp();
     bool ModeSta( int connTimoInSecs );
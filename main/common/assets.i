@@ -1,4 +1,6 @@
-static const char favicon_ico[] = {
+// generated by assets.py from main/common/assets/ - do not edit
+
+static const char asset_favicon_gif[] = {  // favicon.gif
   0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x40, 0x00, 0x40, 0x00, 0xf7, 0x00,
   0x00, 0x01, 0x01, 0x01, 0x0a, 0x09, 0x08, 0x19, 0x17, 0x04, 0x18, 0x17,
   0x14, 0x27, 0x1b, 0x08, 0x29, 0x27, 0x05, 0x34, 0x35, 0x06, 0x25, 0x25,
@@ -305,5 +307,69 @@ static const char favicon_ico[] = {
   0x7a, 0x6d, 0x2a, 0x78, 0xf5, 0xae, 0x5f, 0xb2, 0xeb, 0x26, 0xf1, 0xa6,
   0xd6, 0x49, 0x42, 0xf6, 0xb2, 0x9b, 0xfd, 0xec, 0x68, 0x4f, 0xbb, 0xda,
   0xd7, 0xce, 0xf6, 0xb6, 0xbb, 0xfd, 0xed, 0x70, 0x8f, 0xbb, 0xdc, 0x1d,
-  0x12, 0x10, 0x00, 0x3b
+  0x12, 0x10, 0x00, 0x3b,
+};
+static const char asset_live_js[] = {  // live.js (gzip)
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x91,
+  0x31, 0x6f, 0xdb, 0x30, 0x10, 0x85, 0x77, 0xff, 0x8a, 0x17, 0x2f, 0x92,
+  0x90, 0x84, 0xde, 0xeb, 0xba, 0x80, 0x11, 0x64, 0xeb, 0x96, 0x31, 0xe8,
+  0x40, 0x4b, 0x67, 0x8b, 0x00, 0x4d, 0xba, 0xe4, 0x51, 0xaa, 0x91, 0xf8,
+  0xbf, 0xf7, 0x28, 0x4a, 0xa8, 0x8b, 0x2e, 0x5d, 0x24, 0x8a, 0x77, 0xf7,
+  0xde, 0xfb, 0x74, 0x9b, 0x0d, 0xac, 0x19, 0x08, 0x83, 0xb6, 0x89, 0xe2,
+  0x17, 0x90, 0xa5, 0x33, 0x39, 0x8e, 0x18, 0x0d, 0xf7, 0xd0, 0xcc, 0xc1,
+  0x1c, 0x12, 0x13, 0x3a, 0xcd, 0xfa, 0x99, 0x86, 0xdd, 0xfa, 0x2b, 0x0d,
+  0x52, 0xff, 0xb6, 0x46, 0xec, 0xfd, 0x08, 0xee, 0x4b, 0x09, 0xfe, 0x28,
+  0x67, 0xcd, 0x98, 0xaa, 0xf0, 0x0e, 0x9b, 0xe9, 0x14, 0x57, 0x9b, 0x0d,
+  0x6a, 0xe7, 0x11, 0xd3, 0x21, 0xb6, 0xc1, 0x5c, 0xd8, 0x48, 0x6d, 0xec,
+  0xc9, 0x4d, 0xa3, 0x17, 0x7d, 0x22, 0xf4, 0x3a, 0x62, 0xea, 0x68, 0xfb,
+  0xc5, 0x1e, 0xcf, 0x53, 0xd9, 0xa5, 0xf3, 0x81, 0x42, 0xd6, 0x9e, 0xc7,
+  0xe5, 0x2b, 0xc2, 0x44, 0x89, 0x7c, 0x36, 0x4c, 0x5d, 0xb3, 0xaa, 0x8f,
+  0xc9, 0xb5, 0x93, 0x66, 0xdd, 0xe0, 0x63, 0x05, 0xe1, 0x08, 0x22, 0x12,
+  0xb1, 0x43, 0xe7, 0xdb, 0x94, 0xb5, 0xd4, 0xcf, 0x44, 0xe1, 0xfa, 0x26,
+  0xca, 0x2d, 0xfb, 0xb0, 0xb7, 0xb6, 0xae, 0xde, 0x67, 0x9a, 0x1f, 0x55,
+  0xb3, 0x95, 0x19, 0x73, 0x44, 0xfd, 0x20, 0x43, 0xca, 0x92, 0x3b, 0x09,
+  0xf5, 0xe7, 0x27, 0x1e, 0x46, 0xe3, 0x3a, 0x3f, 0xaa, 0xd7, 0x0c, 0xf1,
+  0xe6, 0x53, 0x68, 0xa9, 0x91, 0x4e, 0x20, 0x10, 0xa7, 0xe0, 0xb6, 0x8b,
+  0x53, 0x36, 0x72, 0x34, 0xe2, 0xae, 0xaf, 0xae, 0x66, 0xf4, 0x22, 0x9e,
+  0xdb, 0x22, 0x09, 0xef, 0x0e, 0x1f, 0xb7, 0x7c, 0xb1, 0x0f, 0x41, 0x5f,
+  0xd5, 0x25, 0x78, 0xf6, 0x7c, 0xbd, 0x90, 0x3a, 0xfa, 0xf0, 0xaa, 0xdb,
+  0x5e, 0xb5, 0x5a, 0xa2, 0x49, 0x8a, 0x27, 0xfc, 0x61, 0x22, 0x5b, 0xa8,
+  0x66, 0xb7, 0x41, 0x44, 0xc8, 0xaa, 0x13, 0xf1, 0x7e, 0x59, 0x4c, 0x5d,
+  0xcd, 0x2c, 0xc5, 0xad, 0xc0, 0x64, 0xbf, 0x77, 0xc1, 0x2b, 0x91, 0xef,
+  0x43, 0x03, 0x4b, 0x4d, 0xa4, 0x38, 0x24, 0x2a, 0x97, 0x14, 0x95, 0xee,
+  0xba, 0x09, 0xe2, 0xbb, 0x89, 0x4c, 0x8e, 0x42, 0x4d, 0xc3, 0x5f, 0x49,
+  0x96, 0x20, 0xf8, 0x9f, 0x1f, 0xbb, 0x5b, 0x57, 0x78, 0xcc, 0x79, 0x1f,
+  0x51, 0xad, 0xe5, 0x2f, 0x2f, 0x90, 0x77, 0xeb, 0x62, 0x11, 0x04, 0x2b,
+  0xa6, 0x5f, 0xfc, 0xe2, 0x1d, 0xe7, 0xa5, 0x0b, 0x9c, 0xca, 0x02, 0x5b,
+  0xdc, 0x66, 0x98, 0xf2, 0x2e, 0xcf, 0x79, 0x23, 0xff, 0xe4, 0xac, 0x0e,
+  0x24, 0xea, 0x94, 0x9c, 0xf5, 0xba, 0xab, 0xee, 0x33, 0x67, 0x07, 0x21,
+  0x6b, 0xad, 0x8f, 0x54, 0x37, 0x45, 0xf5, 0xd6, 0xc8, 0x69, 0xf5, 0x1b,
+  0x93, 0xc1, 0x46, 0xea, 0xf6, 0x02, 0x00, 0x00,
+};
+static const char asset_style_css[] = {  // style.css (gzip)
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x90,
+  0xcd, 0x8e, 0xc2, 0x30, 0x0c, 0x84, 0xef, 0x7d, 0x0a, 0x4b, 0x7b, 0x61,
+  0x0f, 0x59, 0xc1, 0x8a, 0x95, 0xaa, 0xf0, 0x34, 0x26, 0x71, 0x5a, 0x8b,
+  0x10, 0x57, 0xa9, 0x8b, 0xa8, 0x10, 0xef, 0x4e, 0x0a, 0x54, 0xe2, 0x6f,
+  0x8f, 0x33, 0xe3, 0xf9, 0x6c, 0xb9, 0x5d, 0xc1, 0x09, 0x42, 0x14, 0x54,
+  0x0b, 0x91, 0x82, 0x6e, 0xe0, 0x5c, 0x0d, 0xb1, 0x78, 0x91, 0x7b, 0x35,
+  0xbd, 0x8e, 0x91, 0x8c, 0x8e, 0x1d, 0x59, 0x48, 0x92, 0x68, 0x4a, 0x23,
+  0xc3, 0xa9, 0x7a, 0xaa, 0x54, 0xe0, 0xb9, 0xef, 0x22, 0x8e, 0x16, 0xb6,
+  0x51, 0xdc, 0xae, 0x18, 0x7b, 0x4e, 0xa6, 0x25, 0x6e, 0xda, 0x32, 0xb3,
+  0xae, 0xbb, 0xe3, 0xa6, 0xba, 0x16, 0x71, 0xaa, 0x76, 0xe8, 0x3d, 0xa7,
+  0xc6, 0xc2, 0xd5, 0x87, 0x3d, 0xe6, 0x86, 0xd3, 0xac, 0xb6, 0x92, 0x3d,
+  0x65, 0x0b, 0xbf, 0x0f, 0xca, 0x64, 0xf4, 0x3c, 0xf4, 0x16, 0xfe, 0x1e,
+  0x4d, 0x27, 0x51, 0xca, 0xe0, 0x17, 0xd1, 0x7a, 0x32, 0xd1, 0xed, 0x9a,
+  0x2c, 0x43, 0xf2, 0xcf, 0xc1, 0x6d, 0xad, 0x6d, 0xe5, 0x50, 0xa8, 0x49,
+  0x74, 0xf1, 0x83, 0x4e, 0xf9, 0x40, 0xdf, 0xd3, 0x25, 0x2f, 0xa4, 0xe5,
+  0xb2, 0xfe, 0x4c, 0xba, 0x05, 0xb3, 0x0a, 0x21, 0xcc, 0xdc, 0x3b, 0xec,
+  0x13, 0xab, 0xfe, 0x8f, 0x55, 0xbf, 0xb1, 0x40, 0xe9, 0xa8, 0xc6, 0x93,
+  0x93, 0x8c, 0xca, 0x92, 0xee, 0xbf, 0x2e, 0x3b, 0x2e, 0x9f, 0xbf, 0x72,
+  0xe9, 0x9e, 0x01, 0x00, 0x00,
+};
+
+static const Assets::Asset s_assets[] = {
+    { "favicon.gif", "image/gif", false, "\"822d9ed1\"", asset_favicon_gif, sizeof(asset_favicon_gif) },
+    { "live.js", "application/javascript", true, "\"9dc9dfbb\"", asset_live_js, sizeof(asset_live_js) },
+    { "style.css", "text/css", true, "\"3a1b6b8c\"", asset_style_css, sizeof(asset_style_css) },
 };
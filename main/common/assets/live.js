@@ -0,0 +1,19 @@
+// live values: elements with attribute data-ev="<event>" show the data of that event on /events
+// (no subscription when the page has no such element - the number of subscribers is limited)
+(function () {
+  var els = document.querySelectorAll('[data-ev]');
+  if (!els.length || !window.EventSource)
+    return;
+  var es = new EventSource('/events');
+  var seen = {};
+  Array.prototype.forEach.call(els, function (el) {
+    var ev = el.getAttribute('data-ev');
+    if (seen[ev])
+      return;
+    seen[ev] = true;
+    es.addEventListener(ev, function (e) {
+      document.querySelectorAll('[data-ev="' + ev + '"]').forEach(function (t) { t.textContent = e.data; });
+    });
+  });
+  window.addEventListener('beforeunload', function () { es.close(); });
+})();
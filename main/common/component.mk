@@ -1,3 +1,3 @@
-COMPONENT_OBJS    := Init.o BootCnt.o HttpHelper.o HttpParser.o Indicator.o Mqtinator.o Relay.o Fader.o Temperator.o Updator.o WebServer.o Wifi.o Json.o
+COMPONENT_OBJS    := Init.o BootCnt.o HttpHelper.o HttpParser.o Indicator.o Mqtinator.o Relay.o Fader.o Temperator.o Updator.o WebServer.o Wifi.o Json.o TopicRouter.o PubFilter.o SubQueue.o JsonApi.o EventStream.o Assets.o Unshrink.o Delta.o OtaPipe.o
 COMPONENT_SRCDIRS := .
 COMPONENT_PRIV_INCLUDEDIRS := ../compat ../../esp-open-rtos/extras
@@ -15,6 +15,7 @@
 #include "HttpHelper.h"
 #include "HttpTable.h"
 #include "HttpParser.h"
+#include "JsonApi.h"
 
 #include <esp_http_server.h>
 #include <esp_log.h>    // ESP_LOGI()
@@ -39,9 +40,18 @@ esp_err_t post_smiffer_dump( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t api_smiffer_dump( httpd_req_t * req )
+{
+    s_smiffer.Api( req );
+    return ESP_OK;
+}
+
 }
 
 namespace {
+const char         s_keyTimerDiv[]  = "div";
+const char         s_keyLoadStart[] = "start";
+const char         s_keyLoadData[]  = "data";
 const char * const s_pathDump  = "/dump";
 const httpd_uri_t  s_dump_get  = { .uri = s_pathDump, .method = HTTP_GET,  .handler = get_smiffer_dump,  .user_ctx = 0 };
 const httpd_uri_t  s_dump_post = { .uri = s_pathDump, .method = HTTP_POST, .handler = post_smiffer_dump, .user_ctx = 0 };
@@ -114,6 +124,7 @@ bool Smiffer::Init()
     if (! (mSemaphore = xSemaphoreCreateBinary()))  // where we get waked up
         return false;
     WebServer::Instance().AddPage( s_pageDump, & s_dump_post );
+    WebServer::Instance().AddApi( "dump", api_smiffer_dump );
     return true;
 }
 
@@ -173,33 +184,75 @@ std::string InputField( const char * key, long min, long max, long val )
 
 }
 
+std::string Smiffer::PostParam( httpd_req_t * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
+{
+    char bufTimerDiv[4];
+    char bufLoadStart[12];
+    char bufLoadData[12];
+    HttpParser::Input in[] = { { s_keyTimerDiv,  bufTimerDiv,  sizeof(bufTimerDiv)  },
+                               { s_keyLoadStart, bufLoadStart, sizeof(bufLoadStart) },
+                               { s_keyLoadData,  bufLoadData,  sizeof(bufLoadData)  } };
+    HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
+    JsonApi::Prefill( in, sizeof(in) / sizeof(in[0]), defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    mInfrared->SetTimerDiv( (uint8_t) strtoul( bufTimerDiv,  0, 10 ) );
+    mInfrared->SetTimerLoadStart(     strtoul( bufLoadStart, 0, 10 ) );
+    mInfrared->SetTimerLoadData(      strtoul( bufLoadData,  0, 10 ) );
+    return std::string{};
+}
+
+void Smiffer::Api( httpd_req_t * req )
+{
+    uint8_t  div   = mInfrared->GetTimerDiv();
+    uint32_t start = mInfrared->GetTimerLoadStart();
+    uint32_t data  = mInfrared->GetTimerLoadData();
+    JsonApi::Field const fields[] = { JsonApi::F( s_keyTimerDiv,  div ),
+                                      JsonApi::F( s_keyLoadStart, start ),
+                                      JsonApi::F( s_keyLoadData,  data ) };
+    uint8_t const n = sizeof(fields) / sizeof(fields[0]);
+    std::string err{};
+    if (req->method == HTTP_POST) {
+        err = PostParam( req, fields, n );
+        div   = mInfrared->GetTimerDiv();
+        start = mInfrared->GetTimerLoadStart();
+        data  = mInfrared->GetTimerLoadData();
+    }
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, n );
+
+    const u32 * cnt = getErrCntArray();
+    u32 badframes = 0;
+    json.Open( "errors", '[' );  // per Err type
+    for (u8 cnttype = 1; cnttype <= Err::Unknown; ++cnttype) {
+        json.Uint( 0, cnt[ cnttype ] );
+        badframes += cnt[ cnttype ];
+    }
+    json.Close();
+    json.Uint( "goodframes", cnt[ Err::NoError ] );
+    json.Uint( "badframes",  badframes );
+    json.Uint( "bytes",      mOffsetOnReady );
+    json.Uint( "objects",    mObjCntOnReady );
+    json.Uint( "overflows",  mOvflCnt );
+}
+
 void Smiffer::Dump( httpd_req_t * req, bool isPost )
 {
-    static const char s_keyTimerDiv[]  = "div";
-    static const char s_keyLoadStart[] = "start";
-    static const char s_keyLoadData[]  = "data";
+    std::string postError{};
+    if (isPost)
+        postError = PostParam( req );
 
     HttpHelper hh{ req, "dump latest Rx data", "Dump" };
 
-    if (isPost) {
-        char bufTimerDiv[4];
-        char bufLoadStart[12];
-        char bufLoadData[12];
-        HttpParser::Input in[] = { { s_keyTimerDiv,  bufTimerDiv,  sizeof(bufTimerDiv)  },
-                                   { s_keyLoadStart, bufLoadStart, sizeof(bufLoadStart) },
-                                   { s_keyLoadData,  bufLoadData,  sizeof(bufLoadData)  } };
-        HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
-
-        const char * parseError = parser.ParsePostData( req );
-        if (parseError) {
-            hh.Add( "parser error: " );
-            hh.Add( parseError );
-            return;
-        }
-
-        mInfrared->SetTimerDiv( (uint8_t) strtoul( bufTimerDiv,  0, 10 ) );
-        mInfrared->SetTimerLoadStart(     strtoul( bufLoadStart, 0, 10 ) );
-        mInfrared->SetTimerLoadData(      strtoul( bufLoadData,  0, 10 ) );
+    if (! postError.empty()) {
+        hh.Add( postError );
+        return;
     }
     if (mOvflCnt) {
         hh.Add( "Overflow counter: " );
@@ -208,7 +261,7 @@ void Smiffer::Dump( httpd_req_t * req, bool isPost )
     }
     {   // hh.Add( "SML counter: " );
 
-        Table<Err::Unknown,11> table;
+        Table<Err::Unknown,11,Cols(2, 6, 10)> table;
         hh.Add( " <form method=\"post\">\n" );
         hh.Add( "  <table caption=\"SML counter\">\n" );
         table[0][1] = "&nbsp;";
@@ -223,7 +276,6 @@ void Smiffer::Dump( httpd_req_t * req, bool isPost )
         table[Err::Timeout     - 1][0] = "timeout errors";
         table[Err::Unknown     - 1][0] = "other errors";
 
-        table.Right(2);
         const u32 * cnt = getErrCntArray();
         u32 badframes = 0;
         for (u8 cnttype = 1; cnttype <= Err::Unknown; ++cnttype) {
@@ -237,7 +289,6 @@ void Smiffer::Dump( httpd_req_t * req, bool isPost )
         table[3][4] = "bytes received";
         table[4][4] = "objects parsed";
 
-        table.Right(6);
         table[0][6] = HttpHelper::String( cnt[ Err::NoError ] );
         table[1][6] = HttpHelper::String( badframes );
         table[2][6] = HttpHelper::String( badframes + cnt[ Err::NoError ] );
@@ -248,7 +299,6 @@ void Smiffer::Dump( httpd_req_t * req, bool isPost )
         table[1][8] = "timer load start";
         table[2][8] = "timer load data";
 
-        table.Right(10);
         table[0][10] = InputField( s_keyTimerDiv,   0,      8, mInfrared->GetTimerDiv() );
         table[1][10] = InputField( s_keyLoadStart, 50, 100000, mInfrared->GetTimerLoadStart() );
         table[2][10] = InputField( s_keyLoadData,  50, 100000, mInfrared->GetTimerLoadData() );
@@ -6,9 +6,11 @@
 #include <semphr.h>
 
 #include <stdint.h>
+#include <string>
 #include <driver/gpio.h>
 
 #include "sml/sml.h"
+#include "JsonApi.h"
 
 struct httpd_req;
 
@@ -42,11 +44,14 @@ class Smiffer : public Sml
     void read( uint8_t ch, bool ovfl );
  
     void Dump( httpd_req * req, bool isPost = false );
+    void Api(  httpd_req * req );  // GET/POST /api/dump
     bool Init();
     void SetInfrared( Infrared & infrared ) { mInfrared = & infrared; }
     void Run();
 
   private:
+    std::string PostParam( httpd_req * req, const JsonApi::Field * defaults = 0, uint8_t nofDefaults = 0 );
+
     Infrared        * mInfrared     { 0 };
     Ringbuf           mRingbuf      {};
     u16               mOffsetOnReady{ 0 };
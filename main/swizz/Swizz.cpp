@@ -13,10 +13,12 @@
 #include "Relay.h"
 #include "Indicator.h"
 #include "Mqtinator.h"
+#include "Payload.h"
 
 #include "HttpHelper.h"
 #include "HttpTable.h"
 #include "HttpParser.h"
+#include "JsonApi.h"
 #include "WebServer.h"
 //include "Wifi.h"
 
@@ -24,6 +26,7 @@ const char * const TAG = "Swizz";
 
 extern "C" esp_err_t get_swizz_config( httpd_req_t * req );
 extern "C" esp_err_t post_swizz_config( httpd_req_t * req );
+extern "C" esp_err_t api_swizz( httpd_req_t * req );
 
 /* on:
  *   dz/cg/dn/338 {
@@ -87,6 +90,13 @@ esp_err_t post_swizz_config( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t api_swizz( httpd_req_t * req )
+{
+    if (s_swizz)
+        s_swizz->Api( req );
+    return ESP_OK;
+}
+
 void on_swizz_relay( const char * topic, const char * data )
 {
     ESP_LOGI( TAG, "got \"%s\" \"%.16s...\" (%d bytes)", topic, data, strlen(data) );
@@ -113,6 +123,7 @@ Swizz::Swizz( Relay relay[], size_t nofRelays )
 
     s_swizz = this;
     WebServer::Instance().AddPage( s_page, & s_post_uri );
+    WebServer::Instance().AddApi( "switch", api_swizz );
 }
 
 void Swizz::SwitchRelay( const char * topic, const char * data )
@@ -189,15 +200,10 @@ void Swizz::Run()
             if (! mDzIdx[r])
                 continue;
 
-            char idxbuf[8];
-            char * sidx = HttpHelperI2A( idxbuf, mDzIdx[r] );
-            std::string confirmData{ "{ \"idx\": " };
-            confirmData += sidx;
-            confirmData += ", \"nvalue\": ";
-            confirmData += mRelay[r].GetMode() == Relay::MODE_OFF ? "0" : "1";
-            confirmData += " }";
+            DzPayload confirmData;
+            confirmData.Domoticz( mDzIdx[r], mRelay[r].GetMode() == Relay::MODE_OFF ? 0 : 1 );
 
-            mqtinator.WdPub( 0, confirmData.c_str() );
+            mqtinator.WdPubAsync( 0, confirmData.c_str() );
         }
     }
 }
@@ -234,6 +240,21 @@ void Swizz::WriteParam()
 
 namespace {
 
+// s_keyIdx + relay number right aligned in buf
+const char * IdxKey( char * buf, uint8_t size, uint8_t r )
+{
+    uint8_t const strLen = (uint8_t) strlen( s_keyIdx );
+    char * bp = buf + size - 1;
+    *bp = 0;
+    do {
+        *--bp = (r % 10) + '0';
+        r /= 10;
+    } while (r);
+    bp -= strLen;
+    memcpy( bp, s_keyIdx, strLen );
+    return bp;
+}
+
 std::string InputField( const char * key, uint8_t num, long min, long max, long val )
 {
     std::string str {"<input type=\"number\" name=\"" }; str += key; str += HttpHelper::String( (long) num );
@@ -246,56 +267,66 @@ std::string InputField( const char * key, uint8_t num, long min, long max, long
 
 }
 
+std::string Swizz::PostParam( struct httpd_req * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
+{
+    char bufVal[mNofRelays][6];
+    char bufKey[mNofRelays][8];
+
+    HttpParser::Input in[mNofRelays];
+    for (uint8_t r = 0; r < mNofRelays; ++r)
+        in[r] = HttpParser::Input( IdxKey( bufKey[r], sizeof(bufKey[0]), r ), bufVal[r], sizeof(bufVal[0]) );
+    HttpParser parser{ in, mNofRelays };
+    JsonApi::Prefill( in, mNofRelays, defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    for (uint8_t r = 0; r < mNofRelays; ++r) {
+        mDzIdx[r] = (uint16_t) strtoul( bufVal[r], 0, 10 );
+        ESP_LOGD( TAG, "parsed %s%d as \"%s\" - %d", s_keyIdx, r, bufVal[r], mDzIdx[r] );
+    }
+    WriteParam();
+    return std::string{};
+}
+
+void Swizz::Api( struct httpd_req * req )
+{
+    char           bufKey[mNofRelays][8];
+    JsonApi::Field fields[mNofRelays];
+    for (uint8_t r = 0; r < mNofRelays; ++r)
+        fields[r] = JsonApi::F( IdxKey( bufKey[r], sizeof(bufKey[0]), r ), mDzIdx[r] );
+
+    std::string err{};
+    if (req->method == HTTP_POST)
+        err = PostParam( req, fields, mNofRelays );
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, mNofRelays );
+    json.Open( "on", '[' );
+    for (uint8_t r = 0; r < mNofRelays; ++r)
+        json.Bool( 0, mRelay[r].Status() );
+}
+
 void Swizz::Setup( struct httpd_req * req, bool post )
 {
+    std::string postError{};
+    if (post)
+        postError = PostParam( req );
+
     HttpHelper hh{ req, "Configure switching relays", "Swizz" };
 
-    if (post) {
-        {
-            char bufVal[mNofRelays][6];
-            char bufKey[mNofRelays][8];
-
-            HttpParser::Input in[mNofRelays];
-            uint8_t const strLen = (uint8_t) (sizeof(s_keyIdx) - 1);
-
-            for (uint8_t r = 0; r < mNofRelays; ++r) {
-                char * pKey = bufKey[r];
-                char * bp = pKey + sizeof(bufKey[0]) - 1;
-                *bp = 0;
-                uint8_t x = r;
-                do {
-                    *--bp = (x % 10) + '0';
-                    x /= 10;
-                } while (x);
-                uint8_t const numOffset = (uint8_t) (bp - pKey);
-                uint8_t const strOffset = numOffset - strLen;
-                pKey += strOffset;
-                memcpy( pKey, s_keyIdx, strLen );
-                in[r] = HttpParser::Input( pKey, bufVal[r], sizeof(bufVal[0]) );
-            }
-            HttpParser parser{ in, mNofRelays };
-
-            const char * parseError = parser.ParsePostData( req );
-            if (parseError) {
-                hh.Add( "parser error: " );
-                hh.Add( parseError );
-                return;
-            }
-
-            for (uint8_t r = 0; r < mNofRelays; ++r) {
-                mDzIdx[r] = (uint16_t) strtoul( bufVal[r], 0, 10 );
-                ESP_LOGD( TAG, "parsed %s%d as \"%s\" - %d", s_keyIdx, r, bufVal[r], mDzIdx[r] );
-            }
-        }
-        WriteParam();
+    if (! postError.empty()) {
+        hh.Add( postError );
+        return;
     }
 
     hh.Add( " <form method=\"post\">\n"
             "  <table>\n" );
     {
-        Table<8+1,4> table;
-        table.Right( 0 );
-        table.Right( 2 );
+        Table<8+1,4,Cols(0, 2)> table;
         table[0][1] = "&nbsp;";  // some space due to right adjust of Parameter
         table[0][0] = "Relay №";
         table[0][2] = "Device index";
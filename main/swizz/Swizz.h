@@ -8,8 +8,10 @@
 #include <task.h>
 
 #include <vector>
+#include <string>
 
 #include "nvs.h"  // nvs_handle
+#include "JsonApi.h"
 
 class Relay;
 class Indicator;
@@ -23,12 +25,14 @@ public:
 
     void ReadParam();
     void Setup( struct httpd_req * req, bool post = false );
+    void Api( struct httpd_req * req );  // GET/POST /api/switch
 
     void SwitchRelay( const char * topic, const char * data );
     void WdRequest(   const char * topic, const char * data );
 
 private:
     void WriteParam();
+    std::string PostParam( struct httpd_req * req, const JsonApi::Field * defaults = 0, uint8_t nofDefaults = 0 );
 
     Relay                 * mRelay;     // array of N elements
     std::vector<uint16_t>   mDzIdx;     // domoticz device index for each relay (0: not used by dz)
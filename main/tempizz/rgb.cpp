@@ -84,7 +84,7 @@ void on_mqtt_input( const char * topic, const char * data )
     ESP_LOGI( TAG, "got \"%s\" \"%.16s...\" (%d bytes)", topic, data, strlen(data) );
 
     if (s_rgb)
-        s_rgb->Subscription( topic, data );
+        s_rgb->HandleInput( data );
 }
 
 void RgbTask( void * rgb )
@@ -97,6 +97,7 @@ void RgbTask( void * rgb )
 RGB::RGB( Fader & fader, uint16_t dzDevIdx )
     : mFader { fader }
     , mDevIdx { dzDevIdx }
+    , mInput { TAG, 1, Mqtinator::InMaxLen, SubQueue::DROP_OLDEST }  // the whole device json, latest one wins
 {
     s_rgb = this;
 }
@@ -111,37 +112,22 @@ bool RGB::Start()
     return true;
 }
 
-void RGB::Subscription( const char * topic, const char * data )
-{
-    mTopic = topic;
-    mData  = data;
-    xTaskNotify( mTaskHandle, 1, eSetBits );
-}
-
 void RGB::Run()
 {
     Mqtinator & mqtinator = Mqtinator::Instance();
     char   indexBuf[8];
     char * index = HttpHelperI2A( indexBuf, mDevIdx );
     if (index) {
-        mqtinator.Sub( index, on_mqtt_input );
+        mqtinator.Sub( index, on_mqtt_input, mInput );
     } else {
         ESP_LOGE( TAG, "index buffer too small" );
     }
-    while (true) {
-        uint32_t notification = 0;
-        if (! xTaskNotifyWait( 0, 0xffffffff, & notification, portMAX_DELAY ))
-            continue;
-
-        if (notification & 1) {
-            HandleInput();
-        }
-    }
+    while (true)
+        mInput.Process( portMAX_DELAY );  // JSON parsing and fading run in this task
 }
 
-void RGB::HandleInput()
+void RGB::HandleInput( const char * data )
 {
-    const char * data = mData.c_str();
     JsonMap map{ data };
 /*
     ESP_LOGD( TAG, "json object:         %p", & map );
@@ -7,7 +7,8 @@
 #include <task.h>
 
 #include <stdint.h>
-#include <string>
+
+#include "SubQueue.h"
 
 class Fader;
 
@@ -19,15 +20,13 @@ public:
 
     bool Start();
     void Run();
-    void Subscription( const char * topic, const char * data );
+    void HandleInput( const char * data );  // called by own task
 private:
-    void HandleInput();
 
     Fader     & mFader;
     uint16_t    mDevIdx;
 
-    std::string mTopic{};
-    std::string mData{};
+    SubQueue    mInput;  // latest mqtt input for own task
 
     TaskHandle_t mTaskHandle{};
 };
@@ -22,10 +22,13 @@
 #include "Monitor.h"
 #include "Indicator.h"
 #include "Mqtinator.h"
+#include "Payload.h"
 
 #include "HttpHelper.h"
 #include "HttpTable.h"
 #include "HttpParser.h"
+#include "JsonApi.h"
+#include "EventStream.h"
 #include "WebServer.h"
 #include "Wifi.h"
 
@@ -35,6 +38,7 @@ const char * const Control::mModeName[] { MODE_NAMES };
 
 extern "C" esp_err_t get_config( httpd_req_t * req );
 extern "C" esp_err_t post_config( httpd_req_t * req );
+extern "C" esp_err_t api_config( httpd_req_t * req );
 
 namespace
 {
@@ -96,6 +100,13 @@ esp_err_t post_config( httpd_req_t * req )
     return ESP_OK;
 }
 
+esp_err_t api_config( httpd_req_t * req )
+{
+    if (s_control)
+        s_control->Api( req );
+    return ESP_OK;
+}
+
 void on_analog_value_read( void * control, unsigned short value )
 {
     ((Control *) control)->AnalogValue( value );
@@ -126,11 +137,13 @@ Control::Control( AnalogReader & reader, Relay & relay1, Relay & relay2, Input &
                   mRelay1        { relay1 },
                   mRelay2        { relay2 },
                   mInput         { input },
-                  mMonitor       { monitor }
+                  mMonitor       { monitor },
+                  mSubInput      { "CtrlSub", 1, Mqtinator::InMaxLen, SubQueue::DROP_OLDEST }  // latest mode wins
 {
     if (1 || Wifi::Instance().StationMode()) {
         s_control = this;
         WebServer::Instance().AddPage( s_page, & s_post_uri );
+        WebServer::Instance().AddApi( "switchctrl", api_config );
     }
 }
 
@@ -150,6 +163,7 @@ void Control::Temperature( uint16_t idx, float temperature )
 void Control::AnalogValue( unsigned short value )
 {
     mValue = value;
+    EventStream::Instance().Post( "analog", (long) value );
     Notify( EV_NEWVALUE );
 }
 
@@ -207,53 +221,28 @@ void Control::Subscription( const char * topic, const char * data )
 
 void Control::PublishMode()
 {
-    static uint8_t s_lastModePublished = COUNT_MODES;
-
-    if (mModeIdx && (s_lastModePublished != mMode)) {
-        s_lastModePublished = mMode;
-
-        std::string msg = "{ \"idx\": " + std::to_string( mModeIdx )
-                        + ", \"nvalue\": 0"
-                        + ", \"svalue\": \"" + std::to_string( mMode * 10 ) + "\""
-                        + " }";
-        Mqtinator::Instance().Pub( 0, msg.c_str() ); // topic=0: no topic / just mPubTopic
+    if (mModeIdx && mModeFilter.Check( mMode )) {
+        DzPayload msg;
+        msg.Domoticz( mModeIdx, 0, (long) mMode * 10 );
+        Mqtinator::Instance().PubAsync( 0, msg.c_str() ); // topic=0: no topic / just mPubTopic
     }
 }
 
 void Control::PublishValue( bool force )
 {
-    static value_t    s_lastValuePublished = AnalogReader::INV_VALUE;
-    static TickType_t s_exp = 0;
-
     if (! mModeIdx)
         return;
 
     if (mValue == AnalogReader::INV_VALUE)
         return;
 
-    if (! force) {
-        if (! expired( s_exp )) {
-            if (mValue > s_lastValuePublished) {
-                if (mValue > (mValueTol + s_lastValuePublished))
-                    force = true;
-            } else {
-                if ((mValue + mValueTol) < s_lastValuePublished)
-                    force = true;
-            }
-            if (! force) {
-                if (s_lastValuePublished != AnalogReader::INV_VALUE)
-                    return;
-            }
-        }
-    }
+    mValueFilter.Cfg().absBand = mValueTol;
+    if (! mValueFilter.Check( mValue, force ))
+        return;
 
-    s_lastValuePublished = mValue;
-    s_exp = expiration( (configTICK_RATE_HZ * 59) + (configTICK_RATE_HZ / 2) );
-    std::string msg = "{ \"idx\": " + std::to_string( mValueIdx )
-                    + ", \"nvalue\": 0"
-                    + ", \"svalue\": \"" + std::to_string( ((long) mValue * 100 + AnalogReader::HALF_VALUES) / AnalogReader::NOF_VALUES ) + "\""
-                    + " }";
-    Mqtinator::Instance().Pub( 0, msg.c_str() ); // topic=0: no topic / just mPubTopic
+    DzPayload msg;
+    msg.Domoticz( mValueIdx, 0, ((long) mValue * 100 + AnalogReader::HALF_VALUES) / AnalogReader::NOF_VALUES );
+    Mqtinator::Instance().PubAsync( 0, msg.c_str() ); // topic=0: no topic / just mPubTopic
 }
 
 void Control::Run( Indicator & indicator )
@@ -283,7 +272,8 @@ void Control::Run( Indicator & indicator )
             *--cp = (idx % 10) + '0';
             idx /= 10;
         } while (idx);
-        Mqtinator::Instance().Sub( cp, & on_subscribe );
+        if (mSubInput.StartWorker())
+            Mqtinator::Instance().Sub( cp, & on_subscribe, mSubInput );
     }
 
     while (true)
@@ -498,6 +488,7 @@ void Control::Run( Indicator & indicator )
                         break;
                 }
             }
+            EventStream::Instance().Post( "mode", mModeName[ mMode < COUNT_MODES ? mMode : (uint8_t) COUNT_MODES ] );
             PublishMode();
         }
         if (pubVal)
@@ -649,67 +640,119 @@ Control::value_t percent2value( long perc )
 
 }
 
+uint8_t Control::ApiFields( JsonApi::Field * fields, uint32_t * val ) const
+{
+    const char * const key[ApiNofFields] = { s_keyThresOff, s_keyThresOn, s_keyMinOff, s_keyMinOn, s_keyMaxOn,
+                                             s_keyValRgMin, s_keyValRgMax, s_keyValueTol,
+                                             s_keyValueIdx, s_keyModeIdx, s_keyTempIdx, s_keyTempMax };
+    // in units of the html form:
+    val[ 0] = value2percent( mThresOff );
+    val[ 1] = value2percent( mThresOn );
+    val[ 2] = (mMinOffTicks + configTICK_RATE_HZ/2) / configTICK_RATE_HZ;
+    val[ 3] = (mMinOnTicks  + configTICK_RATE_HZ/2) / configTICK_RATE_HZ;
+    val[ 4] = (mMaxOnTicks  + configTICK_RATE_HZ/2) / configTICK_RATE_HZ;
+    val[ 5] = value2percent( mValRange[0] );
+    val[ 6] = value2percent( mValRange[1] );
+    val[ 7] = value2percent( mValueTol );
+    val[ 8] = mValueIdx;
+    val[ 9] = mModeIdx;
+    val[10] = mTempIdx;
+    val[11] = mTempMax;
+    for (uint8_t i = 0; i < ApiNofFields; ++i)
+        fields[i] = JsonApi::F( key[i], val[i] );
+    return ApiNofFields;
+}
+
+std::string Control::PostParam( struct httpd_req * req, const JsonApi::Field * defaults, uint8_t nofDefaults )
+{
+    char bufThresOff[4];
+    char bufThresOn[4];
+    char bufMinOff[4];
+    char bufMinOn[4];
+    char bufMaxOn[8];
+    char bufValRgMin[4];
+    char bufValRgMax[4];
+    char bufValueTol[4];
+    char bufValueIdx[6];
+    char bufModeIdx[6];
+    char bufTempIdx[6];
+    char bufTempMax[4];
+    HttpParser::Input in[] = { { s_keyThresOff, bufThresOff, sizeof(bufThresOff) },
+                               { s_keyThresOn,  bufThresOn,  sizeof(bufThresOn)  },
+                               { s_keyMinOff,   bufMinOff,   sizeof(bufMinOff)   },
+                               { s_keyMinOn,    bufMinOn,    sizeof(bufMinOn)    },
+                               { s_keyMaxOn,    bufMaxOn,    sizeof(bufMaxOn)    },
+                               { s_keyValRgMin, bufValRgMin, sizeof(bufValRgMin) },
+                               { s_keyValRgMax, bufValRgMax, sizeof(bufValRgMax) },
+                               { s_keyValueTol, bufValueTol, sizeof(bufValueTol) },
+                               { s_keyValueIdx, bufValueIdx, sizeof(bufValueIdx) },
+                               { s_keyModeIdx,  bufModeIdx,  sizeof(bufModeIdx)  },
+                               { s_keyTempIdx,  bufTempIdx,  sizeof(bufTempIdx)  },
+                               { s_keyTempMax,  bufTempMax,  sizeof(bufTempMax)  } };
+    HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
+    JsonApi::Prefill( in, sizeof(in) / sizeof(in[0]), defaults, nofDefaults );
+
+    const char * parseError = parser.ParsePostData( req );
+    if (parseError)
+        return std::string{ "parser error: " } + parseError;
+
+    mThresOff    = percent2value( strtoul( bufThresOff, 0, 10 ) );
+    mThresOn     = percent2value( strtoul( bufThresOn,  0, 10 ) );
+    mMinOffTicks =               (strtoul( bufMinOff,   0, 10 ) * configTICK_RATE_HZ);
+    mMinOnTicks  =               (strtoul( bufMinOn,    0, 10 ) * configTICK_RATE_HZ);
+    mMaxOnTicks  =               (strtoul( bufMaxOn,    0, 10 ) * configTICK_RATE_HZ);
+    mValRange[0] = percent2value( strtoul( bufValRgMin, 0, 10 ) );
+    mValRange[1] = percent2value( strtoul( bufValRgMax, 0, 10 ) );
+    mValueTol    = percent2value( strtoul( bufValueTol, 0, 10 ) );
+    mValueIdx    = (uint16_t)     strtoul( bufValueIdx, 0, 10 );
+    mModeIdx     = (uint16_t)     strtoul( bufModeIdx,  0, 10 );
+    mTempIdx     = (uint16_t)     strtoul( bufTempIdx,  0, 10 );
+    mTempMax     = (uint8_t)      strtoul( bufTempMax,  0, 10 );
+
+    mMonitor.SetThres( mThresOff, mThresOn );
+    WriteParam();
+    return std::string{};
+}
+
+void Control::Api( struct httpd_req * req )
+{
+    JsonApi::Field fields[ApiNofFields];
+    uint32_t       val[ApiNofFields];
+    uint8_t const  n = ApiFields( fields, val );
+
+    std::string err{};
+    if (req->method == HTTP_POST) {
+        err = PostParam( req, fields, n );
+        ApiFields( fields, val );  // values as stored
+    }
+
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( err );
+    json.Add( fields, n );
+    json.Uint( "mode",     mMode );
+    json.Str(  "modename", mModeName[ mMode < COUNT_MODES ? mMode : (uint8_t) COUNT_MODES ] );
+    json.Uint( "value",    mValue );
+    json.Uint( "loops",    mLoopCnt );
+    json.Uint( "nowait",   mLoopCnt - mDelayCnt );
+}
+
 void Control::Setup( struct httpd_req * req, bool post )
 {
-    HttpHelper hh{ req, "Configure switching thresholds", "Control" };
+    std::string postError{};
+    if (post)
+        postError = PostParam( req );
 
-    if (post) {
-        {
-            char bufThresOff[4];
-            char bufThresOn[4];
-            char bufMinOff[4];
-            char bufMinOn[4];
-            char bufMaxOn[8];
-            char bufValRgMin[4];
-            char bufValRgMax[4];
-            char bufValueTol[4];
-            char bufValueIdx[6];
-            char bufModeIdx[6];
-            char bufTempIdx[6];
-            char bufTempMax[4];
-            HttpParser::Input in[] = { { s_keyThresOff, bufThresOff, sizeof(bufThresOff) },
-                                       { s_keyThresOn,  bufThresOn,  sizeof(bufThresOn)  },
-                                       { s_keyMinOff,   bufMinOff,   sizeof(bufMinOff)   },
-                                       { s_keyMinOn,    bufMinOn,    sizeof(bufMinOn)    },
-                                       { s_keyMaxOn,    bufMaxOn,    sizeof(bufMaxOn)    },
-                                       { s_keyValRgMin, bufValRgMin, sizeof(bufValRgMin) },
-                                       { s_keyValRgMax, bufValRgMax, sizeof(bufValRgMax) },
-                                       { s_keyValueTol, bufValueTol, sizeof(bufValueTol) },
-                                       { s_keyValueIdx, bufValueIdx, sizeof(bufValueIdx) },
-                                       { s_keyModeIdx,  bufModeIdx,  sizeof(bufModeIdx)  },
-                                       { s_keyTempIdx,  bufTempIdx,  sizeof(bufTempIdx)  },
-                                       { s_keyTempMax,  bufTempMax,  sizeof(bufTempMax)  } };
-            HttpParser parser{ in, sizeof(in) / sizeof(in[0]) };
-
-            const char * parseError = parser.ParsePostData( req );
-            if (parseError) {
-                hh.Add( "parser error: " );
-                hh.Add( parseError );
-                return;
-            }
+    HttpHelper hh{ req, "Configure switching thresholds", "Control" };
 
-            mThresOff    = percent2value( strtoul( bufThresOff, 0, 10 ) );
-            mThresOn     = percent2value( strtoul( bufThresOn,  0, 10 ) );
-            mMinOffTicks =               (strtoul( bufMinOff,   0, 10 ) * configTICK_RATE_HZ);
-            mMinOnTicks  =               (strtoul( bufMinOn,    0, 10 ) * configTICK_RATE_HZ);
-            mMaxOnTicks  =               (strtoul( bufMaxOn,    0, 10 ) * configTICK_RATE_HZ);
-            mValRange[0] = percent2value( strtoul( bufValRgMin, 0, 10 ) );
-            mValRange[1] = percent2value( strtoul( bufValRgMax, 0, 10 ) );
-            mValueTol    = percent2value( strtoul( bufValueTol, 0, 10 ) );
-            mValueIdx    = (uint16_t)     strtoul( bufValueIdx, 0, 10 );
-            mModeIdx     = (uint16_t)     strtoul( bufModeIdx,  0, 10 );
-            mTempIdx     = (uint16_t)     strtoul( bufTempIdx,  0, 10 );
-            mTempMax     = (uint8_t)      strtoul( bufTempMax,  0, 10 );
-        }
-        mMonitor.SetThres( mThresOff, mThresOn );
-        WriteParam();
+    if (! postError.empty()) {
+        hh.Add( postError );
+        return;
     }
     hh.Add( " <form method=\"post\">\n"
             "  <table>\n" );
     {
-        Table<14,5> table;
-        table.Right( 0 );
-        table.Right( 2 );
+        Table<14,5,Cols(0, 2)> table;
         table[ 0][1] = "&nbsp;";  // some space due to right adjust of Parameter
         table[ 0][2] = "Value";
         table[ 0][0] = "Parameter";                table[ 0][3] = "Unit";      table[ 0][4] = "Remarks";
@@ -750,9 +793,7 @@ void Control::Setup( struct httpd_req * req, bool post )
     hh.Add( " <h3>Current mode and statistics counter</h3>\n"
             " <table>\n" );
     {
-        Table<4,3> table;
-        table.Right( 0 );
-        table.Right( 1 );
+        Table<4,3,Cols(0, 1)> table;
         table[0][0] = "Counter"; table[0][1] = "Value"; table[0][2] = "Remarks";
 
         table[1][0] = "Current mode:";
@@ -761,7 +802,9 @@ void Control::Setup( struct httpd_req * req, bool post )
         table[3][2] = "loops without need to wait (should be rare)";
 
         table[1][1] = std::to_string( mMode );
-        table[1][2] = mModeName[ mMode < COUNT_MODES ? mMode : (uint8_t) COUNT_MODES ];
+        table[1][2] = "<span data-ev=\"mode\">";  // live update by live.js
+        table[1][2] += mModeName[ mMode < COUNT_MODES ? mMode : (uint8_t) COUNT_MODES ];
+        table[1][2] += "</span>";
         table[2][1] = std::to_string( mLoopCnt );
         table[3][1] = std::to_string( mLoopCnt - mDelayCnt );
 
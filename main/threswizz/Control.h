@@ -9,6 +9,9 @@
 #include <semphr.h>
 
 #include "AnalogReader.h"  // AnalogReader::INV_VALUE
+#include "PubFilter.h"
+#include "JsonApi.h"
+#include "SubQueue.h"
 
 #include "nvs.h"  // nvs_handle
 
@@ -103,14 +106,19 @@ public:
     void Run( Indicator & indicator );  // the thread function (call in main)
     void Temperature( uint16_t idx, float temperature );
     void AnalogValue( unsigned short value );
-    void Subscription( const char * topic, const char * data );
+    void Subscription( const char * topic, const char * data );  // called by mSubInput worker
     void NextTestStep();                // button pressed -> go to next test step
 
     void ReadParam();
     void SavePwrOnMode( uint8_t mode );
     void Setup( struct httpd_req * req, bool post = false );
+    void Api( struct httpd_req * req );  // GET/POST /api/switchctrl
 
 private:
+    static constexpr uint8_t ApiNofFields = 12;
+
+    uint8_t     ApiFields( JsonApi::Field * fields, uint32_t * val ) const;  // val: in units of html form
+    std::string PostParam( struct httpd_req * req, const JsonApi::Field * defaults = 0, uint8_t nofDefaults = 0 );
     void WriteParam();
     void SetU16( nvs_handle nvs, const char * key, uint16_t val );
     void SetU32( nvs_handle nvs, const char * key, uint32_t val );
@@ -144,10 +152,14 @@ private:
 
     value_t  mValue { AnalogReader::INV_VALUE };
 
+    PubFilter mModeFilter  { "mode",  { 0, 0, 0,  0 } };  // publish on change only
+    PubFilter mValueFilter { "value", { 0, 0, 0, 59 } };  // absBand = mValueTol / refresh each minute
+
     uint32_t mLoopCnt    { 0 };  // loops
     uint32_t mDelayCnt   { 0 };  // loops with xSemaphoreTake waiting
 
     SemaphoreHandle_t mSemaphore { 0 };
+    SubQueue          mSubInput;  // mode subscription: parsed by own worker, not by Mqtinator task
 
     static const char * const mModeName[];
 };
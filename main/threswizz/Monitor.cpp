@@ -11,6 +11,7 @@
 
 #include "HttpHelper.h"
 #include "HttpParser.h"
+#include "JsonApi.h"
 #include "WebServer.h"
 #include "Wifi.h"
 
@@ -19,6 +20,7 @@ const char * const TAG = "Monitor";
 }
 
 extern "C" esp_err_t monitor_get( httpd_req_t * req );
+extern "C" esp_err_t monitor_api( httpd_req_t * req );
 
 const httpd_uri_t     s_uri = { .uri = "/monitor", .method = HTTP_GET, .handler = monitor_get, .user_ctx = 0 };
 const WebServer::Page s_page  { s_uri, "Monitor" };
@@ -32,12 +34,20 @@ extern "C" esp_err_t monitor_get( httpd_req_t * req )
     return ESP_OK;
 }
 
+extern "C" esp_err_t monitor_api( httpd_req_t * req )
+{
+    if (s_monitor)
+        s_monitor->Api( req );
+    return ESP_OK;
+}
+
 Monitor::Monitor( AnalogReader & analog_reader ) :
                         Reader { analog_reader }
 {
     if (1 || Wifi::Instance().StationMode()) {
         s_monitor = this;
         WebServer::Instance().AddPage( s_page, 0 );
+        WebServer::Instance().AddApi( "monitor", monitor_api );
     }
 }
 
@@ -46,6 +56,28 @@ Monitor::~Monitor()
     s_monitor = 0;
 }
 
+void Monitor::Api( struct httpd_req * req ) const
+{
+    constexpr uint16_t N = 600;  // as shown in graph
+    value_t val[N];
+    Reader.GetValues( val, N );
+
+    JsonApi::Field const fields[] = { JsonApi::F( "thresoff", ThresOff ),
+                                      JsonApi::F( "threson",  ThresOn ) };
+    JsonApi json{ req };
+    if (req->method == HTTP_POST)
+        json.Result( "read only" );
+    json.Add( fields, sizeof(fields) / sizeof(fields[0]) );
+    json.Uint( "nofvalues", AnalogReader::NOF_VALUES );  // scale of values
+    json.Open( "values", '[' );  // oldest first
+    for (uint16_t i = 0; i < N; ++i)
+        json.Uint( 0, val[i] & AnalogReader::MASK_VALUE );
+    json.Close();
+    json.Open( "relay", '[' );
+    for (uint16_t i = 0; i < N; ++i)
+        json.Uint( 0, (val[i] & 0x8000) ? 1 : 0 );
+}
+
 void Monitor::Show( struct httpd_req * req ) const
 {
     enum
@@ -23,6 +23,7 @@ public:
     };
 
     void Show( struct httpd_req * req ) const;
+    void Api(  struct httpd_req * req ) const;  // GET /api/monitor
 private:
     AnalogReader & Reader;
     value_t        ThresOff { 0x8000 };
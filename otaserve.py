@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+
+# otaserve.py
+#
+# local stand-in of the update server: serves the build directory with
+# Range: bytes=<from>- support and may drop connections to exercise the
+# resume of the Updator (set uri to http://<host>:<port>/<project>.bin)
+#
+# usage: otaserve.py [-p port] [-d dir] [--drop bytes] [--drops count]
+#   --drop 100000 --drops 2: the first 2 responses end after 100000 bytes each
+
+import argparse
+import functools
+import http.server
+import os
+import re
+
+class Handler( http.server.SimpleHTTPRequestHandler ):
+    drop  = 0
+    drops = 0
+
+    def do_GET( self ):
+        path = self.translate_path( self.path )
+        if not os.path.isfile( path ):
+            self.send_error( 404 )
+            return
+        with open( path, 'rb' ) as f:
+            data = f.read()
+        start = 0
+        m = re.fullmatch( r'bytes=(\d+)-', self.headers.get( 'Range', '' ) )
+        if m:
+            start = int( m.group(1) )
+            if start >= len(data):
+                self.send_response( 416 )
+                self.send_header( 'Content-Range', 'bytes */%d' % len(data) )
+                self.end_headers()
+                return
+            self.send_response( 206 )
+            self.send_header( 'Content-Range', 'bytes %d-%d/%d' % (start, len(data) - 1, len(data)) )
+        else:
+            self.send_response( 200 )
+        self.send_header( 'Content-Type', 'application/octet-stream' )
+        self.send_header( 'Content-Length', str( len(data) - start ) )
+        self.send_header( 'Accept-Ranges', 'bytes' )
+        self.end_headers()
+        body = data[start:]
+        if Handler.drops > 0 and len(body) > Handler.drop:
+            Handler.drops -= 1
+            self.wfile.write( body[:Handler.drop] )
+            self.log_message( 'dropped after %d bytes (%d drops left)', Handler.drop, Handler.drops )
+            self.close_connection = True
+            return
+        self.wfile.write( body )
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser( description='serve firmware images with Range support' )
+    ap.add_argument( '-p', '--port', type=int, default=8070 )
+    ap.add_argument( '-d', '--dir', default='build' )
+    ap.add_argument( '--drop', type=int, default=100000, help='bytes sent before a drop' )
+    ap.add_argument( '--drops', type=int, default=0, help='number of responses to drop' )
+    args = ap.parse_args()
+    Handler.drop  = args.drop
+    Handler.drops = args.drops
+    handler = functools.partial( Handler, directory=args.dir )
+    http.server.ThreadingHTTPServer( ('', args.port), handler ).serve_forever()
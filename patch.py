@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+
+# patch.py
+#
+# builds a delta update of a firmware image against the image running on the device
+# (decoded by main/common/Delta.cpp), compressed by shrink.py:
+#   header: 'h' 'd' 1 0 <old length: u32> <new length: u32> <sha256 old> <sha256 new>
+#   ops:    <op> <length: u32> <old offset: u32> [data]
+#           'c' copy old, 'd' old + data bytes (shifted code), 'a' data bytes
+# the patch gets applied and compared before it is written (self check)
+#
+# the Updator tries <uri>.patch before <uri> (uri ending with .bin):
+#   patch.py old/rtos8266.bin build/rtos8266.bin  ->  build/rtos8266.bin.patch
+
+import argparse
+import hashlib
+import struct
+import sys
+
+import shrink
+
+KEY     = 8    # bytes of the index key
+GIVEUP  = 32   # end of approximate match: bytes without improvement
+MINCOPY = 24   # shorter exact runs within a match are part of a 'd' op
+
+def index( old ):
+    idx = {}
+    for p in range( len(old) - KEY + 1 ):
+        idx.setdefault( old[p:p+KEY], p )
+    return idx
+
+def extend( old, new, p, i ):
+    # approximate match of new[i:] at old[p:]: length with best score 2 * equal - length
+    limit = min( len(old) - p, len(new) - i )
+    best = 0
+    bestlen = 0
+    score = 0
+    j = 0
+    while j < limit and j - bestlen <= GIVEUP:
+        if old[p+j] == new[i+j]:
+            score += 1
+            if score > best:
+                best = score
+                bestlen = j + 1
+        else:
+            score -= 1
+        j += 1
+    return bestlen, best
+
+def ops( old, new, p, i, length ):
+    # split a match into exact copies and diff spans
+    out = []
+    j = 0
+    while j < length:
+        k = j
+        while k < length and old[p+k] == new[i+k]:
+            k += 1
+        if k - j >= MINCOPY or (k == length and k > j):
+            out.append( ('c', p + j, i + j, k - j) )
+            j = k
+            continue
+        # diff span up to the next exact run of MINCOPY
+        k = j
+        run = 0
+        while k < length:
+            if old[p+k] == new[i+k]:
+                run += 1
+                if run >= MINCOPY:
+                    k -= run - 1
+                    break
+            else:
+                run = 0
+            k += 1
+        if k >= length:
+            k = length
+        out.append( ('d', p + j, i + j, k - j) )
+        j = k
+    return out
+
+def diff( old, new ):
+    idx = index( old )
+    result = []
+    lit = 0         # start of pending literal data
+    delta = None    # old - new offset of the last match
+    i = 0
+    n = len(new)
+    while i < n:
+        cands = []
+        if delta is not None and 0 <= i + delta < len(old):
+            cands.append( i + delta )
+        p = idx.get( new[i:i+KEY] )
+        if p is not None and p not in cands:
+            cands.append( p )
+        best = (0, 0, 0)
+        for p in cands:
+            length, score = extend( old, new, p, i )
+            if score > best[1]:
+                best = (length, score, p)
+        length, score, p = best
+        if score < KEY:
+            i += 1
+            continue
+        if lit < i:
+            result.append( ('a', 0, lit, i - lit) )
+        result += ops( old, new, p, i, length )
+        delta = p - i
+        i += length
+        lit = i
+    if lit < n:
+        result.append( ('a', 0, lit, n - lit) )
+    return result
+
+def encode( old, new, result ):
+    out = bytearray( struct.pack( '<ccBBII', b'h', b'd', 1, 0, len(old), len(new) ) )
+    out += hashlib.sha256( old ).digest() + hashlib.sha256( new ).digest()
+    for op, p, i, length in result:
+        out += struct.pack( '<cII', op.encode(), length, p )
+        if op == 'a':
+            out += new[i:i+length]
+        elif op == 'd':
+            out += bytes( (new[i+k] - old[p+k]) & 0xff for k in range( length ) )
+    return bytes( out )
+
+def apply( old, patch ):  # reference of Delta.cpp (self check)
+    magic0, magic1, version, _, oldlen, newlen = struct.unpack( '<ccBBII', patch[:12] )
+    if patch[12:44] != hashlib.sha256( old[:oldlen] ).digest():
+        raise ValueError( 'patch not built against this image' )
+    out = bytearray()
+    pos = 76
+    while pos < len(patch):
+        op, length, p = struct.unpack( '<cII', patch[pos:pos+9] )
+        pos += 9
+        if op == b'c':
+            out += old[p:p+length]
+        elif op == b'd':
+            out += bytes( (old[p+k] + patch[pos+k]) & 0xff for k in range( length ) )
+            pos += length
+        else:
+            out += patch[pos:pos+length]
+            pos += length
+    if len(out) != newlen or hashlib.sha256( out ).digest() != patch[44:76]:
+        raise ValueError( 'new image mismatch' )
+    return bytes( out )
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser( description='build a delta update against the running image' )
+    ap.add_argument( 'old', help='image running on the device' )
+    ap.add_argument( 'new', help='new image' )
+    ap.add_argument( 'output', nargs='?', help='default: <new>.patch' )
+    args = ap.parse_args()
+
+    with open( args.old, 'rb' ) as f:
+        old = f.read()
+    with open( args.new, 'rb' ) as f:
+        new = f.read()
+    result = diff( old, new )
+    patch = encode( old, new, result )
+    if apply( old, patch ) != new:
+        sys.exit( 'patch.py: self check failed' )
+    packed = shrink.shrink( patch, 12, 4 )
+    if shrink.unshrink( packed ) != patch:
+        sys.exit( 'patch.py: compression self check failed' )
+    output = args.output or args.new + '.patch'
+    with open( output, 'wb' ) as f:
+        f.write( packed )
+    counts = { op: sum( r[3] for r in result if r[0] == op ) for op in 'cda' }
+    print( '%s: %d bytes (copy %d, diff %d, add %d of %d)'
+           % (output, len(packed), counts['c'], counts['d'], counts['a'], len(new)) )
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+
+# shrink.py
+#
+# compresses a firmware image for the Updator (decoded by main/common/Unshrink.cpp):
+# heatshrink LZSS bit stream (window 2^W, lookahead 2^L) with an 8 byte header
+#   'h' 's' W L <original length: uint32 LE>
+#
+# usage: shrink.py [-w W] [-l L] image.bin [image.bin.hs]
+
+import argparse
+import struct
+import sys
+
+class BitWriter:
+    def __init__( self ):
+        self.out  = bytearray()
+        self.acc  = 0
+        self.bits = 0
+
+    def put( self, val, n ):
+        self.acc = (self.acc << n) | val
+        self.bits += n
+        while self.bits >= 8:
+            self.bits -= 8
+            self.out.append( (self.acc >> self.bits) & 0xff )
+        self.acc &= (1 << self.bits) - 1
+
+    def flush( self ):
+        if self.bits:
+            self.out.append( (self.acc << (8 - self.bits)) & 0xff )
+            self.acc  = 0
+            self.bits = 0
+        return self.out
+
+def shrink( data, wbits, lbits, chain=48 ):
+    window = 1 << wbits
+    maxlen = 1 << lbits
+    minlen = 2 if 1 + wbits + lbits < 18 else 3  # backref cheaper than literals
+    head = {}   # 2 byte prefix -> positions, most recent last
+    bw = BitWriter()
+    n = len(data)
+    i = 0
+
+    def insert( pos ):
+        if pos + 1 < n:
+            head.setdefault( data[pos:pos+2], [] ).append( pos )
+
+    while i < n:
+        bestlen = 0
+        bestoff = 0
+        cands = head.get( data[i:i+2] )
+        if cands:
+            limit = min( maxlen, n - i )
+            tried = 0
+            for pos in reversed( cands ):
+                off = i - pos
+                if off > window or tried >= chain:
+                    break
+                tried += 1
+                if bestlen and data[pos+bestlen] != data[i+bestlen]:
+                    continue  # cannot be longer
+                l = 2
+                while l + 8 <= limit and data[pos+l:pos+l+8] == data[i+l:i+l+8]:
+                    l += 8
+                while l < limit and data[pos+l] == data[i+l]:
+                    l += 1
+                if l > bestlen:
+                    bestlen = l
+                    bestoff = off
+                    if l == limit:
+                        break
+            if len(cands) > 4 * chain:  # forget positions out of reach
+                del cands[:-2 * chain]
+        if bestlen >= minlen:
+            bw.put( 0, 1 )
+            bw.put( bestoff - 1, wbits )
+            bw.put( bestlen - 1, lbits )
+            for p in range( i, i + bestlen ):
+                insert( p )
+            i += bestlen
+        else:
+            bw.put( 1, 1 )
+            bw.put( data[i], 8 )
+            insert( i )
+            i += 1
+    return struct.pack( '<ccBBI', b'h', b's', wbits, lbits, n ) + bw.flush()
+
+def unshrink( packed ):  # reference decoder (self check)
+    magic0, magic1, wbits, lbits, size = struct.unpack( '<ccBBI', packed[:8] )
+    out = bytearray()
+    acc = 0
+    bits = 0
+    pos = 8
+
+    def get( n ):
+        nonlocal acc, bits, pos
+        while bits < n:
+            if pos >= len(packed):
+                return None
+            acc = (acc << 8) | packed[pos]
+            pos += 1
+            bits += 8
+        bits -= n
+        val = acc >> bits
+        acc &= (1 << bits) - 1
+        return val
+
+    while len(out) < size:
+        tag = get( 1 )
+        if tag is None:
+            break
+        if tag:
+            out.append( get( 8 ) )
+        else:
+            off = get( wbits ) + 1
+            cnt = get( lbits ) + 1
+            for _ in range( cnt ):
+                out.append( out[-off] if off <= len(out) else 0 )
+    return bytes( out )
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser( description='compress a firmware image for the Updator' )
+    ap.add_argument( '-w', type=int, default=12, help='window bits (4..12)' )
+    ap.add_argument( '-l', type=int, default=4,  help='lookahead bits (3..w-1)' )
+    ap.add_argument( 'image' )
+    ap.add_argument( 'output', nargs='?' )
+    args = ap.parse_args()
+    if not (4 <= args.w <= 12 and 3 <= args.l < args.w):
+        sys.exit( 'shrink.py: invalid window/lookahead bits' )
+
+    with open( args.image, 'rb' ) as f:
+        data = f.read()
+    packed = shrink( data, args.w, args.l )
+    if unshrink( packed ) != data:
+        sys.exit( 'shrink.py: self check failed' )
+    output = args.output or args.image + '.hs'
+    with open( output, 'wb' ) as f:
+        f.write( packed )
+    print( '%s: %d -> %d bytes (%d%%)' % (output, len(data), len(packed), 100 * len(packed) // max( len(data), 1 )) )
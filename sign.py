@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+
+# sign.py
+#
+# publishes the digest of a firmware image next to it, checked by the Updator
+# before the boot partition gets switched:
+#   <image>.sha256:  "<hex digest>  <image name>" (as sha256sum)
+#   <image>.sig:     ECDSA P-256 signature (DER) of the image digest,
+#                    when a private key is given (-k or $OTA_SIGN_KEY)
+# the device requires a valid signature, when built with OTA_SIGNED (main/common/otakey.i):
+#   sign.py --keygen ~/ota-private.pem  ->  private key + main/common/otakey.i
+#   make OTA_SIGNED=1  /  cmake -DOTA_SIGNED=ON
+#
+# usage: sign.py [-k private.pem] image.bin
+#        sign.py --keygen private.pem
+
+import argparse
+import hashlib
+import os
+import subprocess
+import sys
+
+def keygen( private ):
+    if os.path.exists( private ):
+        sys.exit( 'sign.py: %s exists - not overwritten' % private )
+    subprocess.run( [ 'openssl', 'ecparam', '-name', 'prime256v1', '-genkey', '-noout', '-out', private ], check=True )
+    os.chmod( private, 0o600 )
+    pem = subprocess.run( [ 'openssl', 'ec', '-in', private, '-pubout' ],
+                          check=True, capture_output=True ).stdout.decode()
+    base = os.path.dirname( os.path.abspath( sys.argv[0] ) )
+    out = os.path.join( base, 'main', 'common', 'otakey.i' )
+    with open( out, 'w' ) as f:
+        f.write( '// public key of %s generated by sign.py - signed images only\n' % os.path.basename( private ) )
+        f.write( 'static const char s_otaKey[] =\n' )
+        for line in pem.strip().split( '\n' ):
+            f.write( '    "%s\\n"\n' % line )
+        f.write( '    ;\n' )
+    print( '%s: private key (keep it secret)\n%s: public key built into the firmware by OTA_SIGNED' % (private, out) )
+
+def sign( image, private ):
+    with open( image, 'rb' ) as f:
+        digest = hashlib.sha256( f.read() ).hexdigest()
+    with open( image + '.sha256', 'w' ) as f:
+        f.write( '%s  %s\n' % (digest, os.path.basename( image )) )
+    print( '%s.sha256: %s' % (image, digest) )
+    if private:
+        subprocess.run( [ 'openssl', 'dgst', '-sha256', '-sign', private, '-out', image + '.sig', image ], check=True )
+        print( '%s.sig: signed by %s' % (image, private) )
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser( description='publish digest and signature of a firmware image' )
+    ap.add_argument( '-k', '--key', default=os.environ.get( 'OTA_SIGN_KEY' ), help='private key (PEM)' )
+    ap.add_argument( '--keygen', action='store_true', help='generate a key pair' )
+    ap.add_argument( 'file', help='image, or private key to generate' )
+    args = ap.parse_args()
+    if args.keygen:
+        keygen( args.file )
+    else:
+        sign( args.file, args.key )